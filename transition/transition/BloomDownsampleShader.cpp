@@ -0,0 +1,55 @@
+#include "BloomDownsampleShader.h"
+#include "GeometryNode.h"
+
+BloomDownsampleShader::BloomDownsampleShader() : ShaderResource("assets/shaders/postprocess.vs", "assets/shaders/bloom_downsample.fs")
+{
+	this->texture_uniform_ = -1;
+	this->bright_pass_uniform_ = -1;
+	this->volumetric_enabled_uniform_ = -1;
+	this->volumetric_tex_uniform_ = -1;
+	this->bloom_treshold_uniform_ = -1;
+}
+
+BloomDownsampleShader::~BloomDownsampleShader()
+{
+}
+
+void BloomDownsampleShader::init()
+{
+	ShaderResource::init();
+	this->texture_uniform_ = get_uniform("image");
+	this->bright_pass_uniform_ = get_uniform("bright_pass");
+	this->volumetric_enabled_uniform_ = get_uniform("volumetric_enabled");
+	this->volumetric_tex_uniform_ = get_uniform("volumetric_tex");
+	this->bloom_treshold_uniform_ = get_uniform("bloom_treshold");
+}
+
+void BloomDownsampleShader::set_camera_uniforms(const RenderingNode * node)
+{
+	//Nothing
+}
+
+void BloomDownsampleShader::set_model_uniforms(const GeometryNode * node)
+{
+	//Nothing
+}
+
+void BloomDownsampleShader::set_texture(TextureRenderable* texture)
+{
+	texture->bind(0);
+	glUniform1i(texture_uniform_, 0);
+	glUniform1i(bright_pass_uniform_, false);
+}
+
+void BloomDownsampleShader::set_bright_pass(TextureRenderable* scene_texture, TextureRenderable* volumetric_texture, float treshold)
+{
+	scene_texture->bind(0);
+	glUniform1i(texture_uniform_, 0);
+	glUniform1i(volumetric_enabled_uniform_, volumetric_texture != nullptr);
+	if (volumetric_texture != nullptr) {
+		volumetric_texture->bind(1);
+		glUniform1i(volumetric_tex_uniform_, 1);
+	}
+	glUniform1f(bloom_treshold_uniform_, treshold);
+	glUniform1i(bright_pass_uniform_, true);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "ShaderResource.h"
+#include "TextureResource.h"
+
+/*
+Shader for halving the resolution of an image with a 13 tap filter, one step of the bloom mip chain
+The first step adds the volumetric lighting to the scene and keeps only the parts brighter than the treshold.
+*/
+class BloomDownsampleShader : public ShaderResource {
+
+private:
+	GLint texture_uniform_;
+	GLint bright_pass_uniform_;
+	GLint volumetric_enabled_uniform_;
+	GLint volumetric_tex_uniform_;
+	GLint bloom_treshold_uniform_;
+
+public:
+	BloomDownsampleShader();
+	~BloomDownsampleShader();
+
+	void init() override;
+
+	void set_camera_uniforms(const RenderingNode* node) override;
+	void set_model_uniforms(const GeometryNode* node) override;
+
+	void set_texture(TextureRenderable* texture);
+	//volumetric_texture may be nullptr if no light is volumetric
+	void set_bright_pass(TextureRenderable* scene_texture, TextureRenderable* volumetric_texture, float treshold);
+};
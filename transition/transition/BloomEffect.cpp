@@ -1,60 +1,129 @@
 #include "BloomEffect.h"
+#include "CameraNode.h"
+#include "LightNode.h"
+#include <cassert>
+#include <algorithm>
+#include <string>
 
 BloomEffect::BloomEffect(unsigned int iterations, TextureRenderable *end_tex)
 {
 	this->iterations_ = iterations;
 	end_tex_ = end_tex;
 	end_tex_intensity_ = 0.0;
+	volumetric_texture_ = -1;
+	target_texture_ = -1;
+	camera_ = nullptr;
 }
 
 void BloomEffect::init(RenderingEngine *engine, CameraNode *camera)
 {
 	screenMesh_ = MeshResource::create_sprite(nullptr);
 	screenMesh_->init();
-	viewport_ = engine->get_viewport();
-	gauss_shader_ = new BloomGaussShader();
-	add_shader_ = new BloomAddShader();
-	engine->register_resource(gauss_shader_);
-	engine->register_resource(add_shader_);
-	gauss_shader_->init();
-	add_shader_->init();
-	help_buffer_[0] = new TextureFBO(engine->get_viewport().x, engine->get_viewport().y, 1);
-	help_buffer_[0]->init_color();
-
-	help_buffer_[1] = new TextureFBO(engine->get_viewport().x, engine->get_viewport().y, 1);
-	help_buffer_[1]->init_color();
-
+	camera_ = camera;
+	downsample_shader_ = new BloomDownsampleShader();
+	upsample_shader_ = new BloomUpsampleShader();
+	composite_shader_ = new CompositeShader();
+	engine->register_resource(downsample_shader_);
+	engine->register_resource(upsample_shader_);
+	engine->register_resource(composite_shader_);
+	downsample_shader_->init();
+	upsample_shader_->init();
+	composite_shader_->init();
 }
 
-void BloomEffect::perform_effect(const TextureFBO * from, GLuint fbo_to, const std::vector<LightNode *> light_nodes)
+int BloomEffect::add_passes(FrameGraph *graph, int from, const std::vector<LightNode *>& light_nodes)
 {
-	TextureRenderable * brighttex = from->get_texture(1);
-	gauss_shader_->use();
-	gauss_shader_->set_gauss_uniforms(brighttex, true);
-	bool horizontal = true;
-	for (unsigned int i = 0; i < 2 * iterations_; i++) {
-		help_buffer_[horizontal]->bind_for_rendering();
-		if (i != 0) {
-			gauss_shader_->set_gauss_uniforms(help_buffer_[!horizontal], horizontal);
-		}
-		glViewport(0, 0, viewport_.x, viewport_.y);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	assert(volumetric_texture_ >= 0 && target_texture_ >= 0);
+	const bool bloom = iterations_ > 0 && addintensity_ > 0.0f;
+	const bool volumetric = std::any_of(light_nodes.begin(), light_nodes.end(), [](const LightNode* light) { return light->is_volumetric(); });
+	const int levels = glm::min(static_cast<int>(glm::min(iterations_, glm::max(max_iterations_, 1u))) + 2, max_levels);
+	const int volumetric_texture = volumetric_texture_;
+	const int target = target_texture_;
+	const glm::ivec2 scene_size = graph->get_size(from);
+
+	//level i has 1/2^(i+1) of the scene size
+	int mip_chain[max_levels];
+	for (int i = 0; i < levels; i++) {
+		const glm::ivec2 size(glm::max(scene_size.x >> (i + 1), 1), glm::max(scene_size.y >> (i + 1), 1));
+		mip_chain[i] = graph->create_texture("bloom " + std::to_string(i), { size, FrameGraph::FORMAT_COLOR });
+	}
+
+	//the first level extracts the bright parts from the scene and the volumetric lighting
+	std::vector<int> bright_reads = { from };
+	if (volumetric) {
+		bright_reads.push_back(volumetric_texture);
+	}
+	graph->add_pass("bloom bright", bright_reads, { mip_chain[0] }, [this, from, volumetric, volumetric_texture, mip_chain](const FrameGraph& graph)
+	{
+		downsample_shader_->use();
+		downsample_shader_->set_bright_pass(graph.get_fbo(from)->get_texture(0), volumetric ? graph.get_fbo(volumetric_texture) : nullptr, bloom_treshold_);
+		this->draw_screen(graph.get_fbo(mip_chain[0]));
+	});
+	for (int i = 1; i < levels; i++) {
+		graph->add_pass("bloom downsample " + std::to_string(i), { mip_chain[i - 1] }, { mip_chain[i] }, [this, i, mip_chain](const FrameGraph& graph)
+		{
+			downsample_shader_->use();
+			downsample_shader_->set_texture(graph.get_fbo(mip_chain[i - 1]));
+			this->draw_screen(graph.get_fbo(mip_chain[i]));
+		});
+	}
 
+	//each level keeps half of its own image, so the small levels widen the glow without washing it out
+	for (int i = levels - 2; i >= 0; i--) {
+		graph->add_pass("bloom upsample " + std::to_string(i), { mip_chain[i + 1], mip_chain[i] }, { mip_chain[i] }, [this, i, mip_chain](const FrameGraph& graph)
+		{
+			upsample_shader_->use();
+			upsample_shader_->set_upsample_uniforms(graph.get_fbo(mip_chain[i + 1]), 0.5f);
+			this->draw_screen(graph.get_fbo(mip_chain[i]));
+		});
+	}
+
+	std::vector<int> composite_reads = { from };
+	if (volumetric) {
+		composite_reads.push_back(volumetric_texture);
+	}
+	if (bloom) {
+		composite_reads.push_back(mip_chain[0]);
+	}
+	graph->add_pass("composite", composite_reads, { target }, [this, from, volumetric, volumetric_texture, bloom, mip_chain, target](const FrameGraph& graph)
+	{
+		auto frustum = camera_->get_frustum();
+		composite_shader_->use();
+		composite_shader_->set_scene_texture(graph.get_fbo(from)->get_texture(0));
+		composite_shader_->set_volumetric_texture(volumetric ? graph.get_fbo(volumetric_texture) : nullptr);
+		composite_shader_->set_near_far_plane(frustum->nearD, frustum->farD);
+		composite_shader_->set_bloom(bloom ? graph.get_fbo(mip_chain[0]) : nullptr, addintensity_);
+		composite_shader_->set_end_texture(end_tex_, end_tex_intensity_);
+		const glm::ivec2 size = graph.get_size(target);
+		glBindFramebuffer(GL_FRAMEBUFFER, graph.get_fbo_id(target));
+		glViewport(0, 0, size.x, size.y);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		glBindVertexArray(screenMesh_->get_resource_id());
-		glDrawElements(GL_TRIANGLES, screenMesh_->get_num_indices(), GL_UNSIGNED_INT, nullptr);
+		glDrawElements(GL_TRIANGLES, screenMesh_->get_num_indices(), screenMesh_->get_index_type(), nullptr);
 		glBindVertexArray(0);
-		horizontal = !horizontal;
-	}
+	});
 
-	add_shader_->use();
-	add_shader_->set_textures(from->get_texture(0), help_buffer_[!horizontal], addintensity_, end_tex_, end_tex_intensity_);
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo_to);
-	glViewport(0, 0, viewport_.x, viewport_.y);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	return target;
+}
+
+void BloomEffect::draw_screen(const TextureFBO* target) const
+{
+	//the levels have no depth buffer, the upsampling blends into them without clearing
+	target->bind_for_rendering();
+	glViewport(0, 0, target->get_size().x, target->get_size().y);
 	glBindVertexArray(screenMesh_->get_resource_id());
-	glDrawElements(GL_TRIANGLES, screenMesh_->get_num_indices(), GL_UNSIGNED_INT, nullptr);
+	glDrawElements(GL_TRIANGLES, screenMesh_->get_num_indices(), screenMesh_->get_index_type(), nullptr);
 	glBindVertexArray(0);
+}
 
+void BloomEffect::set_volumetric_texture(const int volumetric_texture)
+{
+	this->volumetric_texture_ = volumetric_texture;
+}
+
+void BloomEffect::set_target_texture(const int target_texture)
+{
+	this->target_texture_ = target_texture;
 }
 
 void BloomEffect::set_iterations(int iterations)
@@ -62,11 +131,21 @@ void BloomEffect::set_iterations(int iterations)
 	this->iterations_ = iterations;
 }
 
+void BloomEffect::set_max_iterations(const unsigned int max_iterations)
+{
+	this->max_iterations_ = max_iterations;
+}
+
 void BloomEffect::set_addintensity(float intensity)
 {
 	this->addintensity_ = intensity;
 }
 
+void BloomEffect::set_bloom_treshold(float treshold)
+{
+	this->bloom_treshold_ = treshold;
+}
+
 void BloomEffect::set_end_tex_intensity(float end_tex_intensity)
 {
 	this->end_tex_intensity_ = end_tex_intensity;
@@ -1,34 +1,57 @@
 #pragma once
 #include "PostProcessingEffect.h"
-#include "BloomGaussShader.h"
-#include "BloomAddShader.h"
+#include "BloomDownsampleShader.h"
+#include "BloomUpsampleShader.h"
+#include "CompositeShader.h"
 #include "TextureFBO.h"
 
 /*
 Bloom-Effect
+The bright parts of the image are progressively downsampled into a chain of targets from half down to 1/32 of the
+viewport and upsampled back with a tent filter, each level blending the blurred smaller one over its own image.
+As last effect of the frame it also composites: one full resolution pass upsamples the volumetric lighting, adds it
+and the bloom to the scene and blends in the end texture. Disabled bloom is not read, so the graph culls its passes.
 */
 class BloomEffect : public PostProcessingEffect {
 private:
+	static const int max_levels = 5;
+
 	MeshResource *screenMesh_;
-	BloomGaussShader *gauss_shader_;
-	BloomAddShader *add_shader_;
-	TextureFBO *help_buffer_[2];	//Ping-Pong-Buffers
+	BloomDownsampleShader *downsample_shader_;
+	BloomUpsampleShader *upsample_shader_;
+	CompositeShader *composite_shader_;
 	unsigned int iterations_;
+	unsigned int max_iterations_ = max_levels - 2;
 	float addintensity_  = 1.0f;
-	glm::ivec2 viewport_;
+	float bloom_treshold_ = 0.8f;
+	int volumetric_texture_;
+	int target_texture_;
+	CameraNode *camera_;
 	TextureRenderable *end_tex_; // texture that is displayed when reaching the end
 	float end_tex_intensity_;
+
+	void draw_screen(const TextureFBO *target) const;
 public:
 	/*
-	intensity: How strong the bloom should be. The number of 8x8-Gauss-Filter to use on the image.
+	iterations: How strong the bloom should be. Each iteration adds one level to the mip chain and doubles the radius.
 	*/
 	BloomEffect(unsigned int iterations, TextureRenderable *end_tex);
 
 	virtual void init(RenderingEngine *engine, CameraNode *camera) override;
 
-	virtual void perform_effect(const TextureFBO *from, GLuint fbo_to, const std::vector<LightNode *> light_nodes) override;
+	//from is the main render target, its texture 0 holds the scene color and the depth in alpha
+	//returns the target texture, which the composite pass renders to
+	virtual int add_passes(FrameGraph *graph, int from, const std::vector<LightNode *>& light_nodes) override;
+
+	//textures of the frame graph with the half resolution volumetric lighting and for the composited image
+	//of the size of from, both have to be set before add_passes
+	void set_volumetric_texture(int volumetric_texture);
+	void set_target_texture(int target_texture);
 
 	void set_iterations(int iterations);
+	//limits the iterations set by the scene, enabled bloom keeps at least one
+	void set_max_iterations(unsigned int max_iterations);
 	void set_addintensity(float intensity);
+	void set_bloom_treshold(float treshold);
 	void set_end_tex_intensity(float end_tex_intensity);
 };
\ No newline at end of file
@@ -0,0 +1,36 @@
+#include "BloomUpsampleShader.h"
+#include "GeometryNode.h"
+
+BloomUpsampleShader::BloomUpsampleShader() : ShaderResource("assets/shaders/postprocess.vs", "assets/shaders/bloom_upsample.fs")
+{
+	this->texture_uniform_ = -1;
+	this->weight_uniform_ = -1;
+}
+
+BloomUpsampleShader::~BloomUpsampleShader()
+{
+}
+
+void BloomUpsampleShader::init()
+{
+	ShaderResource::init();
+	this->texture_uniform_ = get_uniform("image");
+	this->weight_uniform_ = get_uniform("weight");
+}
+
+void BloomUpsampleShader::set_camera_uniforms(const RenderingNode * node)
+{
+	//Nothing
+}
+
+void BloomUpsampleShader::set_model_uniforms(const GeometryNode * node)
+{
+	//Nothing
+}
+
+void BloomUpsampleShader::set_upsample_uniforms(TextureRenderable* texture, float weight)
+{
+	texture->bind(0);
+	glUniform1i(texture_uniform_, 0);
+	glUniform1f(weight_uniform_, weight);
+}
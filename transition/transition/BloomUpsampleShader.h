@@ -0,0 +1,25 @@
+#pragma once
+#include "ShaderResource.h"
+#include "TextureResource.h"
+
+/*
+Shader for blending a 3x3 tent filtered, smaller level of the bloom mip chain into the next bigger one
+*/
+class BloomUpsampleShader : public ShaderResource {
+
+private:
+	GLint texture_uniform_;
+	GLint weight_uniform_;
+
+public:
+	BloomUpsampleShader();
+	~BloomUpsampleShader();
+
+	void init() override;
+
+	void set_camera_uniforms(const RenderingNode* node) override;
+	void set_model_uniforms(const GeometryNode* node) override;
+
+	//weight: share of the upsampled image in the result, the rest keeps the level's own downsampled image
+	void set_upsample_uniforms(TextureRenderable* texture, float weight);
+};
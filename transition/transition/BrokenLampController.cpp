@@ -80,6 +80,8 @@ void BrokenLampController::init(RenderingEngine* rendering_engine)
 	this->geometry_ = static_cast<GeometryNode*>(rendering_engine->get_root_node()->find_by_name("BulbHead_0"));
 	this->whole_lamp_geometry_ = static_cast<GroupNode*>(rendering_engine->get_root_node()->find_by_name("LightBulb"));
 	assert(this->whole_lamp_geometry_ != nullptr);
+	this->whole_lamp_geometry_->set_dynamic(true);
+	this->geometry_->set_dynamic(true);
 
 	this->origin_pos_ = this->geometry_->get_position() - glm::vec3(0,-3,0);
 	this->set_brightness(0.0);
@@ -5,22 +5,36 @@
 #include "VolumetricLightingShader.h"
 #include "VolumetricLightingEffect.h"
 #include "BloomEffect.h"
+#include "UpscaleEffect.h"
 #include "DummyEffect.h"
+#include "DepthPrepassShader.h"
+#include "LightGrid.h"
+#include "ShadowScheduler.h"
+#include "ShadowAtlas.h"
+#include "FrameGraph.h"
 
 CameraNode::CameraNode(const std::string& name, const glm::ivec2& viewport, const float fieldOfView, const float ratio, const float nearp, const float farp, const bool culling) : RenderingNode(name, viewport, fieldOfView, ratio, nearp, farp, culling)
 {
-	volumetric_lighting_result_render_target_ = nullptr;
 	main_render_target_ = nullptr;
+	light_grid_ = nullptr;
+	shadow_scheduler_ = new ShadowScheduler();
+	frame_graph_ = new FrameGraph();
 
 	volumetric_lighting_effect_ = new VolumetricLightingEffect();
 	credits_texture_ = new TextureResource("assets/gfx/end.tga");
 	bloom_effect_ = new BloomEffect(1, credits_texture_);
+	upscale_effect_ = new UpscaleEffect();
 }
 
 CameraNode::~CameraNode()
 {
 	delete volumetric_lighting_effect_;
 	delete bloom_effect_;
+	delete upscale_effect_;
+	delete main_render_target_;
+	delete light_grid_;
+	delete shadow_scheduler_;
+	delete frame_graph_;
 }
 
 void CameraNode::init(RenderingEngine *rendering_engine)
@@ -33,25 +47,43 @@ void CameraNode::init(RenderingEngine *rendering_engine)
 	main_render_target_ = new TextureFBO(rendering_engine->get_viewport().x, rendering_engine->get_viewport().y, 2);
 	main_render_target_->init_color(true);
 
-	volumetric_lighting_result_render_target_ = new TextureFBO(rendering_engine->get_viewport().x, rendering_engine->get_viewport().y, 2);
-	volumetric_lighting_result_render_target_->init_color();
+	light_grid_ = new LightGrid(rendering_engine, rendering_engine->get_viewport());
 
 	volumetric_lighting_effect_->init(rendering_engine, this);
 	bloom_effect_->init(rendering_engine, this);
+	upscale_effect_->init(rendering_engine, this);
 }
 
 void CameraNode::before_render(const std::vector<IDrawable*> &drawables, const std::vector<IDrawable*>& transparents, const std::vector<LightNode*> &light_nodes) const
 {
+	this->update_frustum();
+	visible_lights_.clear();
 	for (auto &light : light_nodes)
 	{
-		light->render(drawables, transparents, {}, std::vector<LightNode*>());
+		if (this->is_light_visible(light)) {
+			visible_lights_.push_back(light);
+		}
 	}
 
-	RenderingNode::before_render(drawables, transparents, light_nodes);
+	// regions are assigned first, lights whose region moved have to render their whole shadow map again
+	const auto shadow_atlas = this->get_rendering_engine()->get_shadow_atlas();
+	shadow_atlas->update(visible_lights_, this);
+	for (auto &light : visible_lights_)
+	{
+		light->prepare_shadow_map(this, drawables, transparents);
+	}
+	shadow_scheduler_->update(visible_lights_, this);
+	shadow_atlas->filter();
+	shadow_atlas->upload_views();
+
+	RenderingNode::before_render(drawables, transparents, visible_lights_);
+
+	light_grid_->update(visible_lights_, this);
 
 	const auto shader = this->get_shader();
 	shader->use();
-	shader->set_light_uniforms(light_nodes);
+	shader->set_light_grid(light_grid_);
+	shader->set_shadow_atlas(shadow_atlas);
 	shader->set_camera_uniforms(this);
 	
 	main_render_target_->bind_for_rendering();
@@ -61,10 +93,39 @@ void CameraNode::before_render(const std::vector<IDrawable*> &drawables, const s
 
 void CameraNode::after_render(const std::vector<IDrawable*> &drawables, const std::vector<IDrawable*>& transparents, const std::vector<LightNode*> &light_nodes) const
 {
-	RenderingNode::after_render(drawables, transparents, light_nodes);
+	RenderingNode::after_render(drawables, transparents, visible_lights_);
+
+	// the volumetric lighting stays at half resolution, the bloom effect composites everything in one pass
+	frame_graph_->reset();
+	const int scene = frame_graph_->import_texture("scene", main_render_target_);
+	const int screen = frame_graph_->import_screen("screen", this->get_rendering_engine()->get_viewport());
+	bloom_effect_->set_volumetric_texture(volumetric_lighting_effect_->add_passes(frame_graph_, scene, visible_lights_));
+	// below the window resolution the composite is upscaled to the screen, otherwise it is written directly
+	const bool scaled = frame_graph_->get_size(scene) != frame_graph_->get_size(screen);
+	const int composite = scaled ? frame_graph_->create_texture("composite", { frame_graph_->get_size(scene), FrameGraph::FORMAT_COLOR }) : screen;
+	bloom_effect_->set_target_texture(composite);
+	bloom_effect_->add_passes(frame_graph_, scene, visible_lights_);
+	if (scaled) {
+		upscale_effect_->set_target_texture(screen);
+		upscale_effect_->add_passes(frame_graph_, composite, visible_lights_);
+	}
+	frame_graph_->set_output(screen);
+	frame_graph_->compile();
+	frame_graph_->execute();
+}
 
-	volumetric_lighting_effect_->perform_effect(main_render_target_, volumetric_lighting_result_render_target_->get_fbo_id(), light_nodes);
-	bloom_effect_->perform_effect(volumetric_lighting_result_render_target_, 0, light_nodes);
+bool CameraNode::is_light_visible(const LightNode* light) const
+{
+	if (!light->is_enabled()) {
+		return false;
+	}
+	glm::vec3 center;
+	float radius;
+	if (!light->get_influence_sphere(center, radius)) {
+		return true;
+	}
+	// lights without color contribute nothing
+	return radius > 0.0f && this->is_sphere_visible(center, radius);
 }
 
 MainShader* CameraNode::get_shader() const 
@@ -72,14 +133,48 @@ MainShader* CameraNode::get_shader() const
 	return this->get_rendering_engine()->get_main_shader();
 }
 
+ShaderResource* CameraNode::get_depth_prepass_shader() const
+{
+	return this->get_rendering_engine()->get_depth_prepass_shader();
+}
+
 void CameraNode::set_bloom_params(int iterations, float treshold, float addintensity)
 {
 	bloom_effect_->set_iterations(iterations);
 	bloom_effect_->set_addintensity(addintensity);
-	volumetric_lighting_effect_->set_bloom_treshold(treshold);
+	bloom_effect_->set_bloom_treshold(treshold);
 }
 
 void CameraNode::set_end_tex_intensity(float end_tex_intensity)
 {
 	this->bloom_effect_->set_end_tex_intensity(end_tex_intensity);
 }
+
+void CameraNode::set_render_scale(const float scale)
+{
+	const glm::ivec2 window = this->get_rendering_engine()->get_viewport();
+	const glm::ivec2 size = glm::max(glm::ivec2(glm::round(glm::vec2(window) * scale)), glm::ivec2(1));
+	if (size == main_render_target_->get_size()) {
+		return;
+	}
+	delete main_render_target_;
+	main_render_target_ = new TextureFBO(size.x, size.y, 2);
+	main_render_target_->init_color(true);
+	this->set_viewport(size);
+	light_grid_->set_viewport(size);
+}
+
+void CameraNode::set_volumetric_sample_scale(const float scale)
+{
+	light_grid_->set_volumetric_sample_scale(scale);
+}
+
+void CameraNode::set_max_bloom_iterations(const unsigned int max_iterations)
+{
+	bloom_effect_->set_max_iterations(max_iterations);
+}
+
+void CameraNode::set_shadow_budget(const long long texels)
+{
+	this->shadow_scheduler_->set_budget(texels);
+}
@@ -9,8 +9,12 @@ class MeshResource;
 class VolumetricLightingShader;
 class TextureFBO;
 class BloomEffect;
+class UpscaleEffect;
 class MeshResource;
 class DummyShader;
+class LightGrid;
+class ShadowScheduler;
+class FrameGraph;
 
 
 class CameraNode :
@@ -18,11 +22,19 @@ class CameraNode :
 {
 
 private:
-	TextureFBO *volumetric_lighting_result_render_target_;
 	TextureFBO *main_render_target_;
 	VolumetricLightingEffect *volumetric_lighting_effect_;
 	BloomEffect *bloom_effect_;
+	UpscaleEffect *upscale_effect_;
 	TextureResource* credits_texture_;
+	LightGrid *light_grid_;
+	ShadowScheduler *shadow_scheduler_;
+	//post processing passes, declared anew every frame
+	FrameGraph *frame_graph_;
+	//lights that can reach a visible pixel this frame, only these render shadow maps and are passed to the shaders
+	mutable std::vector<LightNode*> visible_lights_;
+
+	bool is_light_visible(const LightNode* light) const;
 public:
 	CameraNode(const std::string& name, const glm::ivec2& viewport, const float fieldOfView, const float ratio, const float nearp, const float farp, const bool culling);
 	~CameraNode();
@@ -34,11 +46,27 @@ public:
 	void after_render(const std::vector<IDrawable*> &drawables, const std::vector<IDrawable*>& transparents, const std::vector<LightNode*> &light_nodes) const override;
 
 	MainShader* get_shader() const override;
+	ShaderResource* get_depth_prepass_shader() const override;
 
 	bool renders_particles() const override { return true; }
 	
 	void set_bloom_params(int iterations, float treshold, float addintensity);
 
 	void set_end_tex_intensity(float end_tex_intensity);
+
+	//renders the scene at a fraction of the window resolution and upscales it, the render target is only recreated if its size changes
+	void set_render_scale(float scale);
+
+	//quality settings of the effects owned by the camera, see QualityGovernor
+	void set_volumetric_sample_scale(float scale);
+	void set_max_bloom_iterations(unsigned int max_iterations);
+
+	//texels of shadow maps rendered per frame, 0 renders every outdated shadow map immediately
+	void set_shadow_budget(long long texels);
+
+	const LightGrid* get_light_grid() const
+	{
+		return light_grid_;
+	}
 };
 
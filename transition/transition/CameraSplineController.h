@@ -1,6 +1,7 @@
 #pragma once
 #include "AnimatorNode.h"
-#include "BloomAddShader.h"
+#include "ShaderResource.h"
+#include "TextureResource.h"
 #include <spline_library/splines/uniform_cr_spline.h>
 #include <spline_library/vector.h>
 #include <glm/gtc/quaternion.hpp>
@@ -0,0 +1,131 @@
+#include "CascadedShadowStrategy.h"
+#include "RenderingEngine.h"
+#include "DirectionalDepthShader.h"
+#include "ILightShader.h"
+#include "ShadowAtlas.h"
+#include <glm/glm.hpp>
+
+//share of the logarithmic split scheme, the rest is split uniformly
+static const float logarithmic_split = 0.75f;
+
+CascadedShadowStrategy::CascadedShadowStrategy(const int shadow_map_size, const int num_cascades, const float shadow_distance, const float caster_distance)
+{
+	this->shadow_map_size_ = shadow_map_size;
+	this->num_cascades_ = glm::clamp(num_cascades, 2, max_cascades);
+	this->shadow_distance_ = shadow_distance;
+	this->caster_distance_ = caster_distance;
+	this->light_spaces_.resize(this->num_cascades_, glm::mat4(1.0f));
+	this->split_depths_ = glm::vec4(0.0f);
+}
+
+CascadedShadowStrategy::~CascadedShadowStrategy()
+{
+}
+
+void CascadedShadowStrategy::init(LightNode* light_node)
+{
+	light_node->set_viewport(glm::ivec2(this->shadow_map_size_, this->shadow_map_size_));
+}
+
+int CascadedShadowStrategy::update(const LightNode* light_node, const RenderingNode* camera)
+{
+	// near and far plane of the camera's perspective projection
+	const auto& projection = camera->get_projection_matrix();
+	const float camera_near = projection[3][2] / (projection[2][2] - 1.0f);
+	const float camera_far = projection[3][2] / (projection[2][2] + 1.0f);
+	const float shadow_far = glm::min(camera_far, this->shadow_distance_);
+	const glm::vec2 tan_half_fov = glm::vec2(1.0f / projection[0][0], 1.0f / projection[1][1]);
+	const glm::mat4 camera_to_world = glm::inverse(camera->get_view_matrix());
+
+	const glm::vec3 direction = glm::normalize(light_node->get_direction());
+	const glm::vec3 up = glm::abs(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	const glm::mat4 light_rotation = glm::lookAt(glm::vec3(0.0f), direction, up);
+	const glm::mat4 light_rotation_inv = glm::transpose(light_rotation);
+
+	const int region_size = light_node->get_rendering_engine()->get_shadow_atlas()->get_region_size(light_node);
+	const float texels = float(region_size > 0 ? region_size : this->shadow_map_size_);
+
+	int moved_faces = 0;
+	float split_near = camera_near;
+	for (int cascade = 0; cascade < this->num_cascades_; cascade++) {
+		const float ratio = float(cascade + 1) / float(this->num_cascades_);
+		const float split_uniform = camera_near + (shadow_far - camera_near) * ratio;
+		const float split_log = camera_near * glm::pow(shadow_far / camera_near, ratio);
+		const float split_far = glm::mix(split_uniform, split_log, logarithmic_split);
+
+		// bounding sphere of the slice of the frustum, its size does not depend on the orientation of the camera
+		const float center_depth = (split_near + split_far) * 0.5f;
+		const glm::vec3 far_corner = glm::vec3(tan_half_fov * split_far, -split_far);
+		const glm::vec3 near_corner = glm::vec3(tan_half_fov * split_near, -split_near);
+		float radius = glm::max(glm::distance(far_corner, glm::vec3(0.0f, 0.0f, -center_depth)), glm::distance(near_corner, glm::vec3(0.0f, 0.0f, -center_depth)));
+		radius = glm::ceil(radius * 16.0f) / 16.0f;
+		glm::vec3 center = glm::vec3(camera_to_world * glm::vec4(0.0f, 0.0f, -center_depth, 1.0f));
+
+		// moving the projection by whole texels only keeps the rasterization of the casters the same
+		const float texel_size = 2.0f * radius / texels;
+		glm::vec4 center_light = light_rotation * glm::vec4(center, 1.0f);
+		center_light.x = glm::floor(center_light.x / texel_size) * texel_size;
+		center_light.y = glm::floor(center_light.y / texel_size) * texel_size;
+		center = glm::vec3(light_rotation_inv * center_light);
+
+		const glm::mat4 view = glm::lookAt(center - direction * this->caster_distance_, center, up);
+		const glm::mat4 light_space = glm::ortho(-radius, radius, -radius, radius, 0.0f, this->caster_distance_ + radius) * view;
+		if (light_space != this->light_spaces_[cascade]) {
+			this->light_spaces_[cascade] = light_space;
+			moved_faces |= 1 << cascade;
+		}
+		this->split_depths_[cascade] = split_far;
+		split_near = split_far;
+	}
+	return moved_faces;
+}
+
+glm::mat4 CascadedShadowStrategy::get_light_space_matrix(const LightNode* light_node, const int face) const
+{
+	return this->light_spaces_[face];
+}
+
+bool CascadedShadowStrategy::is_caster_visible(const LightNode* light_node, const int face, const glm::vec3& center, const float radius) const
+{
+	// the projection is orthographic, the rows of the matrix give the scale of the bounding sphere along each axis
+	const auto& light_space = this->light_spaces_[face];
+	const glm::vec4 position = light_space * glm::vec4(center, 1.0f);
+	const float radius_xy = radius * glm::length(glm::vec3(light_space[0][0], light_space[1][0], light_space[2][0]));
+	const float radius_z = radius * glm::length(glm::vec3(light_space[0][2], light_space[1][2], light_space[2][2]));
+	return glm::abs(position.x) <= 1.0f + radius_xy && glm::abs(position.y) <= 1.0f + radius_xy && glm::abs(position.z) <= 1.0f + radius_z;
+}
+
+void CascadedShadowStrategy::before_render(const LightNode* light_node)
+{
+	const int face = light_node->get_shadow_face();
+	light_node->get_rendering_engine()->get_shadow_atlas()->begin_rendering(light_node, face, light_node->get_shadow_layer(), this->light_spaces_[face]);
+
+	const auto shader = light_node->get_shader();
+	shader->use();
+	shader->set_camera_uniforms(light_node);
+
+	if (!RE_CULLING) {
+		glEnable(GL_CULL_FACE);
+	}
+	glCullFace(GL_FRONT);
+}
+
+void CascadedShadowStrategy::after_render(const LightNode* light_node)
+{
+	if (!RE_CULLING) {
+		glDisable(GL_CULL_FACE);
+	}
+	glCullFace(GL_BACK);
+	light_node->get_rendering_engine()->get_shadow_atlas()->end_rendering();
+}
+
+ShaderResource* CascadedShadowStrategy::get_shader(const LightNode* light_node)
+{
+	return light_node->get_rendering_engine()->get_directional_depth_shader();
+}
+
+void CascadedShadowStrategy::set_uniforms(ILightShader* shader, LightNode* light_node)
+{
+	shader->set_shadow_map_uniforms(light_node, light_node->get_rendering_engine()->get_shadow_atlas()->get_first_view(light_node), this->caster_distance_, SHADOW_PROJECTION_LINEAR);
+	shader->set_cascade_uniforms(light_node, this->split_depths_);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "LightNode.h"
+#include <vector>
+
+/*
+Shadow strategy for directional lights splitting the view of the camera into 2-4 cascades along its depth.
+Each cascade is an own view in the shadow atlas with an orthographic projection around the bounding sphere
+of its part of the camera frustum, so the resolution is spent where the camera looks and near cascades are sharp.
+The sphere keeps the size of the projection constant while the camera turns, and its center is snapped to
+whole texels of the light, so the shadow edges do not shimmer while the camera moves.
+Casters are culled against the projection of each cascade, a cascade only renders again once it moved by a texel.
+*/
+class CascadedShadowStrategy : public IShadowStrategy
+{
+public:
+	static const int max_cascades = 4;
+
+private:
+	int shadow_map_size_;
+	int num_cascades_;
+	float shadow_distance_;
+	float caster_distance_;
+
+	std::vector<glm::mat4> light_spaces_;
+	glm::vec4 split_depths_;
+
+public:
+	//shadow_distance is the depth up to which the camera sees shadows, caster_distance how far casters may be in front of a cascade
+	explicit CascadedShadowStrategy(int shadow_map_size, int num_cascades = 3, float shadow_distance = 60.0f, float caster_distance = 150.0f);
+	~CascadedShadowStrategy();
+
+	void init(LightNode *light_node) override;
+	void before_render(const LightNode *light_node) override;
+	void after_render(const LightNode *light_node) override;
+
+	ShaderResource* get_shader(const LightNode *light_node) override;
+
+	void set_uniforms(ILightShader* shader, LightNode* light_node) override;
+	int update(const LightNode *light_node, const RenderingNode *camera) override;
+	glm::mat4 get_light_space_matrix(const LightNode *light_node, int face) const override;
+	bool is_caster_visible(const LightNode *light_node, int face, const glm::vec3& center, float radius) const override;
+
+	bool culls_faces() const override
+	{
+		return true;
+	}
+
+	float get_far_plane() const override
+	{
+		return this->caster_distance_;
+	}
+
+	int get_shadow_map_size() const override
+	{
+		return this->shadow_map_size_;
+	}
+
+	int get_num_faces() const override
+	{
+		return this->num_cascades_;
+	}
+};
+
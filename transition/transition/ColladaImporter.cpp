@@ -4,13 +4,22 @@
 #include "GeometryNode.h"
 #include "Material.h"
 #include "MeshResource.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 #include <iostream>
 #include "LightNode.h"
 #include "OmniDirectionalShadowStrategy.h"
 #include "DirectionalShadowStrategy.h"
+#include "CascadedShadowStrategy.h"
+#include "DualParaboloidShadowStrategy.h"
 
 ColladaImporter::ColladaImporter(RenderingEngine* engine) {
 	this->engine_ = engine;
+	this->paraboloid_shadows_ = false;
+}
+
+void ColladaImporter::set_paraboloid_shadows(const bool paraboloid_shadows) {
+	this->paraboloid_shadows_ = paraboloid_shadows;
 }
 
 ColladaImporter::~ColladaImporter() {
@@ -28,9 +37,17 @@ Node* ColladaImporter::load_node(const std::string& path) {
 	std::vector<Node*> lights;
 	std::vector<TextureResource*> textures;
 	std::vector<TextureResource*> alpha_textures;
+	std::map<unsigned int, MeshResource*> meshes;
 	process_lights(scene, lights);
 	GroupNode* node = new GroupNode(std::string(scene->mRootNode->mName.C_Str()));
-	process_node(scene->mRootNode, scene, lights, textures, alpha_textures, node);
+	this->statistics_ = MeshOptimizer::Statistics();
+	process_node(scene->mRootNode, scene, lights, textures, alpha_textures, meshes, node);
+#if _DEBUG
+	if (this->statistics_.triangles > 0) {
+		std::cout << "MeshOptimizer: " << path << ": " << this->statistics_.vertices_before << " -> " << this->statistics_.vertices_after << " vertices, ACMR "
+			<< this->statistics_.transformed_before / this->statistics_.triangles << " -> " << this->statistics_.transformed_after / this->statistics_.triangles << std::endl;
+	}
+#endif
 	return node;
 }
 
@@ -41,13 +58,23 @@ void ColladaImporter::process_lights(const aiScene* scene, std::vector<Node*>& l
 		IShadowStrategy *strategy = nullptr;
 		if (light->mType == aiLightSource_POINT) {
 			light_type = POINT_LIGHT;
-			if (light->mName.data[light->mName.length - 1] != '_') {
-				strategy = new OmniDirectionalShadowStrategy(1024);
+			const std::string name(light->mName.C_Str());
+			if (name.back() != '_') {
+				// secondary lights named "_dp" get by with two hemispheres instead of six cube faces
+				if (this->paraboloid_shadows_ || (name.size() > 3 && name.compare(name.size() - 3, 3, "_dp") == 0)) {
+					strategy = new DualParaboloidShadowStrategy(1024);
+				}
+				else {
+					strategy = new OmniDirectionalShadowStrategy(1024);
+				}
 			}
 		}
 		else if (light->mType == aiLightSource_DIRECTIONAL)
 		{
 			light_type = DIRECTIONAL_LIGHT;
+			if (light->mName.data[light->mName.length - 1] != '_') {
+				strategy = new CascadedShadowStrategy(1024);
+			}
 		}
 		else if (light->mType == aiLightSource_SPOT)
 		{
@@ -80,12 +107,22 @@ void ColladaImporter::process_lights(const aiScene* scene, std::vector<Node*>& l
 	}
 }
 
-void ColladaImporter::process_node(aiNode* node, const aiScene* scene, std::vector<Node*>& lights, std::vector<TextureResource*>& textures, std::vector<TextureResource*>& alpha_textures, GroupNode* parent) {
+void ColladaImporter::process_node(aiNode* node, const aiScene* scene, std::vector<Node*>& lights, std::vector<TextureResource*>& textures, std::vector<TextureResource*>& alpha_textures, std::map<unsigned int, MeshResource*>& meshes, GroupNode* parent) {
 
 	//Alle aktuellen Meshes durchgehen und Objekte erzeugen
 	for (int i = 0; i < node->mNumMeshes; i++) {
-		aiMesh* aiMesh = scene->mMeshes[node->mMeshes[i]];
-		MeshResource* mesh = process_mesh(aiMesh, scene, textures, alpha_textures);
+		MeshResource* mesh;
+		auto loaded = meshes.find(node->mMeshes[i]);
+		if (loaded == meshes.end()) {
+			aiMesh* aiMesh = scene->mMeshes[node->mMeshes[i]];
+			mesh = process_mesh(aiMesh, scene, textures, alpha_textures);
+			meshes[node->mMeshes[i]] = mesh;
+		}
+		else {
+			//Mesh wird mehrfach verwendet: Geometrie teilen, aber eigenes Material, da es pro Node veraendert werden kann
+			mesh = new MeshResource(loaded->second, loaded->second->get_material());
+			this->engine_->register_resource(mesh);
+		}
 		GeometryNode* geoNode = new GeometryNode(parent->get_name() + "_" + std::to_string(i), mesh);
 		parent->add_node(geoNode);
 	}
@@ -106,7 +143,7 @@ void ColladaImporter::process_node(aiNode* node, const aiScene* scene, std::vect
 		if (!light) {
 			if (name.at(name.length() - 1) != '_') {
 				GroupNode* sub = new GroupNode(std::string(node->mChildren[i]->mName.C_Str()));
-				process_node(node->mChildren[i], scene, lights, textures, alpha_textures, sub);
+				process_node(node->mChildren[i], scene, lights, textures, alpha_textures, meshes, sub);
 				parent->add_node(sub);
 			}
 		}
@@ -151,6 +188,10 @@ MeshResource* ColladaImporter::process_mesh(aiMesh* mesh, const aiScene* scene,
 		}
 	}
 
+	//Vertices zusammenfuehren und Reihenfolge fuer Vertex-Cache, Overdraw und Vertex-Fetch optimieren
+	int num_vertices = mesh->mNumVertices;
+	MeshOptimizer::optimize(vertices_positions, vertices_normals, vertices_uvs, num_vertices, indices, mesh->mNumFaces * 3, &this->statistics_);
+
 	Material material;
 	//Process materials
 	if (mesh->mMaterialIndex >= 0) {
@@ -236,7 +277,21 @@ MeshResource* ColladaImporter::process_mesh(aiMesh* mesh, const aiScene* scene,
 		material.set_ambient_color(material.get_ambient_color() * material.get_diffuse_color());
 	}
 
-	MeshResource* res = new MeshResource(vertices_positions, vertices_normals, vertices_uvs, mesh->mNumVertices, indices, mesh->mNumFaces*3, material);
+	MeshResource* res = new MeshResource(vertices_positions, vertices_normals, vertices_uvs, num_vertices, indices, mesh->mNumFaces*3, material);
+	res->set_arena(this->engine_->get_geometry_arena());
+
+	//Detailstufen erzeugen, jede mit etwa der Haelfte der Dreiecke der vorherigen, solange sich das noch lohnt
+	int lod_num_indices = mesh->mNumFaces * 3;
+	for (int lod = 1; lod < MeshResource::max_lods; lod++) {
+		float error;
+		auto lod_indices = MeshSimplifier::simplify(indices, mesh->mNumFaces * 3, vertices_positions, num_vertices, (mesh->mNumFaces * 3) >> lod, error);
+		if (lod_indices.size() > lod_num_indices * 3 / 4) {
+			break;
+		}
+		MeshOptimizer::optimize_vertex_cache(lod_indices.data(), int(lod_indices.size()), num_vertices);
+		res->add_lod(lod_indices, error);
+		lod_num_indices = int(lod_indices.size());
+	}
 	this->engine_->register_resource(res);
 	return res;
 }
@@ -7,6 +7,8 @@
 #include "TextureResource.h"
 #include "MeshResource.h"
 #include "RenderingEngine.h"
+#include "MeshOptimizer.h"
+#include <map>
 
 #define MODEL_LOADER_TEXTURE_DIRECTORY "assets/gfx/"
 
@@ -17,12 +19,17 @@ public:
 	//Destructor removes created textures.
 	~ColladaImporter();
 	Node* load_node(const std::string& path);
+	//point lights get dual-paraboloid instead of cube shadow maps, otherwise only those named with the suffix "_dp"
+	void set_paraboloid_shadows(bool paraboloid_shadows);
 
 private:
 	RenderingEngine* engine_;
+	bool paraboloid_shadows_;
+	//of the meshes of the current load_node, printed in debug builds
+	MeshOptimizer::Statistics statistics_;
 
 	void process_lights(const aiScene* scene, std::vector<Node*>& lights);
-	void process_node(aiNode* node, const aiScene* scene, std::vector<Node*>& lights, std::vector<TextureResource*>& textures, std::vector<TextureResource*>& alpha_textures, GroupNode* parent);
+	void process_node(aiNode* node, const aiScene* scene, std::vector<Node*>& lights, std::vector<TextureResource*>& textures, std::vector<TextureResource*>& alpha_textures, std::map<unsigned int, MeshResource*>& meshes, GroupNode* parent);
 	MeshResource* process_mesh(aiMesh* node, const aiScene* scene, std::vector<TextureResource*>& textures, std::vector<TextureResource*>& alpha_textures);
 	std::vector<TextureResource*> load_material_textures(aiMaterial* mat, aiTextureType type, std::vector<TextureResource*>& textures);
 };
\ No newline at end of file
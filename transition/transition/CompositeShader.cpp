@@ -0,0 +1,92 @@
+#include "CompositeShader.h"
+#include "TextureRenderable.h"
+#include <cassert>
+
+CompositeShader::CompositeShader() : ShaderResource("assets/shaders/volumetric_lighting_upsample.vs", "assets/shaders/composite.fs")
+{
+	this->scene_tex_uniform_ = -1;
+	this->volumetric_enabled_uniform_ = -1;
+	this->volumetric_tex_uniform_ = -1;
+	this->far_plane_uniform_ = -1;
+	this->near_plane_uniform_ = -1;
+	this->bloom_enabled_uniform_ = -1;
+	this->bloom_tex_uniform_ = -1;
+	this->addintensity_uniform_ = -1;
+	this->end_tex_enabled_uniform_ = -1;
+	this->end_tex_uniform_ = -1;
+	this->end_tex_intensity_uniform_ = -1;
+}
+
+CompositeShader::~CompositeShader()
+{
+}
+
+void CompositeShader::init()
+{
+	ShaderResource::init();
+
+	this->scene_tex_uniform_ = get_uniform("scene_tex");
+	this->volumetric_enabled_uniform_ = get_uniform("volumetric_enabled");
+	this->volumetric_tex_uniform_ = get_uniform("volumetric_tex");
+	this->near_plane_uniform_ = get_uniform("near_plane");
+	this->far_plane_uniform_ = get_uniform("far_plane");
+	this->bloom_enabled_uniform_ = get_uniform("bloom_enabled");
+	this->bloom_tex_uniform_ = get_uniform("bloom_tex");
+	this->addintensity_uniform_ = get_uniform("addintensity");
+	this->end_tex_enabled_uniform_ = get_uniform("end_tex_enabled");
+	this->end_tex_uniform_ = get_uniform("end_tex");
+	this->end_tex_intensity_uniform_ = get_uniform("end_tex_intensity");
+}
+
+void CompositeShader::set_camera_uniforms(const RenderingNode* node)
+{
+}
+
+void CompositeShader::set_model_uniforms(const GeometryNode* node)
+{
+}
+
+void CompositeShader::set_volumetric_texture(TextureRenderable* tex) const
+{
+	assert(volumetric_tex_uniform_ >= 0);
+	glUniform1i(volumetric_enabled_uniform_, tex != nullptr);
+	if (tex != nullptr) {
+		tex->bind(0);
+		glUniform1i(volumetric_tex_uniform_, 0);
+	}
+}
+
+void CompositeShader::set_scene_texture(TextureRenderable* tex) const
+{
+	assert(scene_tex_uniform_ >= 0);
+	tex->bind(1);
+	glUniform1i(scene_tex_uniform_, 1);
+}
+
+void CompositeShader::set_near_far_plane(const float near_plane, const float far_plane) const
+{
+	assert(near_plane_uniform_ >= 0);
+	assert(far_plane_uniform_ >= 0);
+	glUniform1f(near_plane_uniform_, near_plane);
+	glUniform1f(far_plane_uniform_, far_plane);
+}
+
+void CompositeShader::set_bloom(TextureRenderable* bloom_tex, const float addintensity) const
+{
+	glUniform1i(bloom_enabled_uniform_, bloom_tex != nullptr);
+	if (bloom_tex != nullptr) {
+		bloom_tex->bind(2);
+		glUniform1i(bloom_tex_uniform_, 2);
+		glUniform1f(addintensity_uniform_, addintensity);
+	}
+}
+
+void CompositeShader::set_end_texture(TextureRenderable* end_tex, const float end_tex_intensity) const
+{
+	glUniform1i(end_tex_enabled_uniform_, end_tex_intensity > 0.0f);
+	if (end_tex_intensity > 0.0f) {
+		end_tex->bind(3);
+		glUniform1i(end_tex_uniform_, 3);
+		glUniform1f(end_tex_intensity_uniform_, end_tex_intensity);
+	}
+}
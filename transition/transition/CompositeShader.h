@@ -0,0 +1,39 @@
+#pragma once
+#include "ShaderResource.h"
+
+class TextureRenderable;
+
+/*
+Shader for the last full screen pass: depth aware upsampling of the volumetric lighting, bloom and credits in one
+*/
+class CompositeShader :
+	public ShaderResource
+{
+	GLint volumetric_enabled_uniform_;
+	GLint volumetric_tex_uniform_;
+	GLint scene_tex_uniform_;
+	GLint near_plane_uniform_;
+	GLint far_plane_uniform_;
+	GLint bloom_enabled_uniform_;
+	GLint bloom_tex_uniform_;
+	GLint addintensity_uniform_;
+	GLint end_tex_enabled_uniform_;
+	GLint end_tex_uniform_;
+	GLint end_tex_intensity_uniform_;
+public:
+	CompositeShader();
+	~CompositeShader();
+
+	void init() override;
+
+	void set_camera_uniforms(const RenderingNode *node) override;
+	void set_model_uniforms(const GeometryNode *node) override;
+	//tex may be nullptr if no light is volumetric
+	void set_volumetric_texture(TextureRenderable *tex) const;
+	void set_scene_texture(TextureRenderable *tex) const;
+	void set_near_far_plane(const float near_plane, const float far_plane) const;
+	//bloom_tex may be nullptr if the bloom is disabled
+	void set_bloom(TextureRenderable *bloom_tex, float addintensity) const;
+	//end_tex is not read while end_tex_intensity is 0
+	void set_end_texture(TextureRenderable *end_tex, float end_tex_intensity) const;
+};
@@ -7,7 +7,6 @@ class ComputeShader : public IResource {
 private:
 	const char* path_;
 	GLuint program_id_;
-	static void check_compile_errors(GLuint shader, std::string type);
 
 protected:
 	GLint get_uniform(const std::string name) const;
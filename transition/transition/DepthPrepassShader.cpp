@@ -0,0 +1,80 @@
+#include "DepthPrepassShader.h"
+#include <cassert>
+#include "RenderingNode.h"
+#include "GeometryNode.h"
+#include "TextureResource.h"
+
+static const int alpha_texture_slot = 1;
+
+DepthPrepassShader::DepthPrepassShader() : ShaderResource("assets/shaders/depth_prepass.vs", "assets/shaders/depth_prepass.fs")
+{
+	this->model_uniform_ = -1;
+	this->view_uniform_ = -1;
+	this->projection_uniform_ = -1;
+	this->instanced_uniform_ = -1;
+	this->material_alpha_tex_uniform_ = -1;
+	this->material_has_alpha_tex_uniform_ = -1;
+	this->material_alpha_cutoff_ = -1;
+	this->material_opacity_ = -1;
+}
+
+DepthPrepassShader::~DepthPrepassShader()
+{
+}
+
+void DepthPrepassShader::init()
+{
+	ShaderResource::init();
+
+	this->model_uniform_ = get_uniform("mvp.model");
+	this->view_uniform_ = get_uniform("mvp.view");
+	this->projection_uniform_ = get_uniform("mvp.projection");
+	this->instanced_uniform_ = get_uniform("instanced");
+	this->material_alpha_tex_uniform_ = get_uniform("material.alpha_tex");
+	this->material_has_alpha_tex_uniform_ = get_uniform("material.has_alpha_tex");
+	this->material_alpha_cutoff_ = get_uniform("material.alpha_cutoff");
+	this->material_opacity_ = get_uniform("material.opacity");
+}
+
+void DepthPrepassShader::set_camera_uniforms(const RenderingNode* node)
+{
+	assert(this->view_uniform_ >= 0);
+	assert(this->projection_uniform_ >= 0);
+
+	glUniformMatrix4fv(this->view_uniform_, 1, GL_FALSE, &node->get_view_matrix()[0][0]);
+	glUniformMatrix4fv(this->projection_uniform_, 1, GL_FALSE, &node->get_projection_matrix()[0][0]);
+}
+
+void DepthPrepassShader::set_model_uniforms(const GeometryNode* node)
+{
+	assert(this->model_uniform_ >= 0);
+	assert(this->instanced_uniform_ >= 0);
+	glUniform1i(this->instanced_uniform_, 0);
+	glUniformMatrix4fv(this->model_uniform_, 1, GL_FALSE, &node->get_transformation()[0][0]);
+	set_material_uniforms(node);
+}
+
+bool DepthPrepassShader::set_instanced_model_uniforms(const GeometryNode* node)
+{
+	assert(this->instanced_uniform_ >= 0);
+	glUniform1i(this->instanced_uniform_, 1);
+	set_material_uniforms(node);
+	return true;
+}
+
+void DepthPrepassShader::set_material_uniforms(const GeometryNode* node)
+{
+	assert(this->material_has_alpha_tex_uniform_ >= 0);
+	assert(this->material_alpha_cutoff_ >= 0);
+	const auto& material = node->get_mesh_resource()->get_material();
+	if (material.has_alpha_texture()) {
+		material.get_alpha_texture()->bind(alpha_texture_slot);
+		glUniform1i(this->material_has_alpha_tex_uniform_, 1);
+		glUniform1i(this->material_alpha_tex_uniform_, alpha_texture_slot);
+	}
+	else {
+		glUniform1i(this->material_has_alpha_tex_uniform_, 0);
+	}
+	glUniform1f(this->material_alpha_cutoff_, material.get_alpha_cutoff());
+	glUniform1f(this->material_opacity_, material.get_opacity());
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "ShaderResource.h"
+
+/*
+Depth only shader for the depth pre-pass of the main camera. Computes the same positions as the MainShader
+and discards the same cut out fragments, so the main pass can test against its depth with GL_EQUAL.
+*/
+class DepthPrepassShader :
+	public ShaderResource
+{
+	GLint model_uniform_;
+	GLint view_uniform_;
+	GLint projection_uniform_;
+	GLint instanced_uniform_;
+	GLint material_alpha_tex_uniform_;
+	GLint material_has_alpha_tex_uniform_;
+	GLint material_alpha_cutoff_;
+	GLint material_opacity_;
+
+	void set_material_uniforms(const GeometryNode* node);
+public:
+	DepthPrepassShader();
+	~DepthPrepassShader();
+
+	void init() override;
+
+	void set_camera_uniforms(const RenderingNode* node) override;
+	void set_model_uniforms(const GeometryNode* node) override;
+	bool set_instanced_model_uniforms(const GeometryNode* node) override;
+};
@@ -1,6 +1,6 @@
 #include "DirectionalDepthShader.h"
 #include <cassert>
-#include "RenderingNode.h"
+#include "LightNode.h"
 #include "GeometryNode.h"
 #include "TextureResource.h"
 
@@ -8,6 +8,11 @@
 DirectionalDepthShader::DirectionalDepthShader() : ShaderResource("assets/shaders/depth_shader_directional.vs", "assets/shaders/depth_shader_directional.fs")
 {
 	this->mvp_uniform_ = -1;
+	this->view_projection_uniform_ = -1;
+	this->instanced_uniform_ = -1;
+	this->has_alpha_tex_uniform_ = -1;
+	this->alpha_tex_uniform_ = -1;
+	this->alpha_tex_enabled_ = false;
 }
 
 DirectionalDepthShader::~DirectionalDepthShader()
@@ -21,31 +26,53 @@ void DirectionalDepthShader::init()
 	this->mvp_uniform_ = get_uniform("mvp");
 	this->has_alpha_tex_uniform_ = get_uniform("has_alpha_tex");
 	this->alpha_tex_uniform_ = get_uniform("alpha_tex");
+	this->view_projection_uniform_ = get_uniform("view_projection");
+	this->instanced_uniform_ = get_uniform("instanced");
 
 }
 
-void DirectionalDepthShader::set_camera_uniforms(const RenderingNode* node)
+void DirectionalDepthShader::set_camera_uniforms(const RenderingNode* rendering_node)
 {
+	const auto node = static_cast<const LightNode*>(rendering_node);
 	assert(this->mvp_uniform_ >= 0);
+	assert(this->view_projection_uniform_ >= 0);
 
-	this->view_projection_ = node->get_projection_matrix()*node->get_view_matrix();
-
+	// cascades are rendered with their own light space
+	this->view_projection_ = node->get_shadow_strategy()->get_light_space_matrix(node, node->get_shadow_face());
+	glUniformMatrix4fv(this->view_projection_uniform_, 1, GL_FALSE, &this->view_projection_[0][0]);
 }
 
 void DirectionalDepthShader::set_model_uniforms(const GeometryNode* node)
 {
 	assert(this->mvp_uniform_ >= 0);
-	assert(this->has_alpha_tex_uniform_ >= 0);
-	assert(this->alpha_tex_uniform_ >= 0);
+	assert(this->instanced_uniform_ >= 0);
 	auto mvp = this->view_projection_*node->get_transformation();
+	glUniform1i(this->instanced_uniform_, 0);
 	glUniformMatrix4fv(this->mvp_uniform_, 1, GL_FALSE, &mvp[0][0]);
-	Material mat = node->get_mesh_resource()->get_material();
+	set_alpha_texture_uniforms(node);
+}
+
+bool DirectionalDepthShader::set_instanced_model_uniforms(const GeometryNode* node)
+{
+	assert(this->instanced_uniform_ >= 0);
+	glUniform1i(this->instanced_uniform_, 1);
+	set_alpha_texture_uniforms(node);
+	return true;
+}
+
+void DirectionalDepthShader::set_alpha_texture_uniforms(const GeometryNode* node)
+{
+	assert(this->has_alpha_tex_uniform_ >= 0);
+	assert(this->alpha_tex_uniform_ >= 0);
+	const Material& mat = node->get_mesh_resource()->get_material();
 	if (mat.has_alpha_texture()) {
 		glUniform1i(this->has_alpha_tex_uniform_, 1);
 		mat.get_alpha_texture()->bind(0);
 		glUniform1i(this->alpha_tex_uniform_, 0);
+		this->alpha_tex_enabled_ = true;
 	}
-	else {
+	else if (this->alpha_tex_enabled_) {
 		glUniform1i(this->has_alpha_tex_uniform_, 0);
+		this->alpha_tex_enabled_ = false;
 	}
 }
@@ -8,9 +8,15 @@ class DirectionalDepthShader :
 	public ShaderResource
 {
 	GLint mvp_uniform_;
+	GLint view_projection_uniform_;
+	GLint instanced_uniform_;
 	GLint has_alpha_tex_uniform_;
 	GLint alpha_tex_uniform_;
 	glm::mat4 view_projection_;
+	//value of has_alpha_tex in the program, opaque casters leave the material uniforms alone
+	bool alpha_tex_enabled_;
+
+	void set_alpha_texture_uniforms(const GeometryNode* node);
 public:
 	DirectionalDepthShader();
 	~DirectionalDepthShader();
@@ -19,5 +25,11 @@ public:
 
 	void set_camera_uniforms(const RenderingNode* node) override;
 	void set_model_uniforms(const GeometryNode* node) override;
+	bool set_instanced_model_uniforms(const GeometryNode* node) override;
+
+	bool is_depth_only() const override
+	{
+		return true;
+	}
 };
 
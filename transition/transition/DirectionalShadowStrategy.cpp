@@ -3,6 +3,7 @@
 #include "RenderingEngine.h"
 #include "DirectionalDepthShader.h"
 #include "ILightShader.h"
+#include "ShadowAtlas.h"
 #include <glm/glm.hpp>
 
 DirectionalShadowStrategy::DirectionalShadowStrategy(const int shadow_map_size, const float near_plane, const float far_plane)
@@ -10,9 +11,6 @@ DirectionalShadowStrategy::DirectionalShadowStrategy(const int shadow_map_size,
 	this->shadow_map_size_ = shadow_map_size;
 	this->near_plane_ = near_plane;
 	this->far_plane_ = far_plane;
-
-	this->depth_map_ = -1;
-	this->depth_map_fbo_ = -1;
 }
 
 DirectionalShadowStrategy::~DirectionalShadowStrategy()
@@ -32,31 +30,11 @@ void DirectionalShadowStrategy::init(LightNode* light_node)
 	{
 		light_node->set_projection_matrix(glm::ortho(-50.0f, 50.0f, -50.0f, 50.0f, this->near_plane_, this->far_plane_));
 	}
-
-	glGenFramebuffers(1, &this->depth_map_fbo_);
-	glGenTextures(1, &this->depth_map_);
-
-	glBindTexture(GL_TEXTURE_2D, this->depth_map_);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
-		this->shadow_map_size_, this->shadow_map_size_, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-	float border_color[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border_color);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, this->depth_map_fbo_);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->depth_map_, 0);
-	glDrawBuffer(GL_NONE);
-	glReadBuffer(GL_NONE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 void DirectionalShadowStrategy::before_render(const LightNode *light_node)
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, this->depth_map_fbo_);
-	glClear(GL_DEPTH_BUFFER_BIT);
+	light_node->get_rendering_engine()->get_shadow_atlas()->begin_rendering(light_node, 0, light_node->get_shadow_layer(), this->get_light_space_matrix(light_node, 0));
 
 	const auto shader = light_node->get_shader();
 	shader->use();
@@ -74,7 +52,12 @@ void DirectionalShadowStrategy::after_render(const LightNode *light_node)
 		glDisable(GL_CULL_FACE);
 	}
 	glCullFace(GL_BACK);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	light_node->get_rendering_engine()->get_shadow_atlas()->end_rendering();
+}
+
+glm::mat4 DirectionalShadowStrategy::get_light_space_matrix(const LightNode* light_node, const int face) const
+{
+	return light_node->get_projection_matrix() * light_node->get_view_matrix();
 }
 
 ShaderResource* DirectionalShadowStrategy::get_shader(const LightNode *light_node)
@@ -84,5 +67,5 @@ ShaderResource* DirectionalShadowStrategy::get_shader(const LightNode *light_nod
 
 void DirectionalShadowStrategy::set_uniforms(ILightShader* shader, LightNode* light_node)
 {
-	shader->set_directional_shadow_map_uniforms(light_node, this->depth_map_);
+	shader->set_shadow_map_uniforms(light_node, light_node->get_rendering_engine()->get_shadow_atlas()->get_first_view(light_node), this->far_plane_, SHADOW_PROJECTION_LINEAR);
 }
@@ -4,8 +4,6 @@
 class DirectionalShadowStrategy : public IShadowStrategy
 {
 	int shadow_map_size_;
-	GLuint depth_map_fbo_;
-	GLuint depth_map_;
 	float near_plane_;
 	float far_plane_;
 
@@ -20,5 +18,21 @@ public:
 	ShaderResource* get_shader(const LightNode *light_node) override;
 
 	void set_uniforms(ILightShader* shader, LightNode* light_node) override;
+	glm::mat4 get_light_space_matrix(const LightNode *light_node, int face) const override;
+
+	float get_far_plane() const override
+	{
+		return this->far_plane_;
+	}
+
+	int get_shadow_map_size() const override
+	{
+		return this->shadow_map_size_;
+	}
+
+	int get_num_faces() const override
+	{
+		return 1;
+	}
 };
 
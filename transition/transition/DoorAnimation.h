@@ -17,6 +17,7 @@ public:
 	explicit DoorAnimation(std::string name, Node* door1, glm::vec3 pos, float offset = 0, bool positive_dir = true, bool close_again = false) : AnimatorNode(name)
 	{
 		this->door1_ = door1;
+		this->door1_->set_dynamic(true);
 		this->pos_ = pos;
 		this->offset_ = offset;
 		this->positive_dir_ = positive_dir;
@@ -0,0 +1,66 @@
+#include <cassert>
+#include "LightNode.h"
+#include "GeometryNode.h"
+#include "DualParaboloidDepthShader.h"
+#include "DualParaboloidShadowStrategy.h"
+
+
+// the distance to the light is written like for cube faces, so the fragment shader is shared
+DualParaboloidDepthShader::DualParaboloidDepthShader() : ShaderResource("assets/shaders/depth_shader_dual_paraboloid.vs", "assets/shaders/depth_shader_omni_directional.fs")
+{
+	this->model_uniform_ = -1;
+	this->instanced_uniform_ = -1;
+	this->light_pos_uniform_ = -1;
+	this->far_plane_uniform_ = -1;
+	this->shadow_view_uniform_ = -1;
+}
+
+DualParaboloidDepthShader::~DualParaboloidDepthShader()
+{
+}
+
+void DualParaboloidDepthShader::init()
+{
+	ShaderResource::init();
+
+	this->model_uniform_ = get_uniform("model");
+	this->instanced_uniform_ = get_uniform("instanced");
+	this->light_pos_uniform_ = get_uniform("light_pos");
+	this->far_plane_uniform_ = get_uniform("far_plane");
+	this->shadow_view_uniform_ = get_uniform("shadow_view");
+}
+
+void DualParaboloidDepthShader::set_camera_uniforms(const RenderingNode* rendering_node)
+{
+	const auto &node = (LightNode*)rendering_node;
+
+	assert(this->model_uniform_ >= 0);
+	assert(this->light_pos_uniform_ >= 0);
+	assert(this->far_plane_uniform_ >= 0);
+	assert(this->shadow_view_uniform_ >= 0);
+
+	// one hemisphere is rendered per pass, into its own region of the shadow atlas
+	const auto view = node->get_shadow_strategy()->get_light_space_matrix(node, node->get_shadow_face());
+	glUniformMatrix4fv(this->shadow_view_uniform_, 1, GL_FALSE, &view[0][0]);
+
+	// static cast is okay, since it only makes sense to use DualParaboloidDepthShader with DualParaboloidShadowStrategy
+	const auto strategy = static_cast<DualParaboloidShadowStrategy*>(node->get_shadow_strategy());
+	assert(strategy != nullptr);
+	glUniform1f(this->far_plane_uniform_, strategy->get_far_plane());
+	glUniform3fv(this->light_pos_uniform_, 1, &node->get_position()[0]);
+}
+
+void DualParaboloidDepthShader::set_model_uniforms(const GeometryNode* node)
+{
+	assert(this->model_uniform_ >= 0);
+	assert(this->instanced_uniform_ >= 0);
+	glUniform1i(this->instanced_uniform_, 0);
+	glUniformMatrix4fv(this->model_uniform_, 1, GL_FALSE, &node->get_transformation()[0][0]);
+}
+
+bool DualParaboloidDepthShader::set_instanced_model_uniforms(const GeometryNode* node)
+{
+	assert(this->instanced_uniform_ >= 0);
+	glUniform1i(this->instanced_uniform_, 1);
+	return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "ShaderResource.h"
+#include <glm/glm.hpp>
+
+class LightNode;
+
+class DualParaboloidDepthShader :
+	public ShaderResource
+{
+	GLint model_uniform_;
+	GLint instanced_uniform_;
+	GLint light_pos_uniform_;
+	GLint far_plane_uniform_;
+	GLint shadow_view_uniform_;
+public:
+	DualParaboloidDepthShader();
+	~DualParaboloidDepthShader();
+
+	void init() override;
+
+	void set_camera_uniforms(const RenderingNode* node) override;
+	void set_model_uniforms(const GeometryNode* node) override;
+	bool set_instanced_model_uniforms(const GeometryNode* node) override;
+
+	bool is_depth_only() const override
+	{
+		return true;
+	}
+};
+
@@ -0,0 +1,75 @@
+#include "DualParaboloidShadowStrategy.h"
+#include "RenderingEngine.h"
+#include "ShaderResource.h"
+#include "DualParaboloidDepthShader.h"
+#include "ILightShader.h"
+#include "ShadowAtlas.h"
+
+DualParaboloidShadowStrategy::DualParaboloidShadowStrategy(const int shadow_map_size, const float far_plane)
+{
+	this->shadow_map_size_ = shadow_map_size;
+	this->far_plane_ = far_plane;
+}
+
+
+DualParaboloidShadowStrategy::~DualParaboloidShadowStrategy()
+{
+}
+
+void DualParaboloidShadowStrategy::init(LightNode* light_node)
+{
+	light_node->set_viewport(glm::ivec2(this->shadow_map_size_, this->shadow_map_size_));
+}
+
+glm::vec3 DualParaboloidShadowStrategy::get_forward(const LightNode* light_node)
+{
+	// point lights imported without direction look down
+	const glm::vec3 direction = light_node->get_direction();
+	return glm::length(direction) > 0.0f ? glm::normalize(direction) : glm::vec3(0.0f, -1.0f, 0.0f);
+}
+
+glm::mat4 DualParaboloidShadowStrategy::get_light_space_matrix(const LightNode* light_node, const int face) const
+{
+	const glm::vec3 forward = face == 0 ? get_forward(light_node) : -get_forward(light_node);
+	const glm::vec3 up = glm::abs(forward.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	const glm::vec3 light_pos = light_node->get_position();
+	return glm::lookAt(light_pos, light_pos + forward, up);
+}
+
+bool DualParaboloidShadowStrategy::is_caster_visible(const LightNode* light_node, const int face, const glm::vec3& center, const float radius) const
+{
+	// each hemisphere sees the half space in front of it
+	const glm::vec3 forward = face == 0 ? get_forward(light_node) : -get_forward(light_node);
+	return glm::dot(center - light_node->get_position(), forward) >= -radius;
+}
+
+void DualParaboloidShadowStrategy::before_render(const LightNode *light_node)
+{
+	const int face = light_node->get_shadow_face();
+	light_node->get_rendering_engine()->get_shadow_atlas()->begin_rendering(light_node, face, light_node->get_shadow_layer(), this->get_light_space_matrix(light_node, face));
+
+	const auto shader = light_node->get_shader();
+	shader->use();
+	shader->set_camera_uniforms(light_node);
+
+	// the depth shader clips everything behind the hemisphere
+	glEnable(GL_CLIP_DISTANCE0);
+	glCullFace(GL_FRONT);
+}
+
+void DualParaboloidShadowStrategy::after_render(const LightNode *light_node)
+{
+	glCullFace(GL_BACK);
+	glDisable(GL_CLIP_DISTANCE0);
+	light_node->get_rendering_engine()->get_shadow_atlas()->end_rendering();
+}
+
+ShaderResource* DualParaboloidShadowStrategy::get_shader(const LightNode *light_node)
+{
+	return light_node->get_rendering_engine()->get_dual_paraboloid_depth_shader();
+}
+
+void DualParaboloidShadowStrategy::set_uniforms(ILightShader* shader, LightNode* light_node)
+{
+	shader->set_shadow_map_uniforms(light_node, light_node->get_rendering_engine()->get_shadow_atlas()->get_first_view(light_node), this->far_plane_, SHADOW_PROJECTION_PARABOLOID);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "LightNode.h"
+
+/*
+Shadows of point lights in two paraboloid hemispheres instead of six cube faces, a third of the regions and passes.
+The vertices are projected onto the paraboloid, so the straight edges of large triangles close to the light bend
+and the shadows lose detail at the seam of the hemispheres, good enough for secondary lights.
+The first hemisphere looks along the direction of the light, the face matrices are view matrices only.
+*/
+class DualParaboloidShadowStrategy :
+	public IShadowStrategy
+{
+	int shadow_map_size_;
+	float far_plane_;
+
+	static glm::vec3 get_forward(const LightNode *light_node);
+public:
+	explicit DualParaboloidShadowStrategy(int shadow_map_size, float far_plane = 300.0f);
+	~DualParaboloidShadowStrategy();
+
+	void init(LightNode *light_node) override;
+	void before_render(const LightNode *light_node) override;
+	void after_render(const LightNode *light_node) override;
+	ShaderResource *get_shader(const LightNode *light_node) override;
+
+	void set_uniforms(ILightShader* shader, LightNode* light_node) override;
+	glm::mat4 get_light_space_matrix(const LightNode *light_node, int face) const override;
+	bool is_caster_visible(const LightNode *light_node, int face, const glm::vec3& center, float radius) const override;
+
+	float get_far_plane() const override
+	{
+		return this->far_plane_;
+	}
+
+	int get_shadow_map_size() const override
+	{
+		return this->shadow_map_size_;
+	}
+
+	int get_num_faces() const override
+	{
+		return 2;
+	}
+};
+
@@ -15,17 +15,21 @@ void DummyEffect::init(RenderingEngine * engine, CameraNode *camera)
 }
 
 
-void DummyEffect::perform_effect(const TextureFBO * from, GLuint fbo_to, const std::vector<LightNode *> light_nodes)
+int DummyEffect::add_passes(FrameGraph *graph, int from, const std::vector<LightNode *>& light_nodes)
 {
-	TextureRenderable * tex = from->get_texture(0);
-	shader_->use();
-	shader_->set_texture(tex);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo_to);
-	glViewport(0, 0, viewport_.x, viewport_.y);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glBindVertexArray(screenMesh_->get_resource_id());
-	glDrawElements(GL_TRIANGLES, screenMesh_->get_num_indices(), GL_UNSIGNED_INT, nullptr);
-	glBindVertexArray(0);
+	const int result = graph->create_texture("dummy", { viewport_, FrameGraph::FORMAT_COLOR });
+	graph->add_pass("dummy", { from }, { result }, [this, from, result](const FrameGraph& graph)
+	{
+		TextureRenderable * tex = graph.get_fbo(from)->get_texture(0);
+		shader_->use();
+		shader_->set_texture(tex);
 
+		glBindFramebuffer(GL_FRAMEBUFFER, graph.get_fbo_id(result));
+		glViewport(0, 0, viewport_.x, viewport_.y);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glBindVertexArray(screenMesh_->get_resource_id());
+		glDrawElements(GL_TRIANGLES, screenMesh_->get_num_indices(), screenMesh_->get_index_type(), nullptr);
+		glBindVertexArray(0);
+	});
+	return result;
 }
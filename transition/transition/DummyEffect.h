@@ -17,6 +17,6 @@ public:
 
 	virtual void init(RenderingEngine *engine, CameraNode *camera) override;
 
-	virtual void perform_effect(const TextureFBO *from, GLuint fbo_to, const std::vector<LightNode *> light_nodes) override;
+	virtual int add_passes(FrameGraph *graph, int from, const std::vector<LightNode *>& light_nodes) override;
 
 };
\ No newline at end of file
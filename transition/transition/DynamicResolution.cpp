@@ -0,0 +1,56 @@
+#include "DynamicResolution.h"
+#include "FrameTimer.h"
+#include <glm/glm.hpp>
+
+//frames below raise_threshold of the budget before the scale goes up one step
+static const int raise_frames = 30;
+static const float raise_threshold = 0.8f;
+//weight of the newest frame time in the smoothed one
+static const float smoothing = 0.2f;
+
+DynamicResolution::DynamicResolution(const float budget, const float min_scale)
+{
+	this->budget_ = budget;
+	this->min_scale_ = min_scale;
+	this->scale_ = 1.0f;
+	this->frame_time_ = 0.0f;
+	this->headroom_frames_ = 0;
+	this->settle_frames_ = 0;
+}
+
+void DynamicResolution::update(const float frame_time)
+{
+	if (this->settle_frames_ > 0) {
+		this->settle_frames_--;
+		return;
+	}
+	this->frame_time_ = this->frame_time_ > 0.0f ? glm::mix(this->frame_time_, frame_time, smoothing) : frame_time;
+
+	// a single slow frame already drops the scale, a heavy shot should not stutter until the average catches up
+	const float time = glm::max(this->frame_time_, frame_time);
+	if (time > this->budget_) {
+		const float scale = this->scale_ * glm::sqrt(this->budget_ / time);
+		this->set_scale(glm::max(glm::floor(scale / scale_step + 0.001f) * scale_step, this->min_scale_));
+		return;
+	}
+
+	if (this->frame_time_ < raise_threshold * this->budget_ && this->scale_ < 1.0f) {
+		if (++this->headroom_frames_ >= raise_frames) {
+			this->set_scale(glm::min(this->scale_ + scale_step, 1.0f));
+		}
+	} else {
+		this->headroom_frames_ = 0;
+	}
+}
+
+void DynamicResolution::set_scale(const float scale)
+{
+	this->headroom_frames_ = 0;
+	if (scale == this->scale_) {
+		return;
+	}
+	this->scale_ = scale;
+	// the frames in flight were rendered at the old scale
+	this->frame_time_ = 0.0f;
+	this->settle_frames_ = FrameTimer::num_queries;
+}
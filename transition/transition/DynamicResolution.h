@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+Chooses the share of the window resolution the camera renders at, so the frames fit the budget.
+Shading cost grows with the pixel count, so the scale follows the square root of budget over smoothed frame time.
+It drops as soon as a frame is over budget and only rises after a run of frames with clear headroom, in steps of
+scale_step, so render targets are not reallocated every frame.
+*/
+class DynamicResolution
+{
+public:
+	static constexpr float scale_step = 0.05f;
+
+private:
+	float budget_;			//gpu milliseconds per frame
+	float min_scale_;
+	float scale_;
+	float frame_time_;		//smoothed gpu milliseconds, 0 before the first result
+	int headroom_frames_;
+	//results still measuring the previous scale, ignored after a change
+	int settle_frames_;
+
+	void set_scale(float scale);
+public:
+	//budget in gpu milliseconds per frame, the scale stays between min_scale and 1
+	explicit DynamicResolution(float budget, float min_scale = 0.5f);
+
+	//frame_time in gpu milliseconds, from FrameTimer
+	void update(float frame_time);
+
+	float get_scale() const
+	{
+		return scale_;
+	}
+
+	float get_min_scale() const
+	{
+		return min_scale_;
+	}
+};
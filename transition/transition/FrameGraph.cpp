@@ -0,0 +1,171 @@
+#include "FrameGraph.h"
+#include "TextureFBO.h"
+#include <cassert>
+#include <algorithm>
+
+FrameGraph::FrameGraph()
+{
+	this->compiled_ = false;
+}
+
+FrameGraph::~FrameGraph()
+{
+	for (auto& pooled : this->pool_) {
+		delete pooled.fbo;
+	}
+}
+
+void FrameGraph::reset()
+{
+	this->textures_.clear();
+	this->passes_.clear();
+	this->compiled_ = false;
+}
+
+int FrameGraph::create_texture(const std::string& name, const TextureDesc& desc)
+{
+	this->textures_.push_back({ name, desc, nullptr, false, false, -1, -1 });
+	return int(this->textures_.size()) - 1;
+}
+
+int FrameGraph::import_texture(const std::string& name, TextureFBO* fbo)
+{
+	assert(fbo != nullptr);
+	const TextureDesc desc = { fbo->get_size(), FORMAT_COLOR };
+	this->textures_.push_back({ name, desc, fbo, true, false, -1, -1 });
+	return int(this->textures_.size()) - 1;
+}
+
+int FrameGraph::import_screen(const std::string& name, const glm::ivec2& size)
+{
+	const TextureDesc desc = { size, FORMAT_COLOR };
+	this->textures_.push_back({ name, desc, nullptr, true, false, -1, -1 });
+	return int(this->textures_.size()) - 1;
+}
+
+void FrameGraph::set_output(const int texture)
+{
+	this->textures_[texture].output = true;
+}
+
+void FrameGraph::add_pass(const std::string& name, const std::vector<int>& reads, const std::vector<int>& writes, const Execute& execute)
+{
+	assert(!this->compiled_);
+	this->passes_.push_back({ name, reads, writes, execute, false });
+}
+
+void FrameGraph::compile()
+{
+	// walking back from the outputs, a pass runs if a texture it writes is still needed by a later pass,
+	// the earlier contents of what it writes are not needed any more, but what it reads is
+	std::vector<bool> needed(this->textures_.size());
+	for (size_t i = 0; i < this->textures_.size(); i++) {
+		needed[i] = this->textures_[i].output;
+	}
+	for (int i = int(this->passes_.size()) - 1; i >= 0; i--) {
+		auto& pass = this->passes_[i];
+		pass.culled = std::none_of(pass.writes.begin(), pass.writes.end(), [&needed](const int texture) { return needed[texture]; });
+		if (pass.culled) {
+			continue;
+		}
+		for (auto texture : pass.writes) {
+			needed[texture] = false;
+		}
+		for (auto texture : pass.reads) {
+			needed[texture] = true;
+		}
+	}
+
+	// lifetimes of the textures over the passes that run
+	for (int i = 0; i < int(this->passes_.size()); i++) {
+		const auto& pass = this->passes_[i];
+		if (pass.culled) {
+			continue;
+		}
+		const auto use = [this, i](const int texture)
+		{
+			auto& entry = this->textures_[texture];
+			if (entry.first_use < 0) {
+				entry.first_use = i;
+			}
+			entry.last_use = i;
+		};
+		std::for_each(pass.reads.begin(), pass.reads.end(), use);
+		std::for_each(pass.writes.begin(), pass.writes.end(), use);
+	}
+
+	// transient textures are assigned in the order they are first used, so a framebuffer is handed on when free
+	for (auto& pooled : this->pool_) {
+		pooled.free_from = 0;
+		pooled.unused_frames++;
+	}
+	std::vector<int> order;
+	for (int i = 0; i < int(this->textures_.size()); i++) {
+		if (!this->textures_[i].imported && this->textures_[i].first_use >= 0) {
+			order.push_back(i);
+		}
+	}
+	std::stable_sort(order.begin(), order.end(), [this](const int a, const int b) { return this->textures_[a].first_use < this->textures_[b].first_use; });
+	for (auto texture : order) {
+		auto& entry = this->textures_[texture];
+		entry.fbo = this->acquire(entry.desc, entry.first_use, entry.last_use);
+	}
+
+	for (auto it = this->pool_.begin(); it != this->pool_.end();) {
+		if (it->unused_frames >= max_unused_frames) {
+			delete it->fbo;
+			it = this->pool_.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	this->compiled_ = true;
+}
+
+TextureFBO* FrameGraph::acquire(const TextureDesc& desc, const int first_use, const int last_use)
+{
+	for (auto& pooled : this->pool_) {
+		if (pooled.free_from <= first_use && pooled.desc.format == desc.format && pooled.desc.size == desc.size) {
+			pooled.free_from = last_use + 1;
+			pooled.unused_frames = 0;
+			return pooled.fbo;
+		}
+	}
+
+	auto fbo = new TextureFBO(desc.size.x, desc.size.y, 1);
+	if (desc.format == FORMAT_DEPTH) {
+		fbo->init_depth();
+	} else {
+		fbo->init_color(false, false);
+	}
+	this->pool_.push_back({ desc, fbo, last_use + 1, 0 });
+	return fbo;
+}
+
+void FrameGraph::execute() const
+{
+	assert(this->compiled_);
+	for (const auto& pass : this->passes_) {
+		if (!pass.culled) {
+			pass.execute(*this);
+		}
+	}
+}
+
+TextureFBO* FrameGraph::get_fbo(const int texture) const
+{
+	assert(this->compiled_ && (this->textures_[texture].imported || this->textures_[texture].fbo != nullptr));
+	return this->textures_[texture].fbo;
+}
+
+GLuint FrameGraph::get_fbo_id(const int texture) const
+{
+	const auto fbo = this->get_fbo(texture);
+	return fbo != nullptr ? fbo->get_fbo_id() : 0;
+}
+
+glm::ivec2 FrameGraph::get_size(const int texture) const
+{
+	return this->textures_[texture].desc.size;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "glheaders.h"
+#include <glm/glm.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+class TextureFBO;
+
+/*
+Runs the post processing passes of a frame, declared with the textures each of them reads and writes.
+A pass reads what the last pass before it wrote to a texture, so a pass may read and write the same texture.
+compile() skips every pass whose written textures are neither read by a later pass that runs nor marked as output, then
+assigns framebuffers from a pool to the transient textures: textures of equal size and format share one framebuffer
+if their lifetimes, from the first to the last pass using them, do not overlap. The pool is kept between frames, so
+a graph declared the same way every frame allocates nothing after the first one, framebuffers of sizes which are
+not asked for any more (e.g. after the render resolution changed) are deleted after a while.
+*/
+class FrameGraph
+{
+public:
+	enum Format
+	{
+		FORMAT_COLOR = 1,	//one RGBA8 texture without depth attachment
+		FORMAT_DEPTH = 2	//one depth texture
+	};
+
+	struct TextureDesc
+	{
+		glm::ivec2 size;
+		Format format;
+	};
+
+	typedef std::function<void(const FrameGraph&)> Execute;
+
+	static const int max_unused_frames = 120;
+
+private:
+	struct Texture
+	{
+		std::string name;
+		TextureDesc desc;
+		TextureFBO *fbo;		//imported or assigned by compile, nullptr for the default framebuffer
+		bool imported;
+		bool output;
+		int first_use;
+		int last_use;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		std::vector<int> reads;
+		std::vector<int> writes;
+		Execute execute;
+		bool culled;
+	};
+
+	struct PooledFBO
+	{
+		TextureDesc desc;
+		TextureFBO *fbo;
+		int free_from;			//first pass of the frame that may use it
+		int unused_frames;		//compiles since it was last assigned, deleted at max_unused_frames
+	};
+
+	std::vector<Texture> textures_;
+	std::vector<Pass> passes_;
+	std::vector<PooledFBO> pool_;
+	bool compiled_;
+
+	TextureFBO* acquire(const TextureDesc& desc, int first_use, int last_use);
+public:
+	FrameGraph();
+	~FrameGraph();
+
+	//forgets the passes and textures of the last frame, the pooled framebuffers are kept
+	void reset();
+
+	//a texture owned by the graph, it only lives during the passes using it
+	int create_texture(const std::string& name, const TextureDesc& desc);
+	//a framebuffer living outside the graph
+	int import_texture(const std::string& name, TextureFBO *fbo);
+	//the default framebuffer
+	int import_screen(const std::string& name, const glm::ivec2& size);
+	void set_output(int texture);
+
+	void add_pass(const std::string& name, const std::vector<int>& reads, const std::vector<int>& writes, const Execute& execute);
+
+	void compile();
+	void execute() const;
+
+	//only valid inside the execute function of a pass using the texture
+	TextureFBO* get_fbo(int texture) const;
+	//0 for the default framebuffer
+	GLuint get_fbo_id(int texture) const;
+	glm::ivec2 get_size(int texture) const;
+};
@@ -0,0 +1,44 @@
+#include "FrameTimer.h"
+
+FrameTimer::FrameTimer()
+{
+	glGenQueries(num_queries, this->queries_);
+	this->frame_ = 0;
+	this->frame_time_ = 0.0f;
+	this->has_frame_time_ = false;
+}
+
+FrameTimer::~FrameTimer()
+{
+	glDeleteQueries(num_queries, this->queries_);
+}
+
+void FrameTimer::begin_frame()
+{
+	// the query about to be reused was issued num_queries frames ago and is usually done by now
+	const GLuint query = this->queries_[this->frame_ % num_queries];
+	this->has_frame_time_ = false;
+	if (this->frame_ >= num_queries) {
+		GLint available = 0;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available) {
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+			this->frame_time_ = float(elapsed) / 1000000.0f;
+			this->has_frame_time_ = true;
+		}
+	}
+	glBeginQuery(GL_TIME_ELAPSED, query);
+}
+
+void FrameTimer::end_frame()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	this->frame_++;
+}
+
+bool FrameTimer::get_frame_time(float& milliseconds) const
+{
+	milliseconds = this->frame_time_;
+	return this->has_frame_time_;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "glheaders.h"
+
+/*
+Measures the gpu time of every frame with a ring of timer queries. A query is read when it is about to be reused,
+num_queries frames after it was issued, so reading never waits for the gpu; a result not available by then is dropped.
+*/
+class FrameTimer
+{
+public:
+	static const int num_queries = 4;
+
+private:
+	GLuint queries_[num_queries];
+	int frame_;
+	float frame_time_;		//gpu milliseconds of the frame read by the last begin_frame
+	bool has_frame_time_;
+
+public:
+	FrameTimer();
+	~FrameTimer();
+
+	//bracket the gpu work of one frame
+	void begin_frame();
+	void end_frame();
+
+	//false if begin_frame read no result, the frame time belongs to a frame num_queries frames back
+	bool get_frame_time(float& milliseconds) const;
+};
@@ -0,0 +1,184 @@
+#include "GeometryArena.h"
+#include "VertexFormat.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+
+static const int initial_vertex_capacity = 1 << 18;
+static const GLsizeiptr initial_index_capacity = 1 << 21;
+
+GeometryArena::GeometryArena()
+{
+	this->vao_ = -1;
+	this->indirect_vao_ = -1;
+	this->depth_vao_ = -1;
+	this->depth_indirect_vao_ = -1;
+	this->vbo_positions_ = -1;
+	this->vbo_attributes_ = -1;
+	this->ebo_ = -1;
+	this->vbo_instances_ = -1;
+
+	this->num_vertices_ = 0;
+	this->vertex_capacity_ = 0;
+	this->index_size_ = 0;
+	this->index_capacity_ = 0;
+}
+
+GeometryArena::~GeometryArena()
+{
+	if (this->vao_ != -1) {
+		glDeleteVertexArrays(1, &this->vao_);
+		glDeleteVertexArrays(1, &this->indirect_vao_);
+		glDeleteVertexArrays(1, &this->depth_vao_);
+		glDeleteVertexArrays(1, &this->depth_indirect_vao_);
+		glDeleteBuffers(1, &this->vbo_positions_);
+		glDeleteBuffers(1, &this->vbo_attributes_);
+		glDeleteBuffers(1, &this->ebo_);
+		glDeleteBuffers(1, &this->vbo_instances_);
+	}
+}
+
+void GeometryArena::init()
+{
+	this->vertex_capacity_ = initial_vertex_capacity;
+	this->index_capacity_ = initial_index_capacity;
+
+	glGenVertexArrays(1, &this->vao_);
+	glGenVertexArrays(1, &this->indirect_vao_);
+	glGenVertexArrays(1, &this->depth_vao_);
+	glGenVertexArrays(1, &this->depth_indirect_vao_);
+	glGenBuffers(1, &this->vbo_positions_);
+	glGenBuffers(1, &this->vbo_attributes_);
+	glGenBuffers(1, &this->ebo_);
+	glGenBuffers(1, &this->vbo_instances_);
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->vbo_positions_);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * this->vertex_capacity_, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, this->vbo_attributes_);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(VertexFormat::PackedAttributes) * this->vertex_capacity_, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, this->ebo_);
+	glBufferData(GL_ARRAY_BUFFER, this->index_capacity_, nullptr, GL_STATIC_DRAW);
+
+	//one instance, so the attributes are valid for non-instanced draws too
+	glBindBuffer(GL_ARRAY_BUFFER, this->vbo_instances_);
+	const glm::mat4 identity[2] = { glm::mat4(1.0f), glm::mat4(1.0f) };
+	glBufferData(GL_ARRAY_BUFFER, sizeof(identity), identity, GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	setup_all_vertex_attributes();
+	setup_instance_attributes(this->vao_, this->vbo_instances_);
+	setup_instance_attributes(this->indirect_vao_, this->vbo_instances_);
+	setup_instance_attributes(this->depth_vao_, this->vbo_instances_);
+	setup_instance_attributes(this->depth_indirect_vao_, this->vbo_instances_);
+}
+
+void GeometryArena::allocate(const float* positions, const float* uvs, const float* normals, const int num_vertices, const unsigned int* indices, const int num_indices, int& base_vertex, GLintptr& index_offset, GLenum& index_type)
+{
+	// indices are relative to the base vertex, so most meshes fit into 16 bit
+	index_type = VertexFormat::get_index_type(num_vertices);
+	const auto packed_attributes = VertexFormat::pack_attributes(uvs, normals, num_vertices);
+
+	if (this->num_vertices_ + num_vertices > this->vertex_capacity_) {
+		const int capacity = std::max(this->vertex_capacity_ * 2, this->num_vertices_ + num_vertices);
+		this->vbo_positions_ = grow(this->vbo_positions_, sizeof(float) * 3 * this->num_vertices_, sizeof(float) * 3 * capacity);
+		this->vbo_attributes_ = grow(this->vbo_attributes_, sizeof(VertexFormat::PackedAttributes) * this->num_vertices_, sizeof(VertexFormat::PackedAttributes) * capacity);
+		this->vertex_capacity_ = capacity;
+		setup_all_vertex_attributes();
+	}
+
+	base_vertex = this->num_vertices_;
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->vbo_positions_);
+	glBufferSubData(GL_ARRAY_BUFFER, sizeof(float) * 3 * base_vertex, sizeof(float) * 3 * num_vertices, positions);
+	glBindBuffer(GL_ARRAY_BUFFER, this->vbo_attributes_);
+	glBufferSubData(GL_ARRAY_BUFFER, sizeof(VertexFormat::PackedAttributes) * base_vertex, sizeof(VertexFormat::PackedAttributes) * num_vertices, packed_attributes.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	this->num_vertices_ += num_vertices;
+
+	index_offset = this->allocate_indices(indices, num_indices, index_type);
+}
+
+GLintptr GeometryArena::allocate_indices(const unsigned int* indices, const int num_indices, const GLenum index_type)
+{
+	const int index_size = VertexFormat::get_index_size(index_type);
+	const auto packed_indices = VertexFormat::pack_indices(indices, num_indices, index_type);
+
+	// ranges of both index types share the buffer, each one aligned to its own index size
+	const GLsizeiptr aligned_index_size = (this->index_size_ + index_size - 1) / index_size * index_size;
+
+	if (aligned_index_size + GLsizeiptr(packed_indices.size()) > this->index_capacity_) {
+		const GLsizeiptr capacity = std::max(this->index_capacity_ * 2, aligned_index_size + GLsizeiptr(packed_indices.size()));
+		this->ebo_ = grow(this->ebo_, this->index_size_, capacity);
+		this->index_capacity_ = capacity;
+		setup_all_vertex_attributes();
+	}
+
+	const GLintptr index_offset = aligned_index_size;
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->ebo_);
+	glBufferSubData(GL_ARRAY_BUFFER, index_offset, packed_indices.size(), packed_indices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	this->index_size_ = index_offset + packed_indices.size();
+	return index_offset;
+}
+
+void GeometryArena::set_indirect_instance_buffer(const GLuint buffer)
+{
+	setup_instance_attributes(this->indirect_vao_, buffer);
+	setup_instance_attributes(this->depth_indirect_vao_, buffer);
+}
+
+GLuint GeometryArena::grow(const GLuint buffer, const GLsizeiptr used_size, const GLsizeiptr new_size)
+{
+	GLuint grown;
+	glGenBuffers(1, &grown);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+	glBufferData(GL_COPY_WRITE_BUFFER, new_size, nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used_size);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	glDeleteBuffers(1, &buffer);
+	return grown;
+}
+
+void GeometryArena::setup_vertex_attributes(const GLuint vao, const bool positions_only) const
+{
+	glBindVertexArray(vao);
+
+	if (positions_only) {
+		VertexFormat::setup_position_attribute(this->vbo_positions_);
+	}
+	else {
+		VertexFormat::setup_attributes(this->vbo_positions_, this->vbo_attributes_);
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->ebo_);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryArena::setup_all_vertex_attributes() const
+{
+	setup_vertex_attributes(this->vao_, false);
+	setup_vertex_attributes(this->indirect_vao_, false);
+	setup_vertex_attributes(this->depth_vao_, true);
+	setup_vertex_attributes(this->depth_indirect_vao_, true);
+}
+
+void GeometryArena::setup_instance_attributes(const GLuint vao, const GLuint buffer)
+{
+	glBindVertexArray(vao);
+
+	//Bind per-instance model matrix to Shader-Location 3-6 and normal matrix to 7-10
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	for (int i = 0; i < 8; i++) {
+		glEnableVertexAttribArray(3 + i);
+		glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::mat4), reinterpret_cast<void*>(i * sizeof(glm::vec4)));
+		glVertexAttribDivisor(3 + i, 1);
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "glheaders.h"
+
+/*
+One set of vertex and index buffers shared by all scene meshes. Meshes get a range (base vertex and first index)
+suballocated from it instead of creating their own buffers, so all of them can be drawn from a single vao,
+which is what multi-draw-indirect needs. The buffers grow on demand.
+The depth vaos read the same buffers, but only the positions.
+*/
+class GeometryArena
+{
+	GLuint vao_;
+	GLuint indirect_vao_;
+	GLuint depth_vao_;
+	GLuint depth_indirect_vao_;
+	GLuint vbo_positions_;
+	GLuint vbo_attributes_;
+	GLuint ebo_;
+	GLuint vbo_instances_;
+
+	int num_vertices_;
+	int vertex_capacity_;
+	GLsizeiptr index_size_;
+	GLsizeiptr index_capacity_;
+
+	static GLuint grow(GLuint buffer, GLsizeiptr used_size, GLsizeiptr new_size);
+	void setup_vertex_attributes(GLuint vao, bool positions_only) const;
+	void setup_all_vertex_attributes() const;
+	static void setup_instance_attributes(GLuint vao, GLuint buffer);
+public:
+	GeometryArena();
+	~GeometryArena();
+
+	void init();
+
+	//copies the mesh into the arena in the packed VertexFormat, returns the base vertex, the byte offset of the first index and the index type
+	void allocate(const float *positions, const float *uvs, const float *normals, int num_vertices, const unsigned int *indices, int num_indices, int& base_vertex, GLintptr& index_offset, GLenum& index_type);
+
+	//copies additional indices for already allocated vertices (e.g. levels of detail), returns the byte offset of the first index
+	GLintptr allocate_indices(const unsigned int *indices, int num_indices, GLenum index_type);
+
+	//vao with per-instance model matrices from the streaming instance buffer
+	GLuint get_vao() const
+	{
+		return vao_;
+	}
+
+	//same vertex data, but the per-instance model matrices are read from the given buffer (e.g. one entry per object for indirect draws)
+	GLuint get_indirect_vao() const
+	{
+		return indirect_vao_;
+	}
+
+	GLuint get_instance_buffer() const
+	{
+		return vbo_instances_;
+	}
+
+	//same as the vaos above, but only the positions are read, for depth-only shaders
+	GLuint get_depth_vao() const
+	{
+		return depth_vao_;
+	}
+
+	GLuint get_depth_indirect_vao() const
+	{
+		return depth_indirect_vao_;
+	}
+
+	void set_indirect_instance_buffer(GLuint buffer);
+};
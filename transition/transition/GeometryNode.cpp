@@ -12,7 +12,7 @@ GeometryNode::~GeometryNode()
 
 std::vector<IDrawable*> GeometryNode::get_drawables()
 {
-	if (resource_->get_material().has_alpha_texture()) {
+	if (batched_ || resource_->get_material().has_alpha_texture()) {
 		return{};
 	}
 	else {
@@ -31,11 +31,57 @@ std::vector<IDrawable*> GeometryNode::get_transparent_drawables()
 }
 
 void GeometryNode::draw(ShaderResource *shader) const
+{
+	this->draw_lod(shader, 0);
+}
+
+void GeometryNode::draw_culled(ShaderResource *shader, FrustumG *frustum, const LodSelection& lod) const
+{
+	this->draw_lod(shader, this->select_lod(lod));
+}
+
+void GeometryNode::draw_lod(ShaderResource *shader, const int lod) const
 {
 	shader->set_model_uniforms(this);
 
-	glBindVertexArray(this->resource_->get_resource_id());
-	glDrawElements(GL_TRIANGLES, this->resource_->get_num_indices(), GL_UNSIGNED_INT, nullptr);
+	const bool depth_stream = this->uses_depth_stream(shader);
+	glBindVertexArray(depth_stream ? this->resource_->get_depth_resource_id() : this->resource_->get_resource_id());
+	const auto index_offset = depth_stream ? this->resource_->get_lod_depth_index_offset(lod) : this->resource_->get_lod_index_offset(lod);
+	glDrawElementsBaseVertex(GL_TRIANGLES, this->resource_->get_lod_num_indices(lod), this->resource_->get_index_type(), index_offset, this->resource_->get_base_vertex());
+	glBindVertexArray(0);
+}
+
+bool GeometryNode::uses_depth_stream(const ShaderResource* shader) const
+{
+	// alpha tested casters need their uvs
+	return shader->is_depth_only() && !this->resource_->get_material().has_alpha_texture();
+}
+
+int GeometryNode::select_lod(const LodSelection& lod) const
+{
+	return this->resource_->select_lod(lod, this->get_position(), this->get_bounding_sphere_radius(), this->scale_);
+}
+
+void GeometryNode::draw_instanced(ShaderResource *shader, const std::vector<const IDrawable*>& instances, const int lod) const
+{
+	if (!shader->set_instanced_model_uniforms(this)) {
+		for (auto& instance : instances) {
+			static_cast<const GeometryNode*>(instance)->draw_lod(shader, lod);
+		}
+		return;
+	}
+
+	std::vector<glm::mat4> transformations;
+	transformations.reserve(instances.size());
+	for (auto& instance : instances) {
+		transformations.push_back(instance->get_transformation());
+	}
+	this->resource_->set_instance_transformations(transformations);
+
+	const bool depth_stream = this->uses_depth_stream(shader);
+	glBindVertexArray(depth_stream ? this->resource_->get_depth_resource_id() : this->resource_->get_resource_id());
+	const auto index_offset = depth_stream ? this->resource_->get_lod_depth_index_offset(lod) : this->resource_->get_lod_index_offset(lod);
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, this->resource_->get_lod_num_indices(lod), this->resource_->get_index_type(), index_offset, GLsizei(instances.size()), this->resource_->get_base_vertex());
 	glBindVertexArray(0);
 }
 
@@ -45,6 +91,9 @@ void GeometryNode::init(RenderingEngine* rendering_engine)
 
 	//calculate bounding sphere radius
 	bounding_sphere_radius_ = resource_->calculate_sphere_radius(this->get_transformation());
+
+	const glm::mat3 trafo(this->get_transformation());
+	scale_ = glm::max(glm::length(trafo[0]), glm::max(glm::length(trafo[1]), glm::length(trafo[2])));
 }
 
 const MeshResource* GeometryNode::get_mesh_resource() const {
@@ -12,6 +12,8 @@ class GeometryNode :
 {
 	MeshResource* resource_;
 	float bounding_sphere_radius_ = 0;
+	float scale_ = 1;
+	bool batched_ = false;
 
 public:
 	explicit GeometryNode(const std::string& name, MeshResource *resource);
@@ -21,19 +23,46 @@ public:
 	std::vector<IDrawable*> get_transparent_drawables() override;
 
 	void draw(ShaderResource *shader) const override;
+	void draw_culled(ShaderResource *shader, FrustumG *frustum, const LodSelection& lod) const override;
+	void draw_instanced(ShaderResource *shader, const std::vector<const IDrawable*>& instances, int lod) const override;
+	int select_lod(const LodSelection& lod) const override;
+	//draws the given level of detail of the mesh
+	void draw_lod(ShaderResource *shader, int lod) const;
+	//true if the shader draws the mesh from the position-only vao
+	bool uses_depth_stream(const ShaderResource *shader) const;
 	void init(RenderingEngine* rendering_engine) override;
 
-	const MeshResource* get_mesh_resource() const;
+	const MeshResource* get_mesh_resource() const override;
 	MeshResource* get_editable_mesh_resource();
 
 	float get_bounding_sphere_radius() const override;
 
+	//largest scale factor of the transformation, converts object space lengths to world space
+	float get_scale() const
+	{
+		return scale_;
+	}
+
+	//batched nodes are drawn as part of a StaticBatchNode and are no drawables themselves
+	void set_batched(bool batched)
+	{
+		this->batched_ = batched;
+	}
+
 	glm::vec3 get_position() const override {
 		return TransformationNode::get_position();
 	}
 
+	const glm::mat4& get_transformation() const override {
+		return TransformationNode::get_transformation();
+	}
+
 	bool is_enabled() const override {
 		return Node::is_enabled();
 	}
+
+	bool is_dynamic() const override {
+		return Node::is_dynamic();
+	}
 };
 
@@ -126,3 +126,11 @@ void GroupNode::set_enabled(bool enabled)
 		node->set_enabled(enabled);
 	}
 }
+
+void GroupNode::set_dynamic(bool dynamic)
+{
+	Node::set_dynamic(dynamic);
+	for (auto& node : nodes_) {
+		node->set_dynamic(dynamic);
+	}
+}
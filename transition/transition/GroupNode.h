@@ -27,5 +27,6 @@ public:
 	Node* find_by_name(const std::string& name) override;
 
 	virtual void set_enabled(bool enabled) override;
+	virtual void set_dynamic(bool dynamic) override;
 };
 
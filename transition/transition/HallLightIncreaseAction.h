@@ -18,6 +18,10 @@ public:
 	explicit HallLightIncreaseAction(GeometryNode* bulb, LightNode* light, float duration, float delay, float max = 1)
 	{
 		this->bulb_ = bulb;
+		if (this->bulb_ != nullptr) {
+			// material is animated
+			this->bulb_->set_dynamic(true);
+		}
 		this->light_ = light;
 		this->duration_ = duration;
 		this->delay_ = delay;
@@ -1,12 +1,25 @@
 #pragma once
+#include <vector>
 class ShaderResource;
+class MeshResource;
+class FrustumG;
+struct LodSelection;
 class IDrawable
 {
 public:
 	virtual ~IDrawable() = default;
 	virtual void draw(ShaderResource *shader) const = 0;
+	//drawables made of several parts only draw the parts inside the frustum (nullptr draws everything), in the level of detail chosen by lod
+	virtual void draw_culled(ShaderResource *shader, FrustumG *frustum, const LodSelection& lod) const { draw(shader); }
+	//level of detail of the whole drawable, 0 is full detail
+	virtual int select_lod(const LodSelection& lod) const { return 0; }
+	//draws all instances in the given level of detail with one draw call, they have to share geometry and material with this drawable
+	virtual void draw_instanced(ShaderResource *shader, const std::vector<const IDrawable*>& instances, int lod) const = 0;
+	virtual const MeshResource* get_mesh_resource() const = 0;
+	virtual const glm::mat4& get_transformation() const = 0;
 	virtual float get_bounding_sphere_radius() const = 0;//Yes this is ugly, but wurscht
 	virtual glm::vec3 get_position() const = 0;
 	virtual bool is_enabled() const = 0;
+	virtual bool is_dynamic() const = 0;
 };
 
@@ -1,7 +1,7 @@
 #pragma once
 #include <vector>
-
-class LightNode;
+#include <glm/glm.hpp>
+#include "LightNode.h"
 
 class ILightShader
 {
@@ -11,7 +11,9 @@ public:
 	virtual void set_light_uniforms(const std::vector<LightNode*>& light_nodes) = 0;
 
 
-	virtual void set_directional_shadow_map_uniforms(const LightNode *light, const GLint shadow_map) = 0;
-	virtual void set_omni_directional_shadow_map_uniforms(const LightNode *light, const GLint shadow_map, float far_plane, float near_plane) = 0;
+	//first_view is the index of the light's first view in the shadow atlas, -1 if it has no region
+	virtual void set_shadow_map_uniforms(const LightNode *light, int first_view, float far_plane, ShadowProjection projection) = 0;
+	//view space depth at which each cascade ends, view i + 1 is used beyond split_depths[i]
+	virtual void set_cascade_uniforms(const LightNode *light, const glm::vec4& split_depths) = 0;
 };
 
@@ -0,0 +1,266 @@
+#include "IndirectDrawList.h"
+#include "RenderingEngine.h"
+#include "GeometryArena.h"
+#include "StaticBatchNode.h"
+#include "ComputeShader.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <cassert>
+#include <algorithm>
+#include <iostream>
+
+// regions for the culled passes of a frame at first, doubled whenever a frame has more
+static const int initial_num_passes = 16;
+
+IndirectDrawList::IndirectDrawList(RenderingEngine* rendering_engine)
+{
+	this->arena_ = rendering_engine->get_geometry_arena();
+	this->cull_shader_ = new ComputeShader("assets/shaders/indirect_cull.comp");
+	rendering_engine->register_resource(this->cull_shader_);
+	this->cull_shader_->init();
+
+	this->ssbo_objects_ = -1;
+	this->vbo_transformations_ = -1;
+	this->indirect_buffer_ = -1;
+	this->pass_ = 0;
+	this->num_passes_ = initial_num_passes;
+	this->command_offset_ = 0;
+	this->reported_not_instanced_ = false;
+	this->revision_ = 0;
+	this->depth_only_ = false;
+}
+
+IndirectDrawList::~IndirectDrawList()
+{
+	if (this->ssbo_objects_ != -1) {
+		glDeleteBuffers(1, &this->ssbo_objects_);
+		glDeleteBuffers(1, &this->vbo_transformations_);
+		glDeleteBuffers(1, &this->indirect_buffer_);
+	}
+}
+
+void IndirectDrawList::build(std::vector<IDrawable*>& drawables)
+{
+	struct Entry
+	{
+		const GeometryNode* node;
+		const GeometryNode* source;
+		Object object;
+	};
+
+	// collect static arena geometry grouped by material and index type, batches contribute each of their parts
+	std::vector<std::vector<Entry>> groups;
+	std::vector<IDrawable*> remaining;
+	for (auto& drawable : drawables) {
+		const auto node = dynamic_cast<GeometryNode*>(drawable);
+		if (node == nullptr || node->is_dynamic() || node->get_mesh_resource()->get_arena() != this->arena_) {
+			remaining.push_back(drawable);
+			continue;
+		}
+		const auto mesh = node->get_mesh_resource();
+		// alpha tested casters discard by their alpha texture, the position-only vao has no uvs
+		const bool depth_welded = !mesh->get_material().has_alpha_texture();
+
+		std::vector<Entry> entries;
+		const auto batch = dynamic_cast<StaticBatchNode*>(node);
+		if (batch != nullptr) {
+			for (auto& part : batch->get_parts()) {
+				Entry entry = { node, part.source, Object() };
+				entry.object.sphere = glm::vec4(part.center, part.radius);
+				entry.object.enabled = 1;
+				entry.object.base_vertex = mesh->get_base_vertex();
+				entry.object.num_lods = GLuint(mesh->get_num_lods());
+				entry.object.depth_welded = depth_welded ? 1 : 0;
+				for (int lod = 0; lod < MeshResource::max_lods; lod++) {
+					const int part_lod = std::min(lod, mesh->get_num_lods() - 1);
+					entry.object.first_index[lod] = GLuint(mesh->get_lod_first_index(part_lod) + part.first_index[part_lod]);
+					entry.object.num_indices[lod] = GLuint(part.num_indices[part_lod]);
+					entry.object.error[lod] = part.error[part_lod];
+					entry.object.depth_first_index[lod] = GLuint(mesh->get_lod_depth_first_index(part_lod) + part.first_index[part_lod]);
+				}
+				entries.push_back(entry);
+			}
+		}
+		else {
+			Entry entry = { node, node, Object() };
+			entry.object.sphere = glm::vec4(node->get_position(), node->get_bounding_sphere_radius());
+			entry.object.enabled = 1;
+			entry.object.base_vertex = mesh->get_base_vertex();
+			entry.object.num_lods = GLuint(mesh->get_num_lods());
+			entry.object.depth_welded = depth_welded ? 1 : 0;
+			for (int lod = 0; lod < MeshResource::max_lods; lod++) {
+				const int mesh_lod = std::min(lod, mesh->get_num_lods() - 1);
+				entry.object.first_index[lod] = GLuint(mesh->get_lod_first_index(mesh_lod));
+				entry.object.num_indices[lod] = GLuint(mesh->get_lod_num_indices(mesh_lod));
+				entry.object.error[lod] = mesh->get_lod_error(mesh_lod) * node->get_scale();
+				entry.object.depth_first_index[lod] = GLuint(mesh->get_lod_depth_first_index(mesh_lod));
+			}
+			entries.push_back(entry);
+		}
+
+		for (auto& entry : entries) {
+			auto group = groups.begin();
+			while (group != groups.end() && (group->front().node->get_mesh_resource()->get_material() != mesh->get_material()
+				|| group->front().node->get_mesh_resource()->get_index_type() != mesh->get_index_type())) {
+				++group;
+			}
+			if (group == groups.end()) {
+				groups.push_back({ entry });
+			}
+			else {
+				group->push_back(entry);
+			}
+		}
+	}
+	drawables = remaining;
+
+	// per object model and normal matrix, read as per-instance attributes through the base instance
+	std::vector<glm::mat4> transformations;
+	for (auto& group : groups) {
+		const auto mesh = group.front().node->get_mesh_resource();
+		this->groups_.push_back({ group.front().node, mesh->get_index_type(), !mesh->get_material().has_alpha_texture(), int(this->objects_.size()), int(group.size()) });
+		for (auto& entry : group) {
+			this->objects_.push_back(entry.object);
+			this->sources_.push_back(entry.source);
+			const auto& transformation = entry.node->get_transformation();
+			transformations.push_back(transformation);
+			transformations.push_back(glm::mat4(glm::transpose(glm::inverse(glm::mat3(transformation)))));
+		}
+	}
+	if (this->objects_.empty()) {
+		return;
+	}
+
+	glGenBuffers(1, &this->ssbo_objects_);
+	glGenBuffers(1, &this->vbo_transformations_);
+	glGenBuffers(1, &this->indirect_buffer_);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->ssbo_objects_);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(Object) * this->objects_.size(), this->objects_.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->vbo_transformations_);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * transformations.size(), transformations.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->indirect_buffer_);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawCommand) * this->objects_.size() * this->num_passes_, nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	this->arena_->set_indirect_instance_buffer(this->vbo_transformations_);
+}
+
+void IndirectDrawList::update()
+{
+	this->pass_ = 0;
+
+	// rooms and single objects are switched on and off during the demo
+	bool changed = false;
+	for (size_t i = 0; i < this->objects_.size(); i++) {
+		const GLuint enabled = this->sources_[i]->is_enabled() ? 1 : 0;
+		if (this->objects_[i].enabled != enabled) {
+			this->objects_[i].enabled = enabled;
+			changed = true;
+		}
+	}
+	if (changed) {
+		this->revision_++;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->ssbo_objects_);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(Object) * this->objects_.size(), this->objects_.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+}
+
+void IndirectDrawList::draw(ShaderResource* shader, const glm::mat4* view_projection, const LodSelection& lod)
+{
+	if (this->objects_.empty()) {
+		return;
+	}
+	if (this->pass_ == this->num_passes_) {
+		this->grow_commands(this->num_passes_ * 2);
+	}
+	this->command_offset_ = this->pass_ * int(this->objects_.size());
+	this->pass_++;
+	this->depth_only_ = shader->is_depth_only();
+
+	this->cull_shader_->use();
+	glUniform1ui(0, GLuint(this->objects_.size()));
+	glUniform1ui(1, GLuint(this->command_offset_));
+	glUniform1i(2, view_projection != nullptr ? 1 : 0);
+	if (view_projection != nullptr) {
+		// frustum planes from the rows of the view projection matrix, normalized so the sphere radius can be compared
+		const auto rows = glm::transpose(*view_projection);
+		glm::vec4 planes[6] = {
+			rows[3] + rows[0], rows[3] - rows[0],
+			rows[3] + rows[1], rows[3] - rows[1],
+			rows[3] + rows[2], rows[3] - rows[2]
+		};
+		for (auto& plane : planes) {
+			plane /= glm::length(glm::vec3(plane));
+		}
+		glUniform4fv(3, 6, glm::value_ptr(planes[0]));
+	}
+	glUniform3fv(9, 1, glm::value_ptr(lod.eye));
+	glUniform1f(10, lod.scale);
+	glUniform1i(11, lod.perspective ? 1 : 0);
+	glUniform1i(12, this->depth_only_ ? 1 : 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, this->ssbo_objects_);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, this->indirect_buffer_);
+	glDispatchCompute(GLuint((this->objects_.size() + 63) / 64), 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+	this->draw_commands(shader);
+}
+
+void IndirectDrawList::redraw(ShaderResource* shader) const
+{
+	if (this->objects_.empty()) {
+		return;
+	}
+	assert(shader->is_depth_only() == this->depth_only_);
+	this->draw_commands(shader);
+}
+
+void IndirectDrawList::grow_commands(const int num_passes)
+{
+	// the regions of this frame's earlier passes are copied, redraw() may still replay the last one
+	const GLsizeiptr used = sizeof(DrawCommand) * this->objects_.size() * this->pass_;
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, sizeof(DrawCommand) * this->objects_.size() * num_passes, nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_COPY_READ_BUFFER, this->indirect_buffer_);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	// draws already issued keep reading the old storage, it is released once they are done
+	glDeleteBuffers(1, &this->indirect_buffer_);
+	this->indirect_buffer_ = buffer;
+	this->num_passes_ = num_passes;
+}
+
+void IndirectDrawList::draw_commands(ShaderResource* shader) const
+{
+	shader->use();
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->indirect_buffer_);
+	GLuint bound_vao = 0;
+	for (auto& group : this->groups_) {
+		const GLuint vao = this->depth_only_ && group.depth_welded ? this->arena_->get_depth_indirect_vao() : this->arena_->get_indirect_vao();
+		if (vao != bound_vao) {
+			glBindVertexArray(vao);
+			bound_vao = vao;
+		}
+		// all shaders drawing scene geometry read the model matrix from the instance attributes
+		if (!shader->set_instanced_model_uniforms(group.node)) {
+			// the commands would be drawn with whatever model matrix the shader had last
+			if (!this->reported_not_instanced_) {
+				std::cerr << "IndirectDrawList: shader without instanced model uniforms, static geometry is skipped" << std::endl;
+				this->reported_not_instanced_ = true;
+			}
+			continue;
+		}
+		const auto offset = reinterpret_cast<const void*>(sizeof(DrawCommand) * (this->command_offset_ + group.first));
+		glMultiDrawElementsIndirect(GL_TRIANGLES, group.index_type, offset, group.count, 0);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+}
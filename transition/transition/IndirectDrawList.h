@@ -0,0 +1,106 @@
+#pragma once
+#include "glheaders.h"
+#include "MeshResource.h"
+#include "LodSelection.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+class RenderingEngine;
+class GeometryArena;
+class GeometryNode;
+class ComputeShader;
+class ShaderResource;
+class IDrawable;
+
+/*
+Draws all static geometry stored in the GeometryArena with one glMultiDrawElementsIndirect per material and index type.
+Every object has a bounding sphere and its index range in a shader storage buffer, a compute shader culls them
+against the frustum of the current pass, selects the level of detail and writes the DrawElementsIndirectCommands
+(instance count 0 for culled objects). Depth-only shaders get commands for the position-only vao of the arena,
+except for alpha tested materials, whose casters need their uvs and keep the full vao.
+The base instance of each command is the object index, so the per-instance attributes of the arena's indirect vao
+fetch the model matrix of the drawn object.
+*/
+class IndirectDrawList
+{
+	//layout matches the Object struct of indirect_cull.comp (std430)
+	struct Object
+	{
+		glm::vec4 sphere;
+		GLuint enabled;
+		GLint base_vertex;
+		GLuint num_lods;
+		GLuint depth_welded;	//depth-only passes draw depth_first_index, 0 for alpha tested materials which need their uvs
+		GLuint first_index[MeshResource::max_lods];
+		GLuint num_indices[MeshResource::max_lods];
+		float error[MeshResource::max_lods];
+		GLuint depth_first_index[MeshResource::max_lods];	//welded indices of the position-only vao
+	};
+
+	struct DrawCommand
+	{
+		GLuint count;
+		GLuint instance_count;
+		GLuint first_index;
+		GLint base_vertex;
+		GLuint base_instance;
+	};
+
+	//consecutive objects sharing the material and the index type of node
+	struct Group
+	{
+		const GeometryNode* node;
+		GLenum index_type;
+		bool depth_welded;		//drawn through the position-only vao in depth-only passes
+		int first;
+		int count;
+	};
+
+	GeometryArena *arena_;
+	ComputeShader *cull_shader_;
+
+	std::vector<Object> objects_;
+	std::vector<const GeometryNode*> sources_;
+	std::vector<Group> groups_;
+
+	GLuint ssbo_objects_;
+	GLuint vbo_transformations_;
+	GLuint indirect_buffer_;
+
+	//every pass of a frame writes its commands to an own region, so no pass has to wait for the previous one
+	//and redraw() finds the commands of the last pass untouched
+	int pass_;
+	int num_passes_;
+	int command_offset_;
+	//incremented whenever objects are switched on or off, cached shadow maps compare it
+	int revision_;
+	//the commands of the last draw index the welded positions
+	bool depth_only_;
+	//a shader without instanced model uniforms is reported once
+	mutable bool reported_not_instanced_;
+
+	void draw_commands(ShaderResource *shader) const;
+	//keeps the commands of the passes drawn so far this frame
+	void grow_commands(int num_passes);
+
+public:
+	explicit IndirectDrawList(RenderingEngine *rendering_engine);
+	~IndirectDrawList();
+
+	//takes all static arena geometry out of drawables
+	void build(std::vector<IDrawable*>& drawables);
+
+	//has to be called once per frame before rendering
+	void update();
+
+	//view_projection is used for culling, nullptr draws all enabled objects
+	void draw(ShaderResource *shader, const glm::mat4 *view_projection, const LodSelection& lod);
+
+	//draws the commands of the last draw again without culling, e.g. for the main pass after the depth pre-pass
+	void redraw(ShaderResource *shader) const;
+
+	int get_revision() const
+	{
+		return revision_;
+	}
+};
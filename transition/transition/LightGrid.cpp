@@ -0,0 +1,263 @@
+#include "LightGrid.h"
+#include "RenderingEngine.h"
+#include "RenderingNode.h"
+#include "LightNode.h"
+#include "ComputeShader.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <cassert>
+#include <algorithm>
+#include <limits>
+#include <xmmintrin.h>
+
+static bool cone_intersects_sphere(const glm::vec3& origin, const glm::vec3& direction, const float range, const float cos_angle, const glm::vec3& center, const float radius)
+{
+	const glm::vec3 v = center - origin;
+	const float v_along = glm::dot(v, direction);
+	const float distance_to_cone = cos_angle * glm::sqrt(glm::max(glm::dot(v, v) - v_along * v_along, 0.0f)) - v_along * glm::sqrt(1.0f - cos_angle * cos_angle);
+	return distance_to_cone <= radius && v_along <= range + radius && v_along >= -radius;
+}
+
+LightGrid::LightGrid(RenderingEngine* rendering_engine, const glm::ivec2& viewport)
+{
+	this->viewport_ = viewport;
+	this->size_ = glm::ivec3((viewport.x + tile_size - 1) / tile_size, (viewport.y + tile_size - 1) / tile_size, num_slices);
+	this->max_clusters_ = this->get_num_clusters();
+	this->depth_scale_bias_ = glm::vec2(0);
+	this->volumetric_sample_scale_ = 1.0f;
+
+	this->cull_shader_ = nullptr;
+	if (GLAD_GL_VERSION_4_3) {
+		this->cull_shader_ = new ComputeShader("assets/shaders/light_cull.comp");
+		rendering_engine->register_resource(this->cull_shader_);
+		this->cull_shader_->init();
+	}
+
+	// with compute shaders every cluster has room for its own list, otherwise all clusters share one list of all lights
+	const int num_indices = (this->cull_shader_ != nullptr ? this->max_clusters_ * max_lights_per_cluster : max_lights) + max_lights;
+
+	glGenBuffers(1, &this->lights_buffer_);
+	glGenBuffers(1, &this->clusters_buffer_);
+	glGenBuffers(1, &this->indices_buffer_);
+	glBindBuffer(GL_TEXTURE_BUFFER, this->lights_buffer_);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(Light) * max_lights, nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, this->clusters_buffer_);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::uvec2) * (this->max_clusters_ + 1), nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_TEXTURE_BUFFER, this->indices_buffer_);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(GLuint) * num_indices, nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glGenTextures(1, &this->lights_texture_);
+	glGenTextures(1, &this->clusters_texture_);
+	glGenTextures(1, &this->indices_texture_);
+	glBindTexture(GL_TEXTURE_BUFFER, this->lights_texture_);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, this->lights_buffer_);
+	glBindTexture(GL_TEXTURE_BUFFER, this->clusters_texture_);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, this->clusters_buffer_);
+	glBindTexture(GL_TEXTURE_BUFFER, this->indices_texture_);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, this->indices_buffer_);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+LightGrid::~LightGrid()
+{
+	glDeleteTextures(1, &this->lights_texture_);
+	glDeleteTextures(1, &this->clusters_texture_);
+	glDeleteTextures(1, &this->indices_texture_);
+	glDeleteBuffers(1, &this->lights_buffer_);
+	glDeleteBuffers(1, &this->clusters_buffer_);
+	glDeleteBuffers(1, &this->indices_buffer_);
+}
+
+void LightGrid::set_viewport(const glm::ivec2& viewport)
+{
+	this->viewport_ = viewport;
+	this->size_ = glm::ivec3((viewport.x + tile_size - 1) / tile_size, (viewport.y + tile_size - 1) / tile_size, num_slices);
+	assert(this->get_num_clusters() <= this->max_clusters_);
+}
+
+void LightGrid::set_volumetric_sample_scale(const float scale)
+{
+	this->volumetric_sample_scale_ = scale;
+}
+
+int LightGrid::get_num_clusters() const
+{
+	return this->size_.x * this->size_.y * this->size_.z;
+}
+
+void LightGrid::update(const std::vector<LightNode*>& light_nodes, const RenderingNode* camera)
+{
+	this->set_light_uniforms(light_nodes);
+	this->update_spheres();
+	const int num_lights = int(this->lights_.size());
+
+	glBindBuffer(GL_TEXTURE_BUFFER, this->lights_buffer_);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, sizeof(Light) * num_lights, this->lights_.data());
+
+	// near and far plane from the projection, the slices are spaced exponentially between them
+	const auto& projection = camera->get_projection_matrix();
+	const float near_plane = projection[3][2] / (projection[2][2] - 1.0f);
+	const float far_plane = projection[3][2] / (projection[2][2] + 1.0f);
+	this->depth_scale_bias_.x = float(num_slices) / glm::log(far_plane / near_plane);
+	this->depth_scale_bias_.y = -glm::log(near_plane) * this->depth_scale_bias_.x;
+
+	std::vector<GLuint> indices;
+	if (this->cull_shader_ == nullptr) {
+		// one list of all lights that can contribute shared by all clusters
+		for (auto& light : this->sphere_light_) {
+			indices.push_back(GLuint(light));
+		}
+		const std::vector<glm::uvec2> clusters(this->get_num_clusters(), glm::uvec2(0, GLuint(indices.size())));
+		glBindBuffer(GL_TEXTURE_BUFFER, this->clusters_buffer_);
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, sizeof(glm::uvec2) * clusters.size(), clusters.data());
+	}
+
+	// the volumetric lights are few, they are listed on the cpu behind the cluster lists
+	const GLuint volumetric_offset = this->cull_shader_ != nullptr ? GLuint(this->get_num_clusters() * max_lights_per_cluster) : GLuint(indices.size());
+	const auto volumetric_first = indices.size();
+	for (auto& light : this->sphere_light_) {
+		if (this->lights_[light].volumetric.w > 0.0f) {
+			indices.push_back(GLuint(light));
+		}
+	}
+	const glm::uvec2 volumetric(volumetric_offset, GLuint(indices.size() - volumetric_first));
+	glBindBuffer(GL_TEXTURE_BUFFER, this->clusters_buffer_);
+	glBufferSubData(GL_TEXTURE_BUFFER, sizeof(glm::uvec2) * this->get_num_clusters(), sizeof(glm::uvec2), &volumetric);
+	// without compute shaders the shared list directly precedes the volumetric one, both are written in one piece
+	glBindBuffer(GL_TEXTURE_BUFFER, this->indices_buffer_);
+	glBufferSubData(GL_TEXTURE_BUFFER, sizeof(GLuint) * (volumetric_offset - volumetric_first), sizeof(GLuint) * indices.size(), indices.data());
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	if (this->cull_shader_ != nullptr) {
+		this->cull_shader_->use();
+		glUniform1ui(0, GLuint(num_lights));
+		glUniform3iv(1, 1, glm::value_ptr(this->size_));
+		glUniformMatrix4fv(2, 1, GL_FALSE, glm::value_ptr(camera->get_view_matrix()));
+		glUniformMatrix4fv(3, 1, GL_FALSE, glm::value_ptr(camera->get_projection_inverse_matrix()));
+		glUniform2f(4, near_plane, far_plane);
+		glUniform2f(5, 2.0f * tile_size / this->viewport_.x, 2.0f * tile_size / this->viewport_.y);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, this->lights_buffer_);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, this->clusters_buffer_);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, this->indices_buffer_);
+		glDispatchCompute(GLuint((this->get_num_clusters() + 63) / 64), 1, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+}
+
+void LightGrid::bind(const int first_texture_slot) const
+{
+	glActiveTexture(GL_TEXTURE0 + first_texture_slot);
+	glBindTexture(GL_TEXTURE_BUFFER, this->clusters_texture_);
+	glActiveTexture(GL_TEXTURE0 + first_texture_slot + 1);
+	glBindTexture(GL_TEXTURE_BUFFER, this->indices_texture_);
+	glActiveTexture(GL_TEXTURE0 + first_texture_slot + 2);
+	glBindTexture(GL_TEXTURE_BUFFER, this->lights_texture_);
+}
+
+void LightGrid::update_spheres()
+{
+	this->sphere_x_.clear();
+	this->sphere_y_.clear();
+	this->sphere_z_.clear();
+	this->sphere_radius_.clear();
+	this->sphere_light_.clear();
+
+	// lights without color (e.g. hall lights before they are switched on) have no influence at all
+	for (int i = 0; i < int(this->lights_.size()); i++) {
+		const auto& light = this->lights_[i];
+		const float range = light.direction_range.w;
+		if (range == 0.0f) {
+			continue;
+		}
+		this->sphere_x_.push_back(light.position_type.x);
+		this->sphere_y_.push_back(light.position_type.y);
+		this->sphere_z_.push_back(light.position_type.z);
+		this->sphere_radius_.push_back(range < 0.0f ? std::numeric_limits<float>::infinity() : range);
+		this->sphere_light_.push_back(i);
+	}
+	const size_t padded = (this->sphere_light_.size() + 3) & ~size_t(3);
+	this->sphere_x_.resize(padded, 0.0f);
+	this->sphere_y_.resize(padded, 0.0f);
+	this->sphere_z_.resize(padded, 0.0f);
+	this->sphere_radius_.resize(padded, 0.0f);
+}
+
+bool LightGrid::get_lights_in_sphere(const glm::vec3& center, const float radius, GLint* indices, const int max_count, int& count) const
+{
+	count = 0;
+	const int num_spheres = int(this->sphere_light_.size());
+	const __m128 center_x = _mm_set1_ps(center.x);
+	const __m128 center_y = _mm_set1_ps(center.y);
+	const __m128 center_z = _mm_set1_ps(center.z);
+	const __m128 object_radius = _mm_set1_ps(radius);
+	for (int i = 0; i < num_spheres; i += 4) {
+		const __m128 dx = _mm_sub_ps(_mm_loadu_ps(&this->sphere_x_[i]), center_x);
+		const __m128 dy = _mm_sub_ps(_mm_loadu_ps(&this->sphere_y_[i]), center_y);
+		const __m128 dz = _mm_sub_ps(_mm_loadu_ps(&this->sphere_z_[i]), center_z);
+		const __m128 distance_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		const __m128 reach = _mm_add_ps(_mm_loadu_ps(&this->sphere_radius_[i]), object_radius);
+		int mask = _mm_movemask_ps(_mm_cmple_ps(distance_sq, _mm_mul_ps(reach, reach)));
+		if (num_spheres - i < 4) {
+			mask &= (1 << (num_spheres - i)) - 1;
+		}
+
+		for (int lane = 0; mask != 0; lane++, mask >>= 1) {
+			if ((mask & 1) == 0) {
+				continue;
+			}
+			const int index = this->sphere_light_[i + lane];
+			const auto& light = this->lights_[index];
+			// spot lights only reach into their cone
+			if (int(light.position_type.w) == SPOT_LIGHT && light.direction_range.w > 0.0f
+				&& !cone_intersects_sphere(glm::vec3(light.position_type), glm::normalize(glm::vec3(light.direction_range)), light.direction_range.w, light.specular_outer_cutoff.w, center, radius)) {
+				continue;
+			}
+			if (count == max_count) {
+				return false;
+			}
+			indices[count++] = index;
+		}
+	}
+	return true;
+}
+
+void LightGrid::set_light_uniforms(const std::vector<LightNode*>& light_nodes)
+{
+	this->lights_.clear();
+
+	for (auto& light : light_nodes)
+	{
+		if (!light->is_enabled() || this->lights_.size() == max_lights) {
+			continue;
+		}
+		Light data;
+		data.position_type = glm::vec4(light->get_position(), float(light->get_light_type()));
+		data.direction_range = glm::vec4(light->get_direction(), light->get_influence_radius());
+		data.attenuation = glm::vec4(light->get_constant(), light->get_linear(), light->get_quadratic(), -1.0f);
+		data.diffuse_cutoff = glm::vec4(light->get_diffuse(), glm::cos(glm::radians(light->get_cutoff())));
+		data.specular_outer_cutoff = glm::vec4(light->get_specular(), glm::cos(glm::radians(light->get_outer_cutoff())));
+		data.shadow = glm::vec4(light->get_min_bias(), light->get_max_bias(), 0.0f, 0.0f);
+		data.volumetric = glm::vec4(light->get_phi(), light->get_tau(), light->has_fog() ? 1.0f : 0.0f, 0.0f);
+		data.cascade_splits = glm::vec4(0.0f);
+		this->lights_.push_back(data);
+
+		if (light->is_rendering_enabled()) {
+			light->set_uniforms(this);
+			if (light->is_volumetric()) {
+				this->lights_.back().volumetric.w = glm::max(glm::round(float(light->get_num_samples()) * this->volumetric_sample_scale_), 1.0f);
+			}
+		}
+	}
+}
+
+void LightGrid::set_shadow_map_uniforms(const LightNode* light, const int first_view, const float far_plane, const ShadowProjection projection)
+{
+	this->lights_.back().attenuation.w = float(first_view);
+	this->lights_.back().shadow.z = far_plane;
+	this->lights_.back().shadow.w = float(projection);
+}
+
+void LightGrid::set_cascade_uniforms(const LightNode* light, const glm::vec4& split_depths)
+{
+	this->lights_.back().cascade_splits = split_depths;
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include "glheaders.h"
+#include "ILightShader.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+class RenderingEngine;
+class RenderingNode;
+class ComputeShader;
+
+/*
+Clustered light culling for the shaders of a camera. The view frustum is divided into screen tiles and exponential
+depth slices, a compute shader tests the influence volume of every enabled light against every cluster and writes
+the offset and count of the cluster's light index list. The shaders read clusters, indices and lights as buffer
+textures, so they stay GLSL 3.30 and only loop over the lights of the cluster of their fragment.
+One more entry after the clusters lists all volumetric lights for the raymarching of the volumetric lighting.
+Without compute shaders every cluster lists all lights that can contribute, and the shaders can ask for the lights
+reaching the bounding sphere of the drawn object instead (tested on the cpu, four lights at a time with SSE).
+*/
+class LightGrid : public ILightShader
+{
+public:
+	static const int tile_size = 64;
+	static const int num_slices = 16;
+	static const int max_lights = 256;
+	static const int max_lights_per_cluster = 64;
+
+private:
+	//layout matches get_light() of main_shader.fs and volumetric_lighting.fs and the Light struct of light_cull.comp (std430)
+	struct Light
+	{
+		glm::vec4 position_type;			//w light type
+		glm::vec4 direction_range;			//w influence radius, negative without attenuation
+		glm::vec4 attenuation;				//constant, linear, quadratic, first view in the shadow atlas (negative without shadow map)
+		glm::vec4 diffuse_cutoff;			//w cosine of the cutoff
+		glm::vec4 specular_outer_cutoff;	//w cosine of the outer cutoff
+		glm::vec4 shadow;					//min bias, max bias, far plane, ShadowProjection
+		glm::vec4 volumetric;				//phi, tau, has fog, number of samples (0 if not volumetric)
+		glm::vec4 cascade_splits;			//view space depth at which each cascade ends, 0 for unused cascades
+	};
+
+	ComputeShader *cull_shader_;
+
+	glm::ivec2 viewport_;
+	glm::ivec3 size_;
+	//clusters the buffers have room for, the grid of the viewport given to the constructor
+	int max_clusters_;
+	glm::vec2 depth_scale_bias_;
+	float volumetric_sample_scale_;
+
+	std::vector<Light> lights_;
+	//influence spheres of the lights that can contribute, structure of arrays padded to a multiple of four for SSE
+	std::vector<float> sphere_x_;
+	std::vector<float> sphere_y_;
+	std::vector<float> sphere_z_;
+	std::vector<float> sphere_radius_;
+	std::vector<int> sphere_light_;
+
+	GLuint lights_buffer_;
+	GLuint clusters_buffer_;
+	GLuint indices_buffer_;
+	GLuint lights_texture_;
+	GLuint clusters_texture_;
+	GLuint indices_texture_;
+
+	int get_num_clusters() const;
+	void update_spheres();
+public:
+	LightGrid(RenderingEngine *rendering_engine, const glm::ivec2& viewport);
+	~LightGrid();
+
+	//for rendering at a different resolution, at most as large as the viewport given to the constructor
+	void set_viewport(const glm::ivec2& viewport);
+
+	//share of each volumetric light's ray marching steps, at least one step remains
+	void set_volumetric_sample_scale(float scale);
+
+	//uploads the enabled lights and assigns them to the clusters of the camera's frustum, once per frame before shading
+	void update(const std::vector<LightNode*>& light_nodes, const RenderingNode *camera);
+
+	//binds clusters, indices and lights to three consecutive texture slots
+	void bind(int first_texture_slot) const;
+
+	//false if the lights are not binned per cluster, then per object lists give a tighter set
+	bool is_clustered() const
+	{
+		return cull_shader_ != nullptr;
+	}
+
+	//indices of the lights reaching the sphere, false if there are more than max_count
+	bool get_lights_in_sphere(const glm::vec3& center, float radius, GLint *indices, int max_count, int& count) const;
+
+	//number of tiles and slices, the list of the volumetric lights is the entry after the last cluster
+	const glm::ivec3& get_size() const
+	{
+		return size_;
+	}
+
+	float get_tile_size() const
+	{
+		return float(tile_size);
+	}
+
+	//slice = log(view space depth) * x + y
+	const glm::vec2& get_depth_scale_bias() const
+	{
+		return depth_scale_bias_;
+	}
+
+	void set_light_uniforms(const std::vector<LightNode*>& light_nodes) override;
+	void set_shadow_map_uniforms(const LightNode *light, int first_view, float far_plane, ShadowProjection projection) override;
+	void set_cascade_uniforms(const LightNode *light, const glm::vec4& split_depths) override;
+};
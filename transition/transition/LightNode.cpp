@@ -3,6 +3,10 @@
 #include "RenderingEngine.h"
 #include "DirectionalDepthShader.h"
 #include "DirectionalShadowStrategy.h"
+#include "IDrawable.h"
+#include "IndirectDrawList.h"
+#include "ShadowAtlas.h"
+#include <algorithm>
 
 LightNode::LightNode(const std::string& name, const LightType light_type) : RenderingNode(
 	name, 
@@ -22,6 +26,15 @@ LightNode::LightNode(const std::string& name, const LightType light_type) : Rend
 	this->min_bias_ = 0.0;
 	this->max_bias_ = 0.0;
 	this->has_fog_ = false;
+	this->num_samples_ = 0;
+
+	this->shadow_layer_ = SHADOW_LAYER_ALL;
+	this->shadow_face_ = 0;
+	this->shadow_static_faces_ = 0;
+	this->shadow_dirty_faces_ = 0;
+	this->shadow_rendered_faces_ = 0;
+	this->shadow_map_valid_ = false;
+	this->shadow_static_revision_ = 0;
 }
 
 LightNode::~LightNode()
@@ -92,6 +105,201 @@ bool LightNode::is_rendering_enabled() const
 	return this->is_enabled() && this->shadow_strategy_ != nullptr;
 }
 
+bool LightNode::renders_indirect_geometry() const
+{
+	// all indirectly drawn geometry is static
+	return this->shadow_layer_ != SHADOW_LAYER_DYNAMIC;
+}
+
+bool LightNode::get_culling_view_projection(glm::mat4& view_projection) const
+{
+	if (this->shadow_strategy_ == nullptr || !this->shadow_strategy_->culls_faces()) {
+		return RenderingNode::get_culling_view_projection(view_projection);
+	}
+	view_projection = this->shadow_strategy_->get_light_space_matrix(this, this->shadow_face_);
+	return true;
+}
+
+void LightNode::prepare_shadow_map(const RenderingNode* camera, const std::vector<IDrawable*>& drawables, const std::vector<IDrawable*>& transparents) const
+{
+	if (!this->is_rendering_enabled()) {
+		return;
+	}
+	this->update_frustum();
+	const int moved_faces = this->shadow_strategy_->update(this, camera);
+
+	// enabled casters in range, split into the ones that never move and the ones that may
+	this->static_drawables_.clear();
+	this->static_transparents_.clear();
+	this->dynamic_drawables_.clear();
+	this->dynamic_transparents_.clear();
+	std::vector<const IDrawable*> static_casters;
+	std::vector<std::pair<const IDrawable*, glm::mat4>> dynamic_casters;
+	for (int transparent = 0; transparent < 2; transparent++) {
+		for (auto& caster : transparent ? transparents : drawables) {
+			if (!caster->is_enabled() || !this->is_in_shadow_range(caster)) {
+				continue;
+			}
+			if (caster->is_dynamic()) {
+				(transparent ? this->dynamic_transparents_ : this->dynamic_drawables_).push_back(caster);
+				dynamic_casters.push_back(std::make_pair(caster, caster->get_transformation()));
+			}
+			else {
+				(transparent ? this->static_transparents_ : this->static_drawables_).push_back(caster);
+				static_casters.push_back(caster);
+			}
+		}
+	}
+	const auto indirect_draw_list = this->get_rendering_engine()->get_indirect_draw_list();
+	const int static_revision = indirect_draw_list != nullptr ? indirect_draw_list->get_revision() : 0;
+
+	const int all_faces = (1 << this->shadow_strategy_->get_num_faces()) - 1;
+	if (!this->shadow_map_valid_ || this->get_transformation() != this->shadow_transformation_
+		|| static_revision != this->shadow_static_revision_ || static_casters != this->shadow_static_casters_) {
+		this->shadow_static_faces_ = all_faces;
+		this->shadow_dirty_faces_ = all_faces;
+	}
+	else if (dynamic_casters != this->shadow_dynamic_casters_) {
+		// only the faces a moved caster left or entered are outdated
+		for (auto& caster : dynamic_casters) {
+			if (std::find(this->shadow_dynamic_casters_.begin(), this->shadow_dynamic_casters_.end(), caster) == this->shadow_dynamic_casters_.end()) {
+				this->shadow_dirty_faces_ |= this->get_caster_faces(glm::vec3(caster.second[3]), caster.first->get_bounding_sphere_radius());
+			}
+		}
+		for (auto& caster : this->shadow_dynamic_casters_) {
+			if (std::find(dynamic_casters.begin(), dynamic_casters.end(), caster) == dynamic_casters.end()) {
+				this->shadow_dirty_faces_ |= this->get_caster_faces(glm::vec3(caster.second[3]), caster.first->get_bounding_sphere_radius());
+			}
+		}
+	}
+	this->shadow_static_faces_ |= moved_faces;
+	this->shadow_dirty_faces_ |= moved_faces;
+	this->shadow_map_valid_ = true;
+	this->shadow_transformation_ = this->get_transformation();
+	this->shadow_static_revision_ = static_revision;
+	this->shadow_static_casters_ = static_casters;
+	this->shadow_dynamic_casters_ = dynamic_casters;
+}
+
+void LightNode::render_shadow_map(const int faces) const
+{
+	const int dirty_faces = faces & this->get_dirty_shadow_faces();
+	if (dirty_faces == 0) {
+		return;
+	}
+	this->shadow_dirty_faces_ &= ~dirty_faces;
+	this->shadow_rendered_faces_ |= dirty_faces;
+
+	// only the casters reaching the face, without per face culling these are all casters in range
+	const auto select = [this](const int face, const std::vector<IDrawable*>& casters, std::vector<IDrawable*>& selected) {
+		for (auto& caster : casters) {
+			if (this->shadow_strategy_->is_caster_visible(this, face, caster->get_position(), caster->get_bounding_sphere_radius())) {
+				selected.push_back(caster);
+			}
+		}
+	};
+
+	// every face is a region of its own in the shadow atlas
+	for (int face = 0; face < this->shadow_strategy_->get_num_faces(); face++) {
+		if ((dirty_faces & (1 << face)) == 0) {
+			continue;
+		}
+		this->shadow_face_ = face;
+		std::vector<IDrawable*> drawables, transparents;
+		// the layers are combined with glCopyImageSubData, without it all casters are drawn whenever something changed
+		if (!GLAD_GL_VERSION_4_3) {
+			select(face, this->static_drawables_, drawables);
+			select(face, this->dynamic_drawables_, drawables);
+			select(face, this->static_transparents_, transparents);
+			select(face, this->dynamic_transparents_, transparents);
+			this->shadow_layer_ = SHADOW_LAYER_ALL;
+			this->render(drawables, transparents, {}, std::vector<LightNode*>());
+			continue;
+		}
+		if ((this->shadow_static_faces_ & (1 << face)) != 0) {
+			select(face, this->static_drawables_, drawables);
+			select(face, this->static_transparents_, transparents);
+			this->shadow_layer_ = SHADOW_LAYER_STATIC;
+			this->render(drawables, transparents, {}, std::vector<LightNode*>());
+			drawables.clear();
+			transparents.clear();
+		}
+		select(face, this->dynamic_drawables_, drawables);
+		select(face, this->dynamic_transparents_, transparents);
+		this->shadow_layer_ = SHADOW_LAYER_DYNAMIC;
+		this->render(drawables, transparents, {}, std::vector<LightNode*>());
+	}
+	this->shadow_static_faces_ &= ~dirty_faces;
+}
+
+int LightNode::get_dirty_shadow_faces() const
+{
+	if (!this->is_rendering_enabled() || !this->get_rendering_engine()->get_shadow_atlas()->has_region(this)) {
+		return 0;
+	}
+	return this->shadow_dirty_faces_;
+}
+
+bool LightNode::is_shadow_map_complete() const
+{
+	return this->shadow_strategy_ == nullptr || this->shadow_rendered_faces_ == (1 << this->shadow_strategy_->get_num_faces()) - 1;
+}
+
+void LightNode::invalidate_shadow_map() const
+{
+	if (this->shadow_strategy_ == nullptr) {
+		return;
+	}
+	const int all_faces = (1 << this->shadow_strategy_->get_num_faces()) - 1;
+	this->shadow_static_faces_ = all_faces;
+	this->shadow_dirty_faces_ = all_faces;
+	this->shadow_rendered_faces_ = 0;
+}
+
+float LightNode::get_screen_coverage(const RenderingNode* camera) const
+{
+	glm::vec3 center;
+	float radius;
+	if (!this->get_influence_sphere(center, radius)) {
+		return 1.0f;
+	}
+	const float distance = glm::distance(center, camera->get_position());
+	return distance > radius ? radius / distance : 1.0f;
+}
+
+bool LightNode::is_in_shadow_range(const IDrawable* caster) const
+{
+	// the shadow box of directional lights is not tested
+	if (this->light_type_ == DIRECTIONAL_LIGHT) {
+		return true;
+	}
+	// casters beyond the reach of the light only shadow what it does not light anyway
+	const float radius = caster->get_bounding_sphere_radius();
+	const float influence_radius = this->get_influence_radius();
+	const float range = influence_radius > 0.0f ? glm::min(influence_radius, this->shadow_strategy_->get_far_plane()) : this->shadow_strategy_->get_far_plane();
+	if (glm::distance(caster->get_position(), this->get_position()) - radius > range) {
+		return false;
+	}
+	return this->is_sphere_visible(caster->get_position(), radius);
+}
+
+int LightNode::get_caster_faces(const glm::vec3& center, const float radius) const
+{
+	int faces = 0;
+	for (int face = 0; face < this->shadow_strategy_->get_num_faces(); face++) {
+		if (this->shadow_strategy_->is_caster_visible(this, face, center, radius)) {
+			faces |= 1 << face;
+		}
+	}
+	return faces;
+}
+
+float LightNode::get_lod_tolerance() const
+{
+	// shadow maps are filtered and only seen through the lit surfaces, coarser levels of detail do not show
+	return 4.0f;
+}
+
 ShaderResource* LightNode::get_shader() const
 {
 	return this->shadow_strategy_ != nullptr ? this->shadow_strategy_->get_shader(this) : nullptr;
@@ -124,6 +332,50 @@ void LightNode::set_uniforms(ILightShader* shader)
 	}
 }
 
+float LightNode::get_influence_radius() const
+{
+	if (this->light_type_ == DIRECTIONAL_LIGHT || (this->linear_ <= 0.0f && this->quadratic_ <= 0.0f)) {
+		return -1.0f;
+	}
+	const float intensity = glm::max(glm::max(this->diffuse_.r, glm::max(this->diffuse_.g, this->diffuse_.b)), glm::max(this->specular_.r, glm::max(this->specular_.g, this->specular_.b)));
+
+	// solve intensity / (constant + linear * d + quadratic * d^2) = 1/256 for d
+	const float c = this->constant_ - intensity * 256.0f;
+	if (c >= 0.0f) {
+		return 0.0f;
+	}
+	if (this->quadratic_ <= 0.0f) {
+		return -c / this->linear_;
+	}
+	return (-this->linear_ + glm::sqrt(this->linear_ * this->linear_ - 4.0f * this->quadratic_ * c)) / (2.0f * this->quadratic_);
+}
+
+bool LightNode::get_influence_sphere(glm::vec3& center, float& radius) const
+{
+	const float range = this->get_influence_radius();
+	if (range < 0.0f) {
+		return false;
+	}
+	center = this->get_position();
+	radius = range;
+
+	const float angle = glm::radians(this->outer_cutoff_);
+	if (this->light_type_ == SPOT_LIGHT && angle < glm::half_pi<float>()) {
+		const glm::vec3 direction = glm::normalize(this->direction_);
+		if (angle >= glm::quarter_pi<float>()) {
+			// wide cones are enclosed by the sphere around their base
+			center += direction * (range * glm::cos(angle));
+			radius = range * glm::sin(angle);
+		}
+		else {
+			// narrow cones by the sphere through their apex and the rim of their base
+			radius = range / (2.0f * glm::cos(angle));
+			center += direction * radius;
+		}
+	}
+	return true;
+}
+
 /**
  * \brief 
  * \param is_volumetric is this light node actually volumetric
@@ -13,6 +13,20 @@ enum LightType
 	SPOT_LIGHT = 3
 };
 
+enum ShadowLayer
+{
+	SHADOW_LAYER_ALL = 1,		//all casters are drawn into the shadow map
+	SHADOW_LAYER_STATIC = 2,	//casters that never move are drawn into the cached static layer
+	SHADOW_LAYER_DYNAMIC = 3	//the static layer is copied into the shadow map and the dynamic casters are drawn on top
+};
+
+enum ShadowProjection
+{
+	SHADOW_PROJECTION_LINEAR = 1,		//the light space matrix projects to the map, directional and spot lights
+	SHADOW_PROJECTION_CUBE = 2,			//six perspective views of 90 degrees storing the distance to the light
+	SHADOW_PROJECTION_PARABOLOID = 3	//two paraboloid hemispheres storing the distance to the light, the matrices are views only
+};
+
 class LightNode :
 	public RenderingNode
 {
@@ -41,6 +55,24 @@ protected:
 	float tau_; // probability of collision
 	bool has_fog_;
 	int num_samples_; // how many ray march steps
+
+	// state the shadow map was rendered with, it is only rendered again when it changes
+	mutable ShadowLayer shadow_layer_;
+	mutable int shadow_face_;			//face drawn by the current shadow pass
+	mutable int shadow_static_faces_;	//faces whose static layer is outdated
+	mutable int shadow_dirty_faces_;	//faces whose shadow map is outdated
+	mutable int shadow_rendered_faces_;	//faces rendered at least once
+	mutable bool shadow_map_valid_;
+	mutable glm::mat4 shadow_transformation_;
+	mutable int shadow_static_revision_;
+	mutable std::vector<const IDrawable*> shadow_static_casters_;
+	mutable std::vector<std::pair<const IDrawable*, glm::mat4>> shadow_dynamic_casters_;
+	//casters in range found by the last prepare_shadow_map
+	mutable std::vector<IDrawable*> static_drawables_, static_transparents_, dynamic_drawables_, dynamic_transparents_;
+
+	bool is_in_shadow_range(const IDrawable* caster) const;
+	//faces a caster with the given bounding sphere can throw a shadow into
+	int get_caster_faces(const glm::vec3& center, float radius) const;
 public:
 	explicit LightNode(const std::string& name, LightType light_type);
 	~LightNode();
@@ -57,12 +89,32 @@ public:
 	void before_render(const std::vector<IDrawable*> &drawables, const std::vector<IDrawable*>& transparents, const std::vector<LightNode*> &light_nodess) const override;
 	void after_render(const std::vector<IDrawable*> &drawables, const std::vector<IDrawable*>& transparents, const std::vector<LightNode*> &light_nodes) const override;
 	bool is_rendering_enabled() const override;
+	bool renders_indirect_geometry() const override;
+	bool get_culling_view_projection(glm::mat4& view_projection) const override;
+	float get_lod_tolerance() const override;
+
+	//collects the casters in range and marks the faces of the shadow map outdated if the light, its fit to the camera or one of the casters changed
+	void prepare_shadow_map(const RenderingNode *camera, const std::vector<IDrawable*> &drawables, const std::vector<IDrawable*>& transparents) const;
+	//renders the given faces of the shadow map (bit i for face i) with the casters found by prepare_shadow_map
+	void render_shadow_map(int faces) const;
+	//faces of the shadow map which have to be rendered again, none while the light has no region in the shadow atlas
+	int get_dirty_shadow_faces() const;
+	//true once every face of the shadow map has been rendered
+	bool is_shadow_map_complete() const;
+	//marks all faces outdated and not rendered yet, e.g. after the region in the shadow atlas moved
+	void invalidate_shadow_map() const;
+	//approximate share of the camera's view the lit volume may cover, 1 for unbounded lights
+	float get_screen_coverage(const RenderingNode* camera) const;
 
 	void set_transformation(const glm::mat4& trafo, const glm::mat4& itrafo) override;
 	void set_transformation(const glm::mat4& trafo) override;
 	void apply_transformation(const glm::mat4& transformation, const glm::mat4& inverse_transformation) override;
 
 	void set_uniforms(ILightShader *shader);
+	//distance at which the light falls below 1/256 of its color, negative for lights without attenuation
+	float get_influence_radius() const;
+	//bounding sphere of the volume the light reaches (only the cone for spot lights), false if it is unbounded
+	bool get_influence_sphere(glm::vec3& center, float& radius) const;
 	void set_volumetric(const bool is_volumetric, float phi, float tau, bool has_fog = true, int num_samples = 16);
 
 	ShaderResource* get_shader() const override;
@@ -116,6 +168,16 @@ public:
 		return this->shadow_strategy_;
 	}
 
+	ShadowLayer get_shadow_layer() const
+	{
+		return this->shadow_layer_;
+	}
+
+	int get_shadow_face() const
+	{
+		return this->shadow_face_;
+	}
+
 	bool is_volumetric() const
 	{
 		return this->volumetric_;
@@ -162,5 +224,17 @@ public:
 	virtual void after_render(const LightNode *light_node) = 0;
 	virtual ShaderResource *get_shader(const LightNode *light_node) = 0;
 	virtual void set_uniforms(ILightShader* shader, LightNode* light_node) = 0;
+	//called every frame before the shadow map is prepared, returns the faces whose light space changed
+	virtual int update(const LightNode *light_node, const RenderingNode *camera) { return 0; }
+	//projection and view the face is rendered with
+	virtual glm::mat4 get_light_space_matrix(const LightNode *light_node, int face) const = 0;
+	//true if casters are culled against the light space of every face instead of the frustum of the light
+	virtual bool culls_faces() const { return false; }
+	//false if a caster with the given bounding sphere can't throw a shadow into the face
+	virtual bool is_caster_visible(const LightNode *light_node, int face, const glm::vec3& center, float radius) const { return true; }
+	virtual float get_far_plane() const = 0;
+	virtual int get_shadow_map_size() const = 0;
+	//number of separately rendered faces, e.g. six for cubemaps
+	virtual int get_num_faces() const = 0;
 };
 
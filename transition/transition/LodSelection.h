@@ -0,0 +1,24 @@
+#pragma once
+#include <glm/glm.hpp>
+
+/*
+Level of detail selection of a render pass: a level is good enough if its geometric error projects to at most
+the tolerated number of pixels of the pass.
+*/
+struct LodSelection
+{
+	glm::vec3 eye;
+	//pixels per world unit (at distance one for perspective projections) divided by the tolerated error in pixels
+	float scale;
+	bool perspective;
+
+	//projected error of a world space error on a bounding sphere, a level is tolerated if this is at most one
+	float get_projected_error(const float error, const glm::vec3& center, const float radius) const
+	{
+		if (!perspective) {
+			return error * scale;
+		}
+		const float distance = glm::distance(eye, center) - radius;
+		return distance > 0 ? error * scale / distance : error * scale * 1e6f;
+	}
+};
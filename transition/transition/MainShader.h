@@ -1,17 +1,16 @@
 #pragma once
 #include "ShaderResource.h"
-#include "ILightShader.h"
+#include "Material.h"
 
 class LightNode;
 class TextureResource;
+class LightGrid;
+class ShadowAtlas;
 
-const unsigned int max_nr_lights = 10;
-const unsigned int max_nr_directional_shadow_maps = 5;
-const unsigned int max_nr_omni_directional_shadow_maps = 5;
+const unsigned int max_nr_object_lights = 16;
 
 class MainShader :
-	public ShaderResource,
-	public ILightShader
+	public ShaderResource
 {
 	GLint model_uniform_;
 	GLint model_normal_uniform_;
@@ -23,26 +22,11 @@ class MainShader :
 	GLint material_has_alpha_tex_uniform_;
 	GLint material_alpha_cutoff_;
 
-	GLint num_lights_uniform_;
-	GLint light_type_uniform_[max_nr_lights];
-	GLint position_uniform_[max_nr_lights];
-	GLint direction_uniform_[max_nr_lights];
-	GLint constant_uniform_[max_nr_lights];
-	GLint linear_uniform_[max_nr_lights];
-	GLint quadratic_uniform_[max_nr_lights];
-	GLint diffuse_uniform_[max_nr_lights];
-	GLint specular_uniform_[max_nr_lights];
-	GLint shadow_casting_uniform_[max_nr_lights];
-	GLint shadow_min_bias_[max_nr_lights];
-	GLint shadow_max_bias_[max_nr_lights];
-	GLint shadow_map_index_uniform_[max_nr_lights];
-	GLint cutoff_uniform_[max_nr_lights];
-	GLint outer_cutoff_uniform_[max_nr_lights];
-	GLint far_plane_uniform_[max_nr_lights];
-	GLint near_plane_uniform_[max_nr_lights];
-	GLint omni_directional_shadow_maps_uniform_[max_nr_omni_directional_shadow_maps];
-	GLint directional_shadow_maps_uniform_[max_nr_directional_shadow_maps];
-	GLint light_space_matrices_uniform_[max_nr_directional_shadow_maps];
+	GLint shadow_atlas_uniform_;
+	GLint shadow_views_uniform_;
+	GLint shadow_filtered_uniform_;
+	GLint shadow_pcf_radius_uniform_;
+	GLint shadow_pcf_omni_samples_uniform_;
 	GLint view_pos_uniform_;
 	GLint material_shininess_;
 	GLint material_ambient_color_;
@@ -50,11 +34,19 @@ class MainShader :
 	GLint material_specular_color_;
 	GLint material_material_type_;
 	GLint material_opacity_;
-	int directional_shadow_map_index_;
-	int omni_directional_shadow_map_index_;
-	int light_index_;
+	GLint instanced_uniform_;
+	GLint light_grid_clusters_uniform_;
+	GLint light_grid_indices_uniform_;
+	GLint light_grid_lights_uniform_;
+	GLint light_grid_size_uniform_;
+	GLint light_grid_tile_size_uniform_;
+	GLint light_grid_depth_scale_bias_uniform_;
+	GLint object_light_count_uniform_;
+	GLint object_lights_uniform_;
+	const LightGrid *light_grid_;
 
-	int get_texture_slot() const;
+	void set_material_uniforms(const Material& material);
+	void set_object_light_uniforms(const GeometryNode* node);
 public:
 	explicit MainShader(const char *vertex_path = "assets/shaders/main_shader.vs", const char *fragment_path = "assets/shaders/main_shader.fs", const char *geometry_path = nullptr);
 	~MainShader();
@@ -63,8 +55,7 @@ public:
 	
 	void set_camera_uniforms(const RenderingNode* node) override;
 	void set_model_uniforms(const GeometryNode* node) override;
-	void set_light_uniforms(const std::vector<LightNode*>& light_nodes) override;
-
-	void set_directional_shadow_map_uniforms(const LightNode *light, const GLint shadow_map) override;
-	void set_omni_directional_shadow_map_uniforms(const LightNode *light, const GLint shadow_map, float far_plane, float near_plane) override;
+	bool set_instanced_model_uniforms(const GeometryNode* node) override;
+	void set_light_grid(const LightGrid *light_grid);
+	void set_shadow_atlas(const ShadowAtlas *shadow_atlas);
 };
@@ -101,3 +101,19 @@ void Material::set_alpha_cutoff(float cutoff)
 	alpha_cutoff_ = cutoff;
 }
 
+bool Material::operator==(const Material& other) const
+{
+	return this->ambient_color_ == other.ambient_color_
+		&& this->diffuse_color_ == other.diffuse_color_
+		&& this->specular_color_ == other.specular_color_
+		&& this->shininess_ == other.shininess_
+		&& this->opacity_ == other.opacity_
+		&& this->texture_ == other.texture_
+		&& this->alpha_texture_ == other.alpha_texture_
+		&& this->alpha_cutoff_ == other.alpha_cutoff_;
+}
+
+bool Material::operator!=(const Material& other) const
+{
+	return !(*this == other);
+}
@@ -53,4 +53,7 @@ public:
 
 	float get_alpha_cutoff() const;
 	void set_alpha_cutoff(float cutoff);
+
+	bool operator==(const Material& other) const;
+	bool operator!=(const Material& other) const;
 };
\ No newline at end of file
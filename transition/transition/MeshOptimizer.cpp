@@ -0,0 +1,322 @@
+#include "MeshOptimizer.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <map>
+#include <cmath>
+
+// size of the lru cache the triangle order is optimized for
+static const int optimizer_cache_size = 32;
+// size of the fifo cache used for the statistics, typical for current gpus
+static const int fifo_cache_size = 16;
+// clusters are not split into less triangles than this
+static const int min_cluster_size = 64;
+
+void MeshOptimizer::optimize(float*& positions, float*& normals, float*& uvs, int& num_vertices, unsigned int* indices, const int num_indices, Statistics* statistics)
+{
+	if (num_indices == 0) {
+		return;
+	}
+	const int num_triangles = num_indices / 3;
+	if (statistics != nullptr) {
+		statistics->vertices_before += num_vertices;
+		statistics->triangles += num_triangles;
+		statistics->transformed_before += calculate_acmr(indices, num_indices, num_vertices) * num_triangles;
+	}
+
+	weld_vertices(positions, normals, uvs, num_vertices, indices, num_indices);
+	optimize_vertex_cache(indices, num_indices, num_vertices);
+	optimize_overdraw(indices, num_indices, positions, num_vertices);
+	optimize_vertex_fetch(positions, normals, uvs, num_vertices, indices, num_indices);
+
+	if (statistics != nullptr) {
+		statistics->vertices_after += num_vertices;
+		statistics->transformed_after += calculate_acmr(indices, num_indices, num_vertices) * num_triangles;
+	}
+}
+
+float MeshOptimizer::calculate_acmr(const unsigned int* indices, const int num_indices, const int num_vertices)
+{
+	// a vertex is in the cache if less than fifo_cache_size vertices were inserted after it
+	std::vector<int> inserted(num_vertices, -fifo_cache_size - 1);
+	int time = 0;
+	int misses = 0;
+	for (int i = 0; i < num_indices; i++) {
+		if (time - inserted[indices[i]] > fifo_cache_size) {
+			inserted[indices[i]] = time++;
+			misses++;
+		}
+	}
+	return float(misses) / (num_indices / 3);
+}
+
+void MeshOptimizer::weld_vertices(float*& positions, float*& normals, float*& uvs, int& num_vertices, unsigned int* indices, const int num_indices)
+{
+	// only exactly equal vertices are merged, hard edges and uv seams stay
+	std::map<std::array<float, 8>, int> unique;
+	std::vector<int> remap(num_vertices);
+	int new_num_vertices = 0;
+	for (int i = 0; i < num_vertices; i++) {
+		const std::array<float, 8> key = {
+			positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2],
+			normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2],
+			uvs[i * 2], uvs[i * 2 + 1]
+		};
+		const auto inserted = unique.insert(std::make_pair(key, new_num_vertices));
+		if (inserted.second) {
+			new_num_vertices++;
+		}
+		remap[i] = inserted.first->second;
+	}
+	if (new_num_vertices != num_vertices) {
+		remap_vertices(positions, normals, uvs, num_vertices, indices, num_indices, remap, new_num_vertices);
+	}
+}
+
+std::vector<unsigned int> MeshOptimizer::get_position_remap(const float* positions, const int num_vertices)
+{
+	std::map<std::array<float, 3>, unsigned int> unique;
+	std::vector<unsigned int> remap(num_vertices);
+	for (int i = 0; i < num_vertices; i++) {
+		const std::array<float, 3> key = { positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2] };
+		remap[i] = unique.insert(std::make_pair(key, static_cast<unsigned int>(i))).first->second;
+	}
+	return remap;
+}
+
+static float vertex_score(const int cache_position, const int remaining_triangles)
+{
+	if (remaining_triangles == 0) {
+		return -1.0f;
+	}
+	float score = 0.0f;
+	if (cache_position >= 0) {
+		// the vertices of the last triangle get a fixed score, so the next triangle does not simply reuse them
+		if (cache_position < 3) {
+			score = 0.75f;
+		}
+		else {
+			score = std::pow(1.0f - float(cache_position - 3) / (optimizer_cache_size - 3), 1.5f);
+		}
+	}
+	// prefer vertices with few remaining triangles, so no lonely triangles are left behind
+	return score + 2.0f * std::pow(float(remaining_triangles), -0.5f);
+}
+
+void MeshOptimizer::optimize_vertex_cache(unsigned int* indices, const int num_indices, const int num_vertices)
+{
+	const int num_triangles = num_indices / 3;
+
+	// triangles using each vertex, the first remaining[v] entries are not emitted yet
+	std::vector<int> offsets(num_vertices + 1, 0);
+	for (int i = 0; i < num_indices; i++) {
+		offsets[indices[i] + 1]++;
+	}
+	for (int v = 0; v < num_vertices; v++) {
+		offsets[v + 1] += offsets[v];
+	}
+	std::vector<int> remaining(num_vertices, 0);
+	std::vector<int> adjacency(num_indices);
+	for (int i = 0; i < num_indices; i++) {
+		const int v = indices[i];
+		adjacency[offsets[v] + remaining[v]++] = i / 3;
+	}
+
+	std::vector<int> cache_position(num_vertices, -1);
+	std::vector<float> score(num_vertices);
+	for (int v = 0; v < num_vertices; v++) {
+		score[v] = vertex_score(-1, remaining[v]);
+	}
+	std::vector<float> triangle_score(num_triangles);
+	std::vector<bool> emitted(num_triangles, false);
+	int best = 0;
+	for (int t = 0; t < num_triangles; t++) {
+		triangle_score[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+		if (triangle_score[t] > triangle_score[best]) {
+			best = t;
+		}
+	}
+
+	std::vector<unsigned int> output;
+	output.reserve(num_indices);
+	std::vector<int> cache;
+	int scan_position = 0;
+	while (int(output.size()) < num_indices) {
+		if (best < 0) {
+			// nothing left around the cached vertices, continue with the next triangle in the original order
+			while (emitted[scan_position]) {
+				scan_position++;
+			}
+			best = scan_position;
+		}
+		emitted[best] = true;
+
+		std::vector<int> new_cache;
+		for (int k = 0; k < 3; k++) {
+			const int v = indices[best * 3 + k];
+			output.push_back(v);
+			if (std::find(new_cache.begin(), new_cache.end(), v) == new_cache.end()) {
+				new_cache.push_back(v);
+			}
+			const auto begin = adjacency.begin() + offsets[v];
+			const auto end = begin + remaining[v];
+			std::iter_swap(std::find(begin, end, best), end - 1);
+			remaining[v]--;
+		}
+		// the vertices of the triangle move to the front of the lru cache
+		const size_t triangle_vertices = new_cache.size();
+		for (auto v : cache) {
+			if (std::find(new_cache.begin(), new_cache.begin() + triangle_vertices, v) == new_cache.begin() + triangle_vertices) {
+				new_cache.push_back(v);
+			}
+		}
+
+		// vertices pushed out of the cache get their scores updated once more
+		for (size_t i = 0; i < new_cache.size(); i++) {
+			const int v = new_cache[i];
+			cache_position[v] = i < optimizer_cache_size ? int(i) : -1;
+			score[v] = vertex_score(cache_position[v], remaining[v]);
+		}
+
+		best = -1;
+		float best_score = -1.0f;
+		for (size_t i = 0; i < new_cache.size(); i++) {
+			const int v = new_cache[i];
+			for (int j = 0; j < remaining[v]; j++) {
+				const int t = adjacency[offsets[v] + j];
+				triangle_score[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+				if (triangle_score[t] > best_score) {
+					best_score = triangle_score[t];
+					best = t;
+				}
+			}
+		}
+
+		if (new_cache.size() > optimizer_cache_size) {
+			new_cache.resize(optimizer_cache_size);
+		}
+		cache.swap(new_cache);
+	}
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::optimize_overdraw(unsigned int* indices, const int num_indices, const float* positions, const int num_vertices)
+{
+	const int num_triangles = num_indices / 3;
+
+	// clusters start where the vertex cache order jumped to an unconnected part of the mesh (all vertices missed),
+	// reordering whole clusters keeps the cache efficiency inside of them
+	std::vector<int> cluster_starts = { 0 };
+	std::vector<int> inserted(num_vertices, -fifo_cache_size - 1);
+	int time = 0;
+	for (int t = 0; t < num_triangles; t++) {
+		int misses = 0;
+		for (int k = 0; k < 3; k++) {
+			const int v = indices[t * 3 + k];
+			if (time - inserted[v] > fifo_cache_size) {
+				inserted[v] = time++;
+				misses++;
+			}
+		}
+		if (misses == 3 && t - cluster_starts.back() >= min_cluster_size) {
+			cluster_starts.push_back(t);
+		}
+	}
+	if (cluster_starts.size() < 2) {
+		return;
+	}
+	cluster_starts.push_back(num_triangles);
+
+	// area weighted centroid and normal per cluster
+	struct Cluster
+	{
+		int first;
+		int count;
+		glm::vec3 centroid;
+		glm::vec3 normal;
+		float area;
+		float sort_key;
+	};
+	std::vector<Cluster> clusters;
+	glm::vec3 mesh_centroid(0);
+	float mesh_area = 0;
+	for (size_t c = 0; c + 1 < cluster_starts.size(); c++) {
+		Cluster cluster = { cluster_starts[c], cluster_starts[c + 1] - cluster_starts[c], glm::vec3(0), glm::vec3(0), 0, 0 };
+		for (int t = cluster.first; t < cluster.first + cluster.count; t++) {
+			const glm::vec3 a(positions[indices[t * 3] * 3], positions[indices[t * 3] * 3 + 1], positions[indices[t * 3] * 3 + 2]);
+			const glm::vec3 b(positions[indices[t * 3 + 1] * 3], positions[indices[t * 3 + 1] * 3 + 1], positions[indices[t * 3 + 1] * 3 + 2]);
+			const glm::vec3 c(positions[indices[t * 3 + 2] * 3], positions[indices[t * 3 + 2] * 3 + 1], positions[indices[t * 3 + 2] * 3 + 2]);
+			const glm::vec3 normal = glm::cross(b - a, c - a);
+			const float area = glm::length(normal);
+			cluster.centroid += (a + b + c) / 3.0f * area;
+			cluster.normal += normal;
+			cluster.area += area;
+		}
+		mesh_centroid += cluster.centroid;
+		mesh_area += cluster.area;
+		if (cluster.area > 0) {
+			cluster.centroid /= cluster.area;
+		}
+		clusters.push_back(cluster);
+	}
+	if (mesh_area > 0) {
+		mesh_centroid /= mesh_area;
+	}
+
+	// clusters on the outside facing away from the center occlude the others, so they are drawn first
+	for (auto& cluster : clusters) {
+		const float length = glm::length(cluster.normal);
+		cluster.sort_key = length > 0 ? glm::dot(cluster.centroid - mesh_centroid, cluster.normal / length) : 0;
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b)
+	{
+		return a.sort_key > b.sort_key;
+	});
+
+	std::vector<unsigned int> output;
+	output.reserve(num_indices);
+	for (auto& cluster : clusters) {
+		output.insert(output.end(), indices + cluster.first * 3, indices + (cluster.first + cluster.count) * 3);
+	}
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::optimize_vertex_fetch(float*& positions, float*& normals, float*& uvs, int& num_vertices, unsigned int* indices, const int num_indices)
+{
+	// vertices in the order they are first used by the triangles, unused ones are dropped
+	std::vector<int> remap(num_vertices, -1);
+	int new_num_vertices = 0;
+	for (int i = 0; i < num_indices; i++) {
+		if (remap[indices[i]] < 0) {
+			remap[indices[i]] = new_num_vertices++;
+		}
+	}
+	remap_vertices(positions, normals, uvs, num_vertices, indices, num_indices, remap, new_num_vertices);
+}
+
+void MeshOptimizer::remap_vertices(float*& positions, float*& normals, float*& uvs, int& num_vertices, unsigned int* indices, const int num_indices, const std::vector<int>& remap, const int new_num_vertices)
+{
+	float *new_positions = new float[new_num_vertices * 3];
+	float *new_normals = new float[new_num_vertices * 3];
+	float *new_uvs = new float[new_num_vertices * 2];
+	for (int i = 0; i < num_vertices; i++) {
+		const int v = remap[i];
+		if (v < 0) {
+			continue;
+		}
+		std::copy(positions + i * 3, positions + i * 3 + 3, new_positions + v * 3);
+		std::copy(normals + i * 3, normals + i * 3 + 3, new_normals + v * 3);
+		std::copy(uvs + i * 2, uvs + i * 2 + 2, new_uvs + v * 2);
+	}
+	for (int i = 0; i < num_indices; i++) {
+		indices[i] = remap[indices[i]];
+	}
+
+	delete[] positions;
+	delete[] normals;
+	delete[] uvs;
+	positions = new_positions;
+	normals = new_normals;
+	uvs = new_uvs;
+	num_vertices = new_num_vertices;
+}
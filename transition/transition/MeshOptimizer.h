@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+
+/*
+Import time optimization of indexed triangle meshes, in this order:
+- welding of vertices with identical position, normal and uv
+- triangle reordering for the post-transform vertex cache (Tom Forsyth's linear-speed vertex cache optimisation)
+- ordering of triangle clusters from the outside in, so that front faces tend to be drawn first (less overdraw)
+- reordering of the vertices in the order of their first use (vertex fetch locality)
+The vertex arrays have to be allocated with new[], they are reallocated if the vertex count changes.
+*/
+class MeshOptimizer
+{
+public:
+	//sums over the meshes passed to optimize
+	struct Statistics
+	{
+		int vertices_before = 0;
+		int vertices_after = 0;
+		int triangles = 0;
+		float transformed_before = 0.0f;	//vertices transformed by a simulated fifo cache, ACMR times triangles
+		float transformed_after = 0.0f;
+	};
+
+private:
+	static void weld_vertices(float *&positions, float *&normals, float *&uvs, int& num_vertices, unsigned int *indices, int num_indices);
+	static void optimize_overdraw(unsigned int *indices, int num_indices, const float *positions, int num_vertices);
+	static void optimize_vertex_fetch(float *&positions, float *&normals, float *&uvs, int& num_vertices, unsigned int *indices, int num_indices);
+
+	//moves vertex i to remap[i] (dropped if -1)
+	static void remap_vertices(float *&positions, float *&normals, float *&uvs, int& num_vertices, unsigned int *indices, int num_indices, const std::vector<int>& remap, int new_num_vertices);
+
+public:
+	//reorders the triangles for the post-transform vertex cache only, e.g. for additional levels of detail
+	static void optimize_vertex_cache(unsigned int *indices, int num_indices, int num_vertices);
+
+	//runs all steps, adds vertex counts and cache misses before and after to statistics unless it is nullptr
+	static void optimize(float *&positions, float *&normals, float *&uvs, int& num_vertices, unsigned int *indices, int num_indices, Statistics *statistics = nullptr);
+
+	//index of the first vertex with the same position for every vertex, depth-only indices drawn through it are not
+	//split at uv seams and hard edges, so the post-transform cache of the shadow passes hits more often
+	static std::vector<unsigned int> get_position_remap(const float *positions, int num_vertices);
+
+	//average cache miss ratio (transformed vertices per triangle) of a simulated fifo vertex cache
+	static float calculate_acmr(const unsigned int *indices, int num_indices, int num_vertices);
+};
@@ -2,6 +2,11 @@
 #include <cstring>
 #include "glheaders.h"
 #include "TextureRenderable.h"
+#include "GeometryArena.h"
+#include "VertexFormat.h"
+#include <glm/gtc/packing.hpp>
+#include <cassert>
+#include "MeshOptimizer.h"
 #include <ostream>
 #include <iostream>
 
@@ -200,6 +205,14 @@ MeshResource *MeshResource::create_sprite(TextureRenderable* resource, TextureRe
 		uvs[6] = 0.0f;
 	}
 
+#if _DEBUG
+	// the screen quads sample clamped render targets, their uvs have to reach the gpu exactly as given
+	const auto packed = VertexFormat::pack_attributes(uvs, normals, 4);
+	for (int i = 0; i < 4; i++) {
+		assert(glm::unpackHalf2x16(packed[i].uv) == glm::vec2(uvs[i * 2], uvs[i * 2 + 1]));
+	}
+#endif
+
 	unsigned int indices[] = {
 		0, 1, 2, // first triangle
 		3, 2, 1  // second triangle
@@ -240,10 +253,11 @@ MeshResource *MeshResource::create_sprite(TextureRenderable* resource, TextureRe
 
 MeshResource::MeshResource(float *vertices, float *normals, float *uvs, const int num_vertices, unsigned int *indices, const int num_indices, const Material& material) {
 	this->vao_ = -1;
+	this->depth_vao_ = -1;
 	this->vbo_positions_ = -1;
-	this->vbo_normals_ = -1;
-	this->vbo_uvs_ = -1;
+	this->vbo_attributes_ = -1;
 	this->ebo_ = -1;
+	this->vbo_instances_ = -1;
 
 	this->vertices_ = vertices;
 	this->normals_ = normals;
@@ -254,12 +268,30 @@ MeshResource::MeshResource(float *vertices, float *normals, float *uvs, const in
 	this->material_ = material;
 }
 
+MeshResource::MeshResource(MeshResource *geometry, const Material& material)
+{
+	this->vao_ = -1;
+	this->depth_vao_ = -1;
+	this->vbo_positions_ = -1;
+	this->vbo_attributes_ = -1;
+	this->ebo_ = -1;
+	this->vbo_instances_ = -1;
+
+	this->geometry_ = geometry;
+	this->num_vertices_ = 0;
+	this->indices_ = nullptr;
+	this->num_indices_ = 0;
+	this->material_ = material;
+}
+
 MeshResource::~MeshResource()
 {
 	if (this->vao_ != -1) {
 		glDeleteVertexArrays(1, &this->vao_);
+		glDeleteVertexArrays(1, &this->depth_vao_);
 		glDeleteBuffers(1, &this->vbo_positions_);
-		glDeleteBuffers(1, &this->vbo_normals_);
+		glDeleteBuffers(1, &this->vbo_attributes_);
+		glDeleteBuffers(1, &this->vbo_instances_);
 		glDeleteBuffers(1, &this->ebo_);
 	}
 
@@ -271,46 +303,196 @@ MeshResource::~MeshResource()
 
 int MeshResource::get_resource_id() const
 {
-	return this->vao_;
+	if (this->get_arena() != nullptr) {
+		return this->get_arena()->get_vao();
+	}
+	return this->get_geometry()->vao_;
+}
+
+int MeshResource::get_depth_resource_id() const
+{
+	if (this->get_arena() != nullptr) {
+		return this->get_arena()->get_depth_vao();
+	}
+	return this->get_geometry()->depth_vao_;
 }
 
 void MeshResource::init()
 {
+	if (this->geometry_ != nullptr) {
+		// buffers are created by the owning mesh
+		return;
+	}
+	// vertices split only by their uv or normal are one vertex for the depth passes
+	const auto position_remap = MeshOptimizer::get_position_remap(this->vertices_, this->num_vertices_);
+	bool welded = false;
+	for (int i = 0; i < this->num_vertices_ && !welded; i++) {
+		welded = position_remap[i] != static_cast<unsigned int>(i);
+	}
+	const auto get_depth_indices = [&position_remap](const unsigned int *indices, const int num_indices) {
+		std::vector<unsigned int> depth_indices(num_indices);
+		for (int i = 0; i < num_indices; i++) {
+			depth_indices[i] = position_remap[indices[i]];
+		}
+		return depth_indices;
+	};
+
+	// the arena only holds half float uvs, meshes tiling their textures too often keep float uvs in own buffers
+	const bool half_uvs = VertexFormat::has_half_uvs(this->uvs_, this->num_vertices_);
+	if (!half_uvs) {
+		this->arena_ = nullptr;
+	}
+
+	if (this->arena_ != nullptr) {
+		this->arena_->allocate(this->vertices_, this->uvs_, this->normals_, this->num_vertices_, this->indices_, this->num_indices_, this->base_vertex_, this->index_offset_, this->index_type_);
+		for (auto& lod : this->lods_) {
+			lod.index_offset = this->arena_->allocate_indices(lod.indices.data(), int(lod.indices.size()), this->index_type_);
+		}
+		this->depth_index_offset_ = this->index_offset_;
+		for (auto& lod : this->lods_) {
+			lod.depth_index_offset = lod.index_offset;
+		}
+		if (welded) {
+			const auto depth_indices = get_depth_indices(this->indices_, this->num_indices_);
+			this->depth_index_offset_ = this->arena_->allocate_indices(depth_indices.data(), this->num_indices_, this->index_type_);
+			for (auto& lod : this->lods_) {
+				const auto lod_depth_indices = get_depth_indices(lod.indices.data(), int(lod.indices.size()));
+				lod.depth_index_offset = this->arena_->allocate_indices(lod_depth_indices.data(), int(lod.indices.size()), this->index_type_);
+			}
+		}
+		return;
+	}
+
 	glGenVertexArrays(1, &this->vao_);
 	glGenBuffers(1, &this->vbo_positions_);
-	glGenBuffers(1, &this->vbo_normals_);
-	glGenBuffers(1, &this->vbo_uvs_);
+	glGenBuffers(1, &this->vbo_attributes_);
 	glGenBuffers(1, &this->ebo_);
+	glGenBuffers(1, &this->vbo_instances_);
 
 	glBindVertexArray(vao_);
 
-	//Bind Positions to Shader-Location 0
 	glBindBuffer(GL_ARRAY_BUFFER, this->vbo_positions_);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(float)*this->num_vertices_ * 3, this->vertices_, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
 
-	//Bind UVs to Shader-Location 1
-	glBindBuffer(GL_ARRAY_BUFFER, this->vbo_uvs_);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float)*this->num_vertices_ * 2, this->uvs_, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
+	glBindBuffer(GL_ARRAY_BUFFER, this->vbo_attributes_);
+	if (half_uvs) {
+		const auto attributes = VertexFormat::pack_attributes(this->uvs_, this->normals_, this->num_vertices_);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(VertexFormat::PackedAttributes) * attributes.size(), attributes.data(), GL_STATIC_DRAW);
+	}
+	else {
+		const auto attributes = VertexFormat::pack_wide_attributes(this->uvs_, this->normals_, this->num_vertices_);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(VertexFormat::WideAttributes) * attributes.size(), attributes.data(), GL_STATIC_DRAW);
+	}
 
-	//Bind Normals to Shader-Location 2
-	glBindBuffer(GL_ARRAY_BUFFER, this->vbo_normals_);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float)*this->num_vertices_ * 3, this->normals_, GL_STATIC_DRAW);
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+	VertexFormat::setup_attributes(this->vbo_positions_, this->vbo_attributes_, !half_uvs);
+
+	//Bind per-instance model matrix to Shader-Location 3-6 and normal matrix to 7-10
+	//initialized with one instance, so the attributes are valid for non-instanced draws too
+	glBindBuffer(GL_ARRAY_BUFFER, this->vbo_instances_);
+	const glm::mat4 identity[2] = { glm::mat4(1.0f), glm::mat4(1.0f) };
+	glBufferData(GL_ARRAY_BUFFER, sizeof(identity), identity, GL_STREAM_DRAW);
+	for (int i = 0; i < 8; i++) {
+		glEnableVertexAttribArray(3 + i);
+		glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::mat4), reinterpret_cast<void*>(i * sizeof(glm::vec4)));
+		glVertexAttribDivisor(3 + i, 1);
+	}
 
+	this->index_type_ = VertexFormat::get_index_type(this->num_vertices_);
+	// all levels of detail one after another
+	auto indices = VertexFormat::pack_indices(this->indices_, this->num_indices_, this->index_type_);
+	for (auto& lod : this->lods_) {
+		const auto lod_indices = VertexFormat::pack_indices(lod.indices.data(), int(lod.indices.size()), this->index_type_);
+		lod.index_offset = indices.size();
+		indices.insert(indices.end(), lod_indices.begin(), lod_indices.end());
+	}
+	// the welded indices of all levels follow
+	this->depth_index_offset_ = this->index_offset_;
+	for (auto& lod : this->lods_) {
+		lod.depth_index_offset = lod.index_offset;
+	}
+	if (welded) {
+		const auto depth_indices = VertexFormat::pack_indices(get_depth_indices(this->indices_, this->num_indices_).data(), this->num_indices_, this->index_type_);
+		this->depth_index_offset_ = indices.size();
+		indices.insert(indices.end(), depth_indices.begin(), depth_indices.end());
+		for (auto& lod : this->lods_) {
+			const auto lod_depth_indices = VertexFormat::pack_indices(get_depth_indices(lod.indices.data(), int(lod.indices.size())).data(), int(lod.indices.size()), this->index_type_);
+			lod.depth_index_offset = indices.size();
+			indices.insert(indices.end(), lod_depth_indices.begin(), lod_depth_indices.end());
+		}
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->ebo_);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size(), indices.data(), GL_STATIC_DRAW);
+
+	// positions, instance attributes and the same element buffer, nothing else is fetched by the depth passes
+	glGenVertexArrays(1, &this->depth_vao_);
+	glBindVertexArray(this->depth_vao_);
+	VertexFormat::setup_position_attribute(this->vbo_positions_);
+	glBindBuffer(GL_ARRAY_BUFFER, this->vbo_instances_);
+	for (int i = 0; i < 8; i++) {
+		glEnableVertexAttribArray(3 + i);
+		glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::mat4), reinterpret_cast<void*>(i * sizeof(glm::vec4)));
+		glVertexAttribDivisor(3 + i, 1);
+	}
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->ebo_);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int)*this->num_indices_, this->indices_, GL_STATIC_DRAW);
-
 
 	glBindVertexArray(0);
 }
 
+void MeshResource::add_lod(const std::vector<unsigned int>& indices, const float error)
+{
+	this->lods_.push_back({ indices, 0, 0, error });
+}
+
+int MeshResource::get_lod_num_indices(const int lod) const
+{
+	return lod == 0 ? this->get_num_indices() : int(this->get_geometry()->lods_[lod - 1].indices.size());
+}
+
+const unsigned int* MeshResource::get_lod_indices(const int lod) const
+{
+	return lod == 0 ? this->get_indices() : this->get_geometry()->lods_[lod - 1].indices.data();
+}
+
+int MeshResource::get_lod_first_index(const int lod) const
+{
+	return int(reinterpret_cast<GLintptr>(this->get_lod_index_offset(lod)) / VertexFormat::get_index_size(this->get_index_type()));
+}
+
+const void* MeshResource::get_lod_index_offset(const int lod) const
+{
+	return lod == 0 ? this->get_index_offset() : reinterpret_cast<const void*>(this->get_geometry()->lods_[lod - 1].index_offset);
+}
+
+int MeshResource::get_lod_depth_first_index(const int lod) const
+{
+	return int(reinterpret_cast<GLintptr>(this->get_lod_depth_index_offset(lod)) / VertexFormat::get_index_size(this->get_index_type()));
+}
+
+const void* MeshResource::get_lod_depth_index_offset(const int lod) const
+{
+	return reinterpret_cast<const void*>(lod == 0 ? this->get_geometry()->depth_index_offset_ : this->get_geometry()->lods_[lod - 1].depth_index_offset);
+}
+
+float MeshResource::get_lod_error(const int lod) const
+{
+	return lod == 0 ? 0.0f : this->get_geometry()->lods_[lod - 1].error;
+}
+
+int MeshResource::select_lod(const LodSelection& selection, const glm::vec3& center, const float radius, const float scale) const
+{
+	for (int lod = this->get_num_lods() - 1; lod > 0; lod--) {
+		if (selection.get_projected_error(this->get_lod_error(lod) * scale, center, radius) <= 1.0f) {
+			return lod;
+		}
+	}
+	return 0;
+}
+
 float MeshResource::calculate_sphere_radius(const glm::mat4& trafo) const
 {
+	if (this->geometry_ != nullptr) {
+		return this->geometry_->calculate_sphere_radius(trafo);
+	}
 	float maxlen = 0;
 	glm::vec3 origin = trafo * glm::vec4(0, 0, 0, 1);
 	for (int i = 0; i < num_vertices_; i++) {
@@ -320,3 +502,18 @@ float MeshResource::calculate_sphere_radius(const glm::mat4& trafo) const
 	}
 	return maxlen;
 }
+
+void MeshResource::set_instance_transformations(const std::vector<glm::mat4>& transformations) const
+{
+	// interleaved model and normal matrix per instance
+	std::vector<glm::mat4> data;
+	data.reserve(transformations.size() * 2);
+	for (auto& transformation : transformations) {
+		data.push_back(transformation);
+		data.push_back(glm::mat4(glm::transpose(glm::inverse(glm::mat3(transformation)))));
+	}
+	// orphan the old storage, it might still be in use by a previous draw
+	glBindBuffer(GL_ARRAY_BUFFER, this->get_arena() != nullptr ? this->get_arena()->get_instance_buffer() : this->get_geometry()->vbo_instances_);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * data.size(), data.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -2,9 +2,17 @@
 #include "IResource.h"
 #include "glheaders.h"
 #include "Material.h"
+#include "VertexFormat.h"
+#include "LodSelection.h"
+#include <vector>
+
+class GeometryArena;
 
 class MeshResource : public IResource
 {
+	// mesh which owns the vertex data and buffers, nullptr if this mesh owns them itself
+	MeshResource *geometry_ = nullptr;
+
 	float *vertices_ = nullptr;
 	float *normals_ = nullptr;
 	float *uvs_ = nullptr;
@@ -13,35 +21,143 @@ class MeshResource : public IResource
 	unsigned int *indices_;
 	int num_indices_;
 	GLuint vao_;
+	GLuint depth_vao_;
 	GLuint vbo_positions_;
-	GLuint vbo_normals_;
-	GLuint vbo_uvs_;
+	GLuint vbo_attributes_;
 	GLuint ebo_;
+	GLuint vbo_instances_;
+
+	// arena the vertex data is suballocated from, nullptr if the mesh has its own buffers
+	GeometryArena *arena_ = nullptr;
+	int base_vertex_ = 0;
+	GLintptr index_offset_ = 0;
+	GLenum index_type_ = GL_UNSIGNED_INT;
+	// indices with vertices of equal position welded, for the position-only stream, equal to index_offset_ if nothing was welded
+	GLintptr depth_index_offset_ = 0;
+
+	// coarser levels of detail, indices into the same vertices, level 0 are the indices above
+	struct Lod
+	{
+		std::vector<unsigned int> indices;
+		GLintptr index_offset;
+		GLintptr depth_index_offset;
+		float error;
+	};
+	std::vector<Lod> lods_;
 
 	Material material_;
 
 public:
+	static const int max_lods = 4;
+
 	static MeshResource *create_cube(glm::vec3 color);
 	static MeshResource *create_sprite(TextureRenderable *resource);
 	static MeshResource *create_sprite(TextureRenderable *resource, TextureRenderable *alpha, bool switch_uv);
 
 	MeshResource(float *vertices, float *normals, float *uvs, int num_vertices, unsigned int *indices, int num_indices, const Material& material);
+	//shares the vertex data and buffers of geometry, but has its own material
+	MeshResource(MeshResource *geometry, const Material& material);
 	~MeshResource();
 
 	int get_resource_id() const override;
+	//vao with only the positions and the per-instance attributes, for depth-only shaders
+	int get_depth_resource_id() const;
 	void init() override;
 
 	//calculates the radius of a sphere with center at the origin which contains all vertices
 	float calculate_sphere_radius(const glm::mat4& trafo) const;
 
+	//uploads model and normal matrices to the per-instance attributes (location 3-10) of the vao
+	void set_instance_transformations(const std::vector<glm::mat4>& transformations) const;
+
+	//has to be set before init, the mesh is then stored in the arena instead of own buffers unless its uvs need float precision
+	void set_arena(GeometryArena *arena)
+	{
+		this->arena_ = arena;
+	}
+
+	GeometryArena* get_arena() const
+	{
+		return get_geometry()->arena_;
+	}
+
+	int get_base_vertex() const
+	{
+		return get_geometry()->base_vertex_;
+	}
+
+	//GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, depending on the number of vertices
+	GLenum get_index_type() const
+	{
+		return get_geometry()->index_type_;
+	}
+
+	//first index in units of the index type
+	int get_first_index() const
+	{
+		return int(get_geometry()->index_offset_ / VertexFormat::get_index_size(get_index_type()));
+	}
+
+	//offset of the first index in the element buffer, as expected by glDrawElements
+	const void* get_index_offset() const
+	{
+		return reinterpret_cast<const void*>(get_geometry()->index_offset_);
+	}
+
+	//adds the next coarser level of detail with its geometric error in object space, has to be called before init
+	void add_lod(const std::vector<unsigned int>& indices, float error);
+
+	int get_num_lods() const
+	{
+		return 1 + int(get_geometry()->lods_.size());
+	}
+
+	int get_lod_num_indices(int lod) const;
+	const unsigned int* get_lod_indices(int lod) const;
+	//first index and byte offset of the level in the element buffer
+	int get_lod_first_index(int lod) const;
+	const void* get_lod_index_offset(int lod) const;
+	//same triangles in the same order, but indexing the welded positions of get_depth_resource_id()
+	int get_lod_depth_first_index(int lod) const;
+	const void* get_lod_depth_index_offset(int lod) const;
+	float get_lod_error(int lod) const;
+
+	//coarsest level tolerated by the selection for the given bounding sphere, scale converts object space errors to world space
+	int select_lod(const LodSelection& selection, const glm::vec3& center, float radius, float scale) const;
+
+	const MeshResource* get_geometry() const
+	{
+		return geometry_ != nullptr ? geometry_ : this;
+	}
+
 	int get_num_indices() const
 	{
-		return num_indices_;
+		return get_geometry()->num_indices_;
 	}
 
 	int get_num_vertices() const
 	{
-		return num_vertices_;
+		return get_geometry()->num_vertices_;
+	}
+
+	const float* get_vertices() const
+	{
+		return get_geometry()->vertices_;
+	}
+
+	const float* get_normals() const
+	{
+		return get_geometry()->normals_;
+	}
+
+	const float* get_uvs() const
+	{
+		return get_geometry()->uvs_;
+	}
+
+	const unsigned int* get_indices() const
+	{
+		return get_geometry()->indices_;
 	}
 
 	const Material& get_material() const {
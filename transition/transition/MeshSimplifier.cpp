@@ -0,0 +1,229 @@
+#include "MeshSimplifier.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <map>
+#include <cmath>
+
+// symmetric 4x4 matrix, sum of the squared distances to a set of planes
+struct Quadric
+{
+	double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+
+	Quadric()
+	{
+		a00 = a01 = a02 = a03 = a11 = a12 = a13 = a22 = a23 = a33 = 0;
+	}
+
+	explicit Quadric(const glm::dvec4& plane)
+	{
+		a00 = plane.x * plane.x; a01 = plane.x * plane.y; a02 = plane.x * plane.z; a03 = plane.x * plane.w;
+		a11 = plane.y * plane.y; a12 = plane.y * plane.z; a13 = plane.y * plane.w;
+		a22 = plane.z * plane.z; a23 = plane.z * plane.w;
+		a33 = plane.w * plane.w;
+	}
+
+	Quadric& operator+=(const Quadric& q)
+	{
+		a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+		a11 += q.a11; a12 += q.a12; a13 += q.a13;
+		a22 += q.a22; a23 += q.a23;
+		a33 += q.a33;
+		return *this;
+	}
+
+	double error(const glm::dvec3& v) const
+	{
+		return a00 * v.x * v.x + 2 * a01 * v.x * v.y + 2 * a02 * v.x * v.z + 2 * a03 * v.x
+			+ a11 * v.y * v.y + 2 * a12 * v.y * v.z + 2 * a13 * v.y
+			+ a22 * v.z * v.z + 2 * a23 * v.z
+			+ a33;
+	}
+};
+
+struct Collapse
+{
+	unsigned int from;
+	unsigned int to;
+	double cost;
+};
+
+static glm::vec3 get_position(const float* positions, const unsigned int v)
+{
+	return glm::vec3(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]);
+}
+
+std::vector<unsigned int> MeshSimplifier::simplify(const unsigned int* indices, const int num_indices, const float* positions, const int num_vertices, const int target_num_indices, float& error)
+{
+	std::vector<unsigned int> result(indices, indices + num_indices);
+	error = 0;
+
+	// vertices at the same position (split by normals or uvs) share one quadric and are locked if there is more than one
+	std::map<std::array<float, 3>, unsigned int> unique_positions;
+	std::vector<unsigned int> position_id(num_vertices);
+	std::vector<int> wedges;
+	for (int v = 0; v < num_vertices; v++) {
+		const std::array<float, 3> key = { positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2] };
+		const auto inserted = unique_positions.insert(std::make_pair(key, static_cast<unsigned int>(wedges.size())));
+		if (inserted.second) {
+			wedges.push_back(0);
+		}
+		position_id[v] = inserted.first->second;
+		wedges[position_id[v]]++;
+	}
+	std::vector<bool> locked(num_vertices, false);
+	for (int v = 0; v < num_vertices; v++) {
+		locked[v] = wedges[position_id[v]] > 1;
+	}
+
+	// border edges are only used by one triangle
+	std::map<std::pair<unsigned int, unsigned int>, int> edge_use;
+	for (int i = 0; i < num_indices; i += 3) {
+		for (int k = 0; k < 3; k++) {
+			const auto a = position_id[indices[i + k]];
+			const auto b = position_id[indices[i + (k + 1) % 3]];
+			edge_use[std::make_pair(std::min(a, b), std::max(a, b))]++;
+		}
+	}
+	std::vector<bool> border(wedges.size(), false);
+	for (auto& edge : edge_use) {
+		if (edge.second == 1) {
+			border[edge.first.first] = true;
+			border[edge.first.second] = true;
+		}
+	}
+	for (int v = 0; v < num_vertices; v++) {
+		locked[v] = locked[v] || border[position_id[v]];
+	}
+
+	// indexed by position id, the quadric of a split vertex holds the planes of the triangles of all its wedges
+	std::vector<Quadric> quadrics(wedges.size());
+	for (int i = 0; i < num_indices; i += 3) {
+		const glm::dvec3 a = get_position(positions, indices[i]);
+		const glm::dvec3 b = get_position(positions, indices[i + 1]);
+		const glm::dvec3 c = get_position(positions, indices[i + 2]);
+		const glm::dvec3 normal = glm::cross(b - a, c - a);
+		const double length = glm::length(normal);
+		if (length == 0) {
+			continue;
+		}
+		const Quadric quadric(glm::dvec4(normal / length, -glm::dot(normal / length, a)));
+		for (int k = 0; k < 3; k++) {
+			quadrics[position_id[indices[i + k]]] += quadric;
+		}
+	}
+
+	std::vector<unsigned int> remap(num_vertices);
+	std::vector<bool> touched(num_vertices);
+	std::vector<int> offsets(num_vertices + 1);
+	std::vector<int> adjacency;
+	while (int(result.size()) > target_num_indices) {
+		// triangles around every vertex
+		std::fill(offsets.begin(), offsets.end(), 0);
+		for (auto v : result) {
+			offsets[v + 1]++;
+		}
+		for (int v = 0; v < num_vertices; v++) {
+			offsets[v + 1] += offsets[v];
+		}
+		adjacency.resize(result.size());
+		std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++) {
+			adjacency[fill[result[i]]++] = int(i / 3);
+		}
+
+		// every unlocked vertex may collapse onto one of its neighbours
+		std::vector<Collapse> collapses;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int k = 0; k < 3; k++) {
+				const auto from = result[i + k];
+				if (locked[from]) {
+					continue;
+				}
+				for (int other = 1; other < 3; other++) {
+					const auto to = result[i + (k + other) % 3];
+					Quadric quadric = quadrics[position_id[from]];
+					quadric += quadrics[position_id[to]];
+					collapses.push_back({ from, to, quadric.error(glm::dvec3(get_position(positions, to))) });
+				}
+			}
+		}
+		if (collapses.empty()) {
+			break;
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+		{
+			return a.cost < b.cost;
+		});
+
+		// collapse the cheapest edges, each vertex region only once per pass so the checks stay valid
+		for (int v = 0; v < num_vertices; v++) {
+			remap[v] = v;
+		}
+		std::fill(touched.begin(), touched.end(), false);
+		int removed_triangles = 0;
+		const int triangles_to_remove = (int(result.size()) - target_num_indices) / 3;
+		for (auto& collapse : collapses) {
+			if (removed_triangles >= triangles_to_remove) {
+				break;
+			}
+			if (touched[collapse.from] || touched[collapse.to]) {
+				continue;
+			}
+
+			// triangles moving with the vertex must not flip
+			bool flips = false;
+			int removes = 0;
+			const glm::vec3 target = get_position(positions, collapse.to);
+			for (int j = offsets[collapse.from]; j < offsets[collapse.from + 1] && !flips; j++) {
+				const int t = adjacency[j] * 3;
+				if (result[t] == collapse.to || result[t + 1] == collapse.to || result[t + 2] == collapse.to) {
+					removes++;
+					continue;
+				}
+				glm::vec3 corners[3];
+				glm::vec3 moved[3];
+				for (int k = 0; k < 3; k++) {
+					corners[k] = get_position(positions, result[t + k]);
+					moved[k] = result[t + k] == collapse.from ? target : corners[k];
+				}
+				const glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+				const glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+				flips = glm::dot(before, after) <= 0;
+			}
+			if (flips) {
+				continue;
+			}
+
+			remap[collapse.from] = collapse.to;
+			quadrics[position_id[collapse.to]] += quadrics[position_id[collapse.from]];
+			error = std::max(error, float(std::sqrt(std::max(collapse.cost, 0.0))));
+			removed_triangles += removes;
+			for (int j = offsets[collapse.from]; j < offsets[collapse.from + 1]; j++) {
+				const int t = adjacency[j] * 3;
+				for (int k = 0; k < 3; k++) {
+					touched[result[t + k]] = true;
+				}
+			}
+		}
+		if (removed_triangles == 0) {
+			break;
+		}
+
+		// apply the collapses and drop the degenerated triangles
+		std::vector<unsigned int> collapsed;
+		collapsed.reserve(result.size());
+		for (size_t i = 0; i < result.size(); i += 3) {
+			const auto a = remap[result[i]];
+			const auto b = remap[result[i + 1]];
+			const auto c = remap[result[i + 2]];
+			if (a != b && b != c && a != c) {
+				collapsed.push_back(a);
+				collapsed.push_back(b);
+				collapsed.push_back(c);
+			}
+		}
+		result.swap(collapsed);
+	}
+	return result;
+}
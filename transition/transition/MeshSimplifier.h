@@ -0,0 +1,14 @@
+#pragma once
+#include <vector>
+
+/*
+Simplifies an indexed triangle mesh with edge collapses ordered by the quadric error metric (Garland/Heckbert).
+Vertices only collapse onto existing vertices, so the result is an index buffer for the unchanged vertex data.
+Vertices on borders and attribute seams are never moved, which keeps the mesh closed and the uvs intact.
+*/
+class MeshSimplifier
+{
+public:
+	//returns at most target_num_indices indices if possible, error is the largest geometric error of a collapse (in object space)
+	static std::vector<unsigned int> simplify(const unsigned int *indices, int num_indices, const float *positions, int num_vertices, int target_num_indices, float& error);
+};
@@ -17,6 +17,7 @@ class Node
 	RenderingEngine *rendering_engine_;
 	std::string name_;
 	bool enabled_ = true;
+	bool dynamic_ = false;
 
 public:
 	explicit Node(const std::string& name);
@@ -76,5 +77,17 @@ public:
 	virtual bool is_enabled() const {
 		return enabled_;
 	}
+
+	/*
+	Nodes which get transformed or change their material after initialization have to be marked as dynamic,
+	all others may be merged into static batches.
+	*/
+	virtual void set_dynamic(bool dynamic) {
+		dynamic_ = dynamic;
+	}
+
+	bool is_dynamic() const {
+		return dynamic_;
+	}
 };
 
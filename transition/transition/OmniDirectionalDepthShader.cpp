@@ -5,15 +5,13 @@
 #include "OmniDirectionalShadowStrategy.h"
 
 
-OmniDirectionalDepthShader::OmniDirectionalDepthShader() : ShaderResource("assets/shaders/depth_shader_omni_directional.vs", "assets/shaders/depth_shader_omni_directional.fs", "assets/shaders/depth_shader_omni_directional.gs")
+OmniDirectionalDepthShader::OmniDirectionalDepthShader() : ShaderResource("assets/shaders/depth_shader_omni_directional.vs", "assets/shaders/depth_shader_omni_directional.fs")
 {
 	this->model_uniform_ = -1;
+	this->instanced_uniform_ = -1;
 	this->light_pos_uniform_ = -1;
 	this->far_plane_uniform_ = -1;
-	for (auto i = 0; i < 6; i++)
-	{
-		this->shadow_transform_uniform_[i] = -1;
-	}
+	this->shadow_transform_uniform_ = -1;
 }
 
 OmniDirectionalDepthShader::~OmniDirectionalDepthShader()
@@ -25,13 +23,10 @@ void OmniDirectionalDepthShader::init()
 	ShaderResource::init();
 
 	this->model_uniform_ = get_uniform("model");
+	this->instanced_uniform_ = get_uniform("instanced");
 	this->light_pos_uniform_ = get_uniform("light_pos");
 	this->far_plane_uniform_ = get_uniform("far_plane");
-
-	for (auto i = 0; i < 6; i++)
-	{
-		this->shadow_transform_uniform_[i] = get_uniform("shadow_transform", i);
-	}
+	this->shadow_transform_uniform_ = get_uniform("shadow_transform");
 }
 
 void OmniDirectionalDepthShader::set_camera_uniforms(const RenderingNode* rendering_node)
@@ -41,24 +36,11 @@ void OmniDirectionalDepthShader::set_camera_uniforms(const RenderingNode* render
 	assert(this->model_uniform_ >= 0);
 	assert(this->light_pos_uniform_ >= 0);
 	assert(this->far_plane_uniform_ >= 0);
+	assert(this->shadow_transform_uniform_ >= 0);
 
-	glm::mat4 shadow_transforms[6];
-	const auto& light_pos = node->get_position();
-
-	shadow_transforms[0] = glm::lookAt(light_pos, light_pos + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f));
-	shadow_transforms[1] = glm::lookAt(light_pos, light_pos + glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f));
-	shadow_transforms[2] = glm::lookAt(light_pos, light_pos + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-	shadow_transforms[3] = glm::lookAt(light_pos, light_pos + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
-	shadow_transforms[4] = glm::lookAt(light_pos, light_pos + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
-	shadow_transforms[5] = glm::lookAt(light_pos, light_pos + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
-
-	for (auto i = 0; i < 6; i++)
-	{
-		assert(this->shadow_transform_uniform_[i] >= 0);
-
-		const auto &transform = node->get_projection_matrix() * shadow_transforms[i];
-		glUniformMatrix4fv(this->shadow_transform_uniform_[i], 1, GL_FALSE, &transform[0][0]);
-	}
+	// one face is rendered per pass, into its own region of the shadow atlas
+	const auto transform = node->get_shadow_strategy()->get_light_space_matrix(node, node->get_shadow_face());
+	glUniformMatrix4fv(this->shadow_transform_uniform_, 1, GL_FALSE, &transform[0][0]);
 
 	// static cast is okay, since it only makes sense to use OmniDirectionalDepthShader with OmniDirectionalShadowStrategy
 	const auto strategy = static_cast<OmniDirectionalShadowStrategy*>(node->get_shadow_strategy());
@@ -70,5 +52,14 @@ void OmniDirectionalDepthShader::set_camera_uniforms(const RenderingNode* render
 void OmniDirectionalDepthShader::set_model_uniforms(const GeometryNode* node)
 {
 	assert(this->model_uniform_ >= 0);
+	assert(this->instanced_uniform_ >= 0);
+	glUniform1i(this->instanced_uniform_, 0);
 	glUniformMatrix4fv(this->model_uniform_, 1, GL_FALSE, &node->get_transformation()[0][0]);
 }
+
+bool OmniDirectionalDepthShader::set_instanced_model_uniforms(const GeometryNode* node)
+{
+	assert(this->instanced_uniform_ >= 0);
+	glUniform1i(this->instanced_uniform_, 1);
+	return true;
+}
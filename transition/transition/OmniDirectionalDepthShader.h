@@ -9,9 +9,10 @@ class OmniDirectionalDepthShader :
 {
 	glm::mat4 view_projection_;
 	GLint model_uniform_;
+	GLint instanced_uniform_;
 	GLint light_pos_uniform_;
 	GLint far_plane_uniform_;
-	GLint shadow_transform_uniform_[6];
+	GLint shadow_transform_uniform_;
 public:
 	OmniDirectionalDepthShader();
 	~OmniDirectionalDepthShader();
@@ -20,5 +21,11 @@ public:
 
 	void set_camera_uniforms(const RenderingNode* node) override;
 	void set_model_uniforms(const GeometryNode* node) override;
+	bool set_instanced_model_uniforms(const GeometryNode* node) override;
+
+	bool is_depth_only() const override
+	{
+		return true;
+	}
 };
 
@@ -3,15 +3,13 @@
 #include "ShaderResource.h"
 #include "OmniDirectionalDepthShader.h"
 #include "ILightShader.h"
+#include "ShadowAtlas.h"
 
 OmniDirectionalShadowStrategy::OmniDirectionalShadowStrategy(const int shadow_map_size, const float near_plane, const float far_plane)
 {
 	this->shadow_map_size_ = shadow_map_size;
 	this->near_plane_ = near_plane;
 	this->far_plane_ = far_plane;
-
-	this->depth_cubemap_ = -1;
-	this->depth_cubemap_fbo_ = -1;
 }
 
 
@@ -24,34 +22,40 @@ void OmniDirectionalShadowStrategy::init(LightNode* light_node)
 	light_node->set_viewport(glm::ivec2(this->shadow_map_size_, this->shadow_map_size_));
 
 	light_node->set_projection_matrix(glm::perspective(glm::radians(90.0f), 1.0f, this->near_plane_, this->far_plane_));
+}
 
-
-	glGenFramebuffers(1, &this->depth_cubemap_fbo_);
-	glGenTextures(1, &this->depth_cubemap_);
-
-	glBindTexture(GL_TEXTURE_CUBE_MAP, this->depth_cubemap_);
-	for (unsigned int i = 0; i < 6; ++i) {
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT,
-			shadow_map_size_, shadow_map_size_, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+glm::mat4 OmniDirectionalShadowStrategy::get_face_view_matrix(const glm::vec3& light_pos, const int face)
+{
+	switch (face) {
+	case 0: return glm::lookAt(light_pos, light_pos + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+	case 1: return glm::lookAt(light_pos, light_pos + glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+	case 2: return glm::lookAt(light_pos, light_pos + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	case 3: return glm::lookAt(light_pos, light_pos + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+	case 4: return glm::lookAt(light_pos, light_pos + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+	default: return glm::lookAt(light_pos, light_pos + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f));
 	}
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, this->depth_cubemap_fbo_);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->depth_cubemap_, 0);
-	glDrawBuffer(GL_NONE);
-	glReadBuffer(GL_NONE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+glm::mat4 OmniDirectionalShadowStrategy::get_light_space_matrix(const LightNode* light_node, const int face) const
+{
+	return light_node->get_projection_matrix() * get_face_view_matrix(light_node->get_position(), face);
+}
+
+bool OmniDirectionalShadowStrategy::is_caster_visible(const LightNode* light_node, const int face, const glm::vec3& center, const float radius) const
+{
+	// the frustum of a face is the pyramid where the face's axis dominates the other two, |u| <= axis and |v| <= axis
+	const glm::vec3 delta = center - light_node->get_position();
+	const int axis = face / 2;
+	const float along = (face % 2 == 0) ? delta[axis] : -delta[axis];
+	const float margin = radius * glm::sqrt(2.0f);
+	return along - glm::abs(delta[(axis + 1) % 3]) >= -margin && along - glm::abs(delta[(axis + 2) % 3]) >= -margin;
 }
 
 void OmniDirectionalShadowStrategy::before_render(const LightNode *light_node)
 {
-	glBindFramebuffer(GL_FRAMEBUFFER, this->depth_cubemap_fbo_);
-	glClear(GL_DEPTH_BUFFER_BIT);
+	// every face is an own region of the atlas, the faces not drawn in this pass keep what an earlier frame rendered
+	const int face = light_node->get_shadow_face();
+	light_node->get_rendering_engine()->get_shadow_atlas()->begin_rendering(light_node, face, light_node->get_shadow_layer(), this->get_light_space_matrix(light_node, face));
 
 	const auto shader = light_node->get_shader();
 	shader->use();
@@ -63,7 +67,7 @@ void OmniDirectionalShadowStrategy::before_render(const LightNode *light_node)
 void OmniDirectionalShadowStrategy::after_render(const LightNode *light_node)
 {
 	glCullFace(GL_BACK);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	light_node->get_rendering_engine()->get_shadow_atlas()->end_rendering();
 }
 
 ShaderResource* OmniDirectionalShadowStrategy::get_shader(const LightNode *light_node)
@@ -73,5 +77,5 @@ ShaderResource* OmniDirectionalShadowStrategy::get_shader(const LightNode *light
 
 void OmniDirectionalShadowStrategy::set_uniforms(ILightShader* shader, LightNode* light_node)
 {
-	shader->set_omni_directional_shadow_map_uniforms(light_node, this->depth_cubemap_, this->far_plane_, this->near_plane_);
+	shader->set_shadow_map_uniforms(light_node, light_node->get_rendering_engine()->get_shadow_atlas()->get_first_view(light_node), this->far_plane_, SHADOW_PROJECTION_CUBE);
 }
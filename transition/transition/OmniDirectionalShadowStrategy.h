@@ -3,11 +3,9 @@
 class OmniDirectionalShadowStrategy :
 	public IShadowStrategy
 {
-	GLuint depth_cubemap_;
 	int shadow_map_size_;
 	float near_plane_;
 	float far_plane_;
-	GLuint depth_cubemap_fbo_;
 public:
 	explicit OmniDirectionalShadowStrategy(int shadow_map_size, float near_plane = 1.0f, float far_plane = 300.0f);
 	~OmniDirectionalShadowStrategy();
@@ -18,8 +16,18 @@ public:
 	ShaderResource *get_shader(const LightNode *light_node) override;
 
 	void set_uniforms(ILightShader* shader, LightNode* light_node) override;
+	glm::mat4 get_light_space_matrix(const LightNode *light_node, int face) const override;
+	bool is_caster_visible(const LightNode *light_node, int face, const glm::vec3& center, float radius) const override;
 
-	float get_far_plane() const
+	bool culls_faces() const override
+	{
+		return true;
+	}
+
+	//view matrix of a cube face in the order +X, -X, +Y, -Y, +Z, -Z, matching get_cube_face() of the shaders
+	static glm::mat4 get_face_view_matrix(const glm::vec3& light_pos, int face);
+
+	float get_far_plane() const override
 	{
 		return this->far_plane_;
 	}
@@ -28,5 +36,15 @@ public:
 	{
 		return this->near_plane_;
 	}
+
+	int get_shadow_map_size() const override
+	{
+		return this->shadow_map_size_;
+	}
+
+	int get_num_faces() const override
+	{
+		return 6;
+	}
 };
 
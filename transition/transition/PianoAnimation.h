@@ -360,6 +360,7 @@ public:
 	explicit PianoAnimation(std::string name, Node* piano) : AnimatorNode(name)
 	{
 		this->piano_ = piano;
+		this->piano_->set_dynamic(true);
 	}
 
 	void start_if_not_automatic() override {
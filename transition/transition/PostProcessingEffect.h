@@ -4,6 +4,7 @@
 #include "RenderingEngine.h"
 #include "MeshResource.h"
 #include "TextureFBO.h"
+#include "FrameGraph.h"
 
 class LightNode;
 
@@ -21,9 +22,9 @@ public:
 	virtual void init(RenderingEngine *engine, CameraNode *camera) = 0;
 
 	/*
-	Performs the effect.
-	from is the TextureFBO which contains the original image. fbo_to is the id of the framebuffer to render the result into
+	Declares the passes of the effect for this frame.
+	from is the texture of the graph which contains the original image. Returns the texture holding the result
 	*/
-	virtual void perform_effect(const TextureFBO* from, GLuint fbo_to, const std::vector<LightNode *> light_nodes) = 0;
+	virtual int add_passes(FrameGraph *graph, int from, const std::vector<LightNode *>& light_nodes) = 0;
 
 };
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include "QualityGovernor.h"
+#include "FrameTimer.h"
+#include <glm/glm.hpp>
+
+// lowest to highest, the highest matches the fixed settings without governor
+const QualityLevel QualityGovernor::levels_[num_levels] = {
+	{ 0.25f, 2, 0, 8, 1 },
+	{ 0.5f, 1, 1, 8, 1 },
+	{ 0.75f, 1, 1, 20, 2 },
+	{ 1.0f, 0, 2, 20, 3 }
+};
+
+//frames over the budget before the level drops
+static const int lower_frames = 10;
+//frames below raise_threshold of the budget before the level rises, doubled up to max_raise_frames
+static const int min_raise_frames = 120;
+static const int max_raise_frames = 1920;
+static const float raise_threshold = 0.7f;
+//weight of the newest frame time in the smoothed one
+static const float smoothing = 0.1f;
+
+QualityGovernor::QualityGovernor(const float budget)
+{
+	this->budget_ = budget;
+	this->level_ = num_levels - 1;
+	this->frame_time_ = 0.0f;
+	this->over_frames_ = 0;
+	this->headroom_frames_ = 0;
+	this->raise_frames_ = min_raise_frames;
+	this->frames_since_raise_ = max_raise_frames;
+	this->settle_frames_ = 0;
+}
+
+bool QualityGovernor::update(const float frame_time, const bool may_lower, const bool may_raise)
+{
+	this->frames_since_raise_++;
+	if (this->settle_frames_ > 0) {
+		this->settle_frames_--;
+		return false;
+	}
+	this->frame_time_ = this->frame_time_ > 0.0f ? glm::mix(this->frame_time_, frame_time, smoothing) : frame_time;
+
+	this->over_frames_ = this->frame_time_ > this->budget_ ? this->over_frames_ + 1 : 0;
+	this->headroom_frames_ = this->frame_time_ < raise_threshold * this->budget_ ? this->headroom_frames_ + 1 : 0;
+
+	if (may_lower && this->level_ > 0 && this->over_frames_ >= lower_frames) {
+		// the last rise did not hold, wait longer before trying it again
+		if (this->frames_since_raise_ < this->raise_frames_) {
+			this->raise_frames_ = glm::min(this->raise_frames_ * 2, max_raise_frames);
+		}
+		this->set_level(this->level_ - 1);
+		return true;
+	}
+	if (may_raise && this->level_ < num_levels - 1 && this->headroom_frames_ >= this->raise_frames_) {
+		this->set_level(this->level_ + 1);
+		this->frames_since_raise_ = 0;
+		return true;
+	}
+	return false;
+}
+
+void QualityGovernor::set_level(const int level)
+{
+	this->level_ = level;
+	this->over_frames_ = 0;
+	this->headroom_frames_ = 0;
+	// the frames in flight were rendered at the old level
+	this->frame_time_ = 0.0f;
+	this->settle_frames_ = FrameTimer::num_queries;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+//settings of the costly effects for one step of the QualityGovernor's ladder
+struct QualityLevel
+{
+	float volumetric_samples;	//share of each light's ray marching steps
+	int shadow_size_shift;		//shadow regions are at most the size of the light's strategy divided by 2^shift
+	int pcf_radius;				//(2 * radius + 1)^2 taps for directional and spot light shadows
+	int pcf_omni_samples;		//taps for point light shadows, at most 20
+	unsigned int max_bloom_iterations;
+};
+
+/*
+Moves the quality of shadows, volumetric lighting and bloom along a ladder of levels, so the frames fit the budget.
+A level drops after a short run of frames over budget and rises only after a long run with clear headroom. Every
+drop shortly after a rise doubles the run needed for the next rise, so a scene at the edge of the budget settles
+on the lower level instead of switching back and forth. The governor starts at the highest level.
+*/
+class QualityGovernor
+{
+public:
+	static const int num_levels = 4;
+
+private:
+	static const QualityLevel levels_[num_levels];
+
+	float budget_;			//gpu milliseconds per frame
+	int level_;
+	float frame_time_;		//smoothed gpu milliseconds, 0 before the first result
+	int over_frames_;
+	int headroom_frames_;
+	int raise_frames_;		//headroom frames needed for the next rise
+	int frames_since_raise_;
+	//results still measuring the previous level, ignored after a change
+	int settle_frames_;
+
+	void set_level(int level);
+public:
+	//budget in gpu milliseconds per frame
+	explicit QualityGovernor(float budget);
+
+	//frame_time in gpu milliseconds, from FrameTimer; with dynamic resolution the level should only drop at the
+	//lowest scale and only rise at full scale, may_lower and may_raise tell so. Returns true if the level changed.
+	bool update(float frame_time, bool may_lower = true, bool may_raise = true);
+
+	const QualityLevel& get_level() const
+	{
+		return levels_[level_];
+	}
+};
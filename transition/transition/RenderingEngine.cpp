@@ -11,8 +11,19 @@
 #include "CameraNode.h"
 #include "ParticleEmitterNode.h"
 #include "OmniDirectionalDepthShader.h"
+#include "DualParaboloidDepthShader.h"
+#include "ShadowFilterShader.h"
+#include "DepthPrepassShader.h"
 #include "ComputeShader.h"
+#include "ShaderProgramCache.h"
 #include "FrustumG.h"
+#include "StaticBatchNode.h"
+#include "GeometryArena.h"
+#include "IndirectDrawList.h"
+#include "ShadowAtlas.h"
+#include "DynamicResolution.h"
+#include "QualityGovernor.h"
+#include "FrameTimer.h"
 #include <irrKlang\irrKlang.h>
 
 bool RE_CULLING = true;
@@ -24,6 +35,14 @@ RenderingEngine::RenderingEngine(const glm::ivec2 viewport, bool fullscreen, int
 	this->fullscreen_ = fullscreen;
 	this->refresh_rate_ = refresh_rate;
 	this->window_ = nullptr;
+	this->geometry_arena_ = new GeometryArena();
+	this->indirect_draw_list_ = nullptr;
+	this->shadow_atlas_ = new ShadowAtlas(4096);
+	this->min_render_scale_ = 0.0f;
+	this->dynamic_resolution_ = nullptr;
+	this->quality_governed_ = false;
+	this->quality_governor_ = nullptr;
+	this->frame_timer_ = nullptr;
 
 	this->main_shader_ = new MainShader();
 	this->register_resource(this->main_shader_);
@@ -33,11 +52,23 @@ RenderingEngine::RenderingEngine(const glm::ivec2 viewport, bool fullscreen, int
 
 	this->omni_directional_depth_shader_ = new OmniDirectionalDepthShader();
 	this->register_resource(this->omni_directional_depth_shader_);
+
+	this->dual_paraboloid_depth_shader_ = new DualParaboloidDepthShader();
+	this->register_resource(this->dual_paraboloid_depth_shader_);
+
+	this->shadow_filter_shader_ = new ShadowFilterShader();
+	this->register_resource(this->shadow_filter_shader_);
+
+	this->depth_prepass_shader_ = new DepthPrepassShader();
+	this->register_resource(this->depth_prepass_shader_);
 }
 
 RenderingEngine::~RenderingEngine()
 {
 	delete this->root_node_;
+	delete this->indirect_draw_list_;
+	delete this->geometry_arena_;
+	delete this->shadow_atlas_;
 }
 
 void RenderingEngine::register_resource(IResource* resource)
@@ -115,35 +146,69 @@ void RenderingEngine::run()
 	glEnable(GL_CULL_FACE);
 	glCullFace(GL_BACK);
 
+	// start loading/compiling all programs known from the last run
+	ShaderProgramCache::warm_up();
+
+	// meshes are copied into the arena during their init
+	this->geometry_arena_->init();
+	this->shadow_atlas_->init(this);
+
 	for (auto& resource : resources_)
 	{
 		resource->init();
 	}
 
 	this->root_node_->init(this);
-
-	this->drawables_ = this->root_node_->get_drawables();
-	this->transparent_drawables_ = this->root_node_->get_transparent_drawables();
-	this->light_nodes_ = this->root_node_->get_light_nodes();
-	this->animator_nodes_ = this->root_node_->get_animator_nodes();
-	this->particle_emitter_nodes_ = this->root_node_->get_particle_emitter_nodes();
+	ShaderProgramCache::finish();
 
 	auto darkroom = this->root_node_->find_by_name("darkroom");
 	auto livingroom = this->root_node_->find_by_name("livingroom");
 	auto hallroom = this->root_node_->find_by_name("hallroom");
 	auto treeroom = this->root_node_->find_by_name("treeroom");
 	auto doors = this->root_node_->find_by_name("Doors");
-	livingroom->set_enabled(false);
-	hallroom->set_enabled(false);
-	treeroom->set_enabled(false);
 
 	this->rooms_.push_back(darkroom);
 	this->rooms_.push_back(livingroom);
 	this->rooms_.push_back(hallroom);
 	this->rooms_.push_back(treeroom);
 
+	// merge everything that never moves, before the drawables are collected
+	for (auto& room : this->rooms_)
+	{
+		StaticBatchNode::build(static_cast<GroupNode*>(room), this);
+	}
+
+	livingroom->set_enabled(false);
+	hallroom->set_enabled(false);
+	treeroom->set_enabled(false);
+
+	this->drawables_ = this->root_node_->get_drawables();
+	this->transparent_drawables_ = this->root_node_->get_transparent_drawables();
+	this->light_nodes_ = this->root_node_->get_light_nodes();
+	this->animator_nodes_ = this->root_node_->get_animator_nodes();
+	this->particle_emitter_nodes_ = this->root_node_->get_particle_emitter_nodes();
+
+	// static arena geometry is culled on the gpu and drawn with multi-draw-indirect instead of one call per drawable
+	if (GLAD_GL_VERSION_4_3) {
+		this->indirect_draw_list_ = new IndirectDrawList(this);
+		this->indirect_draw_list_->build(this->drawables_);
+	}
+
 	const auto main_camera = static_cast<CameraNode*>(this->root_node_->find_by_name("MainCamera"));
 
+	// a tenth of the frame is left for the cpu side and measuring noise
+	const float frame_budget = 0.9f * 1000.0f / float(glm::max(this->refresh_rate_, 1));
+	if (this->min_render_scale_ > 0.0f) {
+		this->dynamic_resolution_ = new DynamicResolution(frame_budget, this->min_render_scale_);
+	}
+	if (this->quality_governed_) {
+		this->quality_governor_ = new QualityGovernor(frame_budget);
+		this->apply_quality(this->quality_governor_->get_level(), main_camera);
+	}
+	if (this->dynamic_resolution_ != nullptr || this->quality_governor_ != nullptr) {
+		this->frame_timer_ = new FrameTimer();
+	}
+
 #ifdef PLAY_SOUND
 	auto music = this->sound_engine_->addSoundSourceFromFile("assets/sfx/transition_edit.mp3", irrklang::ESM_AUTO_DETECT, true);
 	this->sound_engine_->play2D(music, false);
@@ -214,11 +279,31 @@ void RenderingEngine::run()
 			particle_node->update_particles(delta);
 		}
 
+		if (this->indirect_draw_list_ != nullptr) {
+			this->indirect_draw_list_->update();
+		}
+
+		if (this->frame_timer_ != nullptr) {
+			this->frame_timer_->begin_frame();
+		}
 		main_camera->render(this->drawables_, this->transparent_drawables_, this->particle_emitter_nodes_, this->light_nodes_);
+		if (this->frame_timer_ != nullptr) {
+			this->frame_timer_->end_frame();
+			float frame_time;
+			if (this->frame_timer_->get_frame_time(frame_time)) {
+				this->update_quality(frame_time, main_camera);
+			}
+		}
 
 		glfwSwapBuffers(window_);
 		glfwPollEvents();
 	}
+	delete this->frame_timer_;
+	this->frame_timer_ = nullptr;
+	delete this->dynamic_resolution_;
+	this->dynamic_resolution_ = nullptr;
+	delete this->quality_governor_;
+	this->quality_governor_ = nullptr;
 	glfwTerminate();
 
 	for (auto& resource : resources_) {
@@ -227,6 +312,42 @@ void RenderingEngine::run()
 	this->sound_engine_->drop();
 }
 
+void RenderingEngine::set_dynamic_resolution(const float min_scale)
+{
+	this->min_render_scale_ = glm::clamp(min_scale, 0.0f, 1.0f);
+}
+
+void RenderingEngine::set_quality_governed(const bool governed)
+{
+	this->quality_governed_ = governed;
+}
+
+void RenderingEngine::update_quality(const float frame_time, CameraNode* main_camera)
+{
+	// the resolution reacts first, the effects only lose quality once it is at its minimum and regain it at full resolution
+	bool may_lower = true;
+	bool may_raise = true;
+	if (this->dynamic_resolution_ != nullptr) {
+		this->dynamic_resolution_->update(frame_time);
+		const float scale = this->dynamic_resolution_->get_scale();
+		may_lower = scale <= this->dynamic_resolution_->get_min_scale();
+		may_raise = scale >= 1.0f;
+		// the next frame renders at the new resolution
+		main_camera->set_render_scale(scale);
+	}
+	if (this->quality_governor_ != nullptr && this->quality_governor_->update(frame_time, may_lower, may_raise)) {
+		this->apply_quality(this->quality_governor_->get_level(), main_camera);
+	}
+}
+
+void RenderingEngine::apply_quality(const QualityLevel& level, CameraNode* main_camera)
+{
+	this->shadow_atlas_->set_size_shift(level.shadow_size_shift);
+	this->shadow_atlas_->set_pcf(level.pcf_radius, level.pcf_omni_samples);
+	main_camera->set_volumetric_sample_scale(level.volumetric_samples);
+	main_camera->set_max_bloom_iterations(level.max_bloom_iterations);
+}
+
 void RenderingEngine::set_room_enabled(int room, bool enable)
 {
 	this->rooms_[room]->set_enabled(enable);
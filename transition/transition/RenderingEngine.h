@@ -14,8 +14,18 @@ class ParticleEmitterNode;
 struct GLFWwindow;
 class DirectionalDepthShader;
 class OmniDirectionalDepthShader;
+class DualParaboloidDepthShader;
+class ShadowFilterShader;
+class DepthPrepassShader;
 class FrustumG;
 class Node;
+class GeometryArena;
+class IndirectDrawList;
+class ShadowAtlas;
+class DynamicResolution;
+class QualityGovernor;
+struct QualityLevel;
+class FrameTimer;
 
 #define PLAY_SOUND (1)
 //#define DEBUG_KEYS
@@ -43,10 +53,25 @@ class RenderingEngine
 	MainShader *main_shader_;
 	DirectionalDepthShader *directional_depth_shader_;
 	OmniDirectionalDepthShader *omni_directional_depth_shader_;
+	DualParaboloidDepthShader *dual_paraboloid_depth_shader_;
+	ShadowFilterShader *shadow_filter_shader_;
+	DepthPrepassShader *depth_prepass_shader_;
 
 	FrustumG *frustum_;
+	GeometryArena *geometry_arena_;
+	IndirectDrawList *indirect_draw_list_;
+	ShadowAtlas *shadow_atlas_;
+	//lowest share of the window resolution the main camera may render at, 0 renders at full resolution
+	float min_render_scale_;
+	DynamicResolution *dynamic_resolution_;
+	bool quality_governed_;
+	QualityGovernor *quality_governor_;
+	//gpu time of the frames for dynamic resolution and the quality governor, nullptr if both are off
+	FrameTimer *frame_timer_;
 	irrklang::ISoundEngine *sound_engine_;
 
+	void update_quality(float frame_time, CameraNode *main_camera);
+	void apply_quality(const QualityLevel& level, CameraNode *main_camera);
 public:
 
 	explicit RenderingEngine::RenderingEngine(const glm::ivec2 viewport, bool fullscreen, int refresh_rate);
@@ -81,6 +106,37 @@ public:
 		return this->omni_directional_depth_shader_;
 	}
 
+	DualParaboloidDepthShader *get_dual_paraboloid_depth_shader() const
+	{
+		return this->dual_paraboloid_depth_shader_;
+	}
+
+	ShadowFilterShader *get_shadow_filter_shader() const
+	{
+		return this->shadow_filter_shader_;
+	}
+
+	DepthPrepassShader *get_depth_prepass_shader() const
+	{
+		return this->depth_prepass_shader_;
+	}
+
+	GeometryArena *get_geometry_arena() const
+	{
+		return this->geometry_arena_;
+	}
+
+	//nullptr if multi-draw-indirect is not supported
+	IndirectDrawList *get_indirect_draw_list() const
+	{
+		return this->indirect_draw_list_;
+	}
+
+	ShadowAtlas *get_shadow_atlas() const
+	{
+		return this->shadow_atlas_;
+	}
+
 	GLFWwindow* get_window() const {
 		return this->window_;
 	}
@@ -90,6 +146,12 @@ public:
 		return this->sound_engine_;
 	}
 
+	//lets the main camera lower its resolution down to min_scale when frames exceed the refresh rate, 0 switches it off
+	void set_dynamic_resolution(float min_scale);
+	//lowers the quality of shadows, volumetric lighting and bloom when frames exceed the refresh rate,
+	//with dynamic resolution only once the resolution is at its minimum
+	void set_quality_governed(bool governed);
+
 	void set_room_enabled(int room, bool enable);
 
 	void stop();
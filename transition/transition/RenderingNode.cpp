@@ -2,6 +2,14 @@
 #include "glheaders.h"
 #include "IDrawable.h"
 #include "ParticleEmitterNode.h"
+#include "MeshResource.h"
+#include "RenderingEngine.h"
+#include "IndirectDrawList.h"
+#include <map>
+
+//overdraw (shaded fragments per pixel) above which the automatic mode switches the depth pre-pass on, and below which off again
+static const float depth_prepass_enable_overdraw = 1.5f;
+static const float depth_prepass_disable_overdraw = 1.2f;
 
 RenderingNode::RenderingNode(const std::string& name, const glm::ivec2 viewport, const float fieldOfView, const float ratio, const float nearp, const float farp, const bool culling) : TransformationNode(name)
 {
@@ -27,16 +35,33 @@ RenderingNode::~RenderingNode()
 	if (frustum_ != nullptr) {
 		delete frustum_;
 	}
+	if (overdraw_query_ != -1) {
+		glDeleteQueries(1, &overdraw_query_);
+	}
 }
 
 void RenderingNode::before_render(const std::vector<IDrawable*> &drawables, const std::vector<IDrawable*>& transparents, const std::vector<LightNode*> &light_nodes) const
+{
+	this->update_frustum();
+	glViewport(0, 0, this->viewport_.x, this->viewport_.y);
+}
+
+void RenderingNode::update_frustum() const
 {
 	if (culling_) {
 		glm::vec3 position = this->get_position();
 		glm::vec3 direction = glm::inverse(glm::transpose(get_transformation())) * glm::vec4(0, 0, -1, 0);
 		frustum_->setCamDef(position, position + direction, glm::vec3(0, 1, 0));
 	}
-	glViewport(0, 0, this->viewport_.x, this->viewport_.y);
+}
+
+bool RenderingNode::is_sphere_visible(const glm::vec3& center, const float radius) const
+{
+	if (!culling_) {
+		return true;
+	}
+	glm::vec3 position = center;
+	return frustum_->sphereInFrustum(position, radius) != FrustumG::OUTSIDE;
 }
 
 void RenderingNode::set_viewport(const glm::ivec2 viewport)
@@ -72,19 +97,38 @@ void RenderingNode::render(const std::vector<IDrawable*>& drawables, const std::
 	}
 
 	before_render(drawables, transparents, light_nodes);
-	
-	for (auto &drawable : drawables)
-	{
-		if (drawable->is_enabled()) {
-			bool drawing = true;
-			if (culling_) {
-				int res = frustum_->sphereInFrustum(drawable->get_position(), drawable->get_bounding_sphere_radius());
-				drawing = (res != FrustumG::OUTSIDE);
-			}
-			if (drawing) {
-				drawable->draw(this->get_shader());
-			}
-		}
+
+	const auto lod = this->get_lod_selection();
+	const auto depth_prepass_shader = this->uses_depth_prepass() ? this->get_depth_prepass_shader() : nullptr;
+
+	// fragments passing the depth test of the first opaque pass are the ones the main shader would shade without pre-pass
+	const bool measuring = this->overdraw_query_ != -1 && !this->overdraw_query_pending_;
+	if (measuring) {
+		glBeginQuery(GL_SAMPLES_PASSED, this->overdraw_query_);
+	}
+	if (depth_prepass_shader != nullptr) {
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		depth_prepass_shader->use();
+		depth_prepass_shader->set_camera_uniforms(this);
+		this->draw_opaque(depth_prepass_shader, drawables, lod, false);
+	}
+	else {
+		this->draw_opaque(this->get_shader(), drawables, lod, false);
+	}
+	if (measuring) {
+		glEndQuery(GL_SAMPLES_PASSED);
+		this->overdraw_query_pending_ = true;
+	}
+
+	if (depth_prepass_shader != nullptr) {
+		// only the front most fragment of every pixel passes, so the expensive lighting runs once per pixel
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+		this->get_shader()->use();
+		this->draw_opaque(this->get_shader(), drawables, lod, true);
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
 	}
 
 	for (auto &transparent : transparents)
@@ -112,6 +156,118 @@ void RenderingNode::render(const std::vector<IDrawable*>& drawables, const std::
 	after_render(drawables, transparents, light_nodes);
 }
 
+void RenderingNode::draw_opaque(ShaderResource* shader, const std::vector<IDrawable*>& drawables, const LodSelection& lod, const bool repeat) const
+{
+	// static geometry is culled and drawn by the indirect draw list, drawables only contains the rest
+	const auto indirect_draw_list = this->get_rendering_engine()->get_indirect_draw_list();
+	if (indirect_draw_list != nullptr && this->renders_indirect_geometry()) {
+		if (repeat) {
+			indirect_draw_list->redraw(shader);
+		}
+		else {
+			glm::mat4 view_projection;
+			indirect_draw_list->draw(shader, this->get_culling_view_projection(view_projection) ? &view_projection : nullptr, lod);
+		}
+	}
+
+	// visible drawables sharing geometry, level of detail and material are collected into one instanced draw
+	std::map<std::pair<const MeshResource*, int>, std::vector<std::vector<const IDrawable*>>> instances;
+	for (auto &drawable : drawables)
+	{
+		if (drawable->is_enabled()) {
+			bool drawing = true;
+			if (culling_) {
+				int res = frustum_->sphereInFrustum(drawable->get_position(), drawable->get_bounding_sphere_radius());
+				drawing = (res != FrustumG::OUTSIDE);
+			}
+			if (drawing) {
+				const auto mesh = drawable->get_mesh_resource();
+				auto &batches = instances[std::make_pair(mesh->get_geometry(), drawable->select_lod(lod))];
+				auto batch = batches.begin();
+				while (batch != batches.end() && batch->front()->get_mesh_resource()->get_material() != mesh->get_material()) {
+					++batch;
+				}
+				if (batch == batches.end()) {
+					batches.push_back({ drawable });
+				}
+				else {
+					batch->push_back(drawable);
+				}
+			}
+		}
+	}
+
+	for (auto &geometry : instances)
+	{
+		for (auto &batch : geometry.second)
+		{
+			if (batch.size() == 1) {
+				batch.front()->draw_culled(shader, culling_ ? frustum_ : nullptr, lod);
+			}
+			else {
+				batch.front()->draw_instanced(shader, batch, geometry.first.second);
+			}
+		}
+	}
+}
+
+bool RenderingNode::get_culling_view_projection(glm::mat4& view_projection) const
+{
+	if (!culling_) {
+		return false;
+	}
+	view_projection = this->get_projection_matrix() * this->get_view_matrix();
+	return true;
+}
+
+bool RenderingNode::uses_depth_prepass() const
+{
+	if (this->depth_prepass_mode_ == DEPTH_PREPASS_OFF || this->get_depth_prepass_shader() == nullptr) {
+		return false;
+	}
+	if (this->depth_prepass_mode_ == DEPTH_PREPASS_ON) {
+		return true;
+	}
+
+	if (this->overdraw_query_ == -1) {
+		glGenQueries(1, &this->overdraw_query_);
+	}
+	// the result of an earlier frame is only read once it is available, so the cpu never waits for it
+	if (this->overdraw_query_pending_) {
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(this->overdraw_query_, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == GL_TRUE) {
+			GLuint samples;
+			glGetQueryObjectuiv(this->overdraw_query_, GL_QUERY_RESULT, &samples);
+			this->overdraw_query_pending_ = false;
+
+			const float overdraw = float(samples) / float(this->viewport_.x * this->viewport_.y);
+			if (overdraw > depth_prepass_enable_overdraw) {
+				this->depth_prepass_ = true;
+			}
+			else if (overdraw < depth_prepass_disable_overdraw) {
+				this->depth_prepass_ = false;
+			}
+		}
+	}
+	return this->depth_prepass_;
+}
+
+void RenderingNode::set_depth_prepass_mode(const DepthPrepassMode mode)
+{
+	this->depth_prepass_mode_ = mode;
+}
+
+LodSelection RenderingNode::get_lod_selection() const
+{
+	LodSelection selection;
+	selection.eye = this->get_position();
+	selection.perspective = this->projection_[3][3] == 0.0f;
+	// size of one unit in pixels, at distance one for perspective projections
+	selection.scale = this->projection_[1][1] * this->viewport_.y * 0.5f / this->get_lod_tolerance();
+	return selection;
+}
+
 bool RenderingNode::is_rendering_enabled() const
 {
 	return true;
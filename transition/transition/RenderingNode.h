@@ -4,10 +4,18 @@
 #include <glm/glm.hpp>
 #include "ShaderResource.h"
 #include "FrustumG.h"
+#include "LodSelection.h"
 
 class AnimatorNode;
 class IDrawable;
 
+enum DepthPrepassMode
+{
+	DEPTH_PREPASS_OFF = 0,
+	DEPTH_PREPASS_ON = 1,
+	DEPTH_PREPASS_AUTO = 2	//on while the measured overdraw is high
+};
+
 class RenderingNode :
 	public TransformationNode
 {
@@ -15,8 +23,22 @@ private:
 	FrustumG *frustum_;
 	bool culling_ = false;
 
+	DepthPrepassMode depth_prepass_mode_ = DEPTH_PREPASS_OFF;
+	//decision of the automatic mode and the samples query it is based on, updated while rendering
+	mutable bool depth_prepass_ = false;
+	mutable GLuint overdraw_query_ = -1;
+	mutable bool overdraw_query_pending_ = false;
+
+	bool uses_depth_prepass() const;
+	void draw_opaque(ShaderResource *shader, const std::vector<IDrawable*> &drawables, const LodSelection& lod, bool repeat) const;
+
 protected:
 	glm::ivec2 viewport_;
+
+	void update_frustum() const;
+	//true if the sphere is at least partly inside the frustum, always true without culling
+	bool is_sphere_visible(const glm::vec3& center, float radius) const;
+
 	glm::mat4 projection_;
 	glm::mat4 projection_inv_;
 
@@ -31,7 +53,17 @@ public:
 
 	virtual ShaderResource* get_shader() const = 0;
 	virtual bool renders_particles() const { return false; }
+	//false if the static geometry of the indirect draw list is left out
+	virtual bool renders_indirect_geometry() const { return true; }
+	//matrix the indirect draw list culls against, false if nothing is culled
+	virtual bool get_culling_view_projection(glm::mat4& view_projection) const;
 	virtual bool is_rendering_enabled() const;
+	//shader for the depth-only pass before the opaque geometry, nullptr if the node can't have one
+	virtual ShaderResource* get_depth_prepass_shader() const { return nullptr; }
+	void set_depth_prepass_mode(DepthPrepassMode mode);
+	//tolerated geometric error in pixels when levels of detail are chosen
+	virtual float get_lod_tolerance() const { return 1.0f; }
+	LodSelection get_lod_selection() const;
 	
 	const glm::mat4& get_projection_matrix() const;
 	const glm::mat4& get_projection_inverse_matrix() const;
@@ -0,0 +1,445 @@
+#include "ShaderProgramCache.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdint>
+#include <iterator>
+#include <direct.h>
+#include <io.h>
+#include <cstdio>
+
+static const char* cache_directory = "shader_cache";
+static const char* manifest_path = "shader_cache/programs.txt";
+
+std::string ShaderProgramCache::driver_;
+bool ShaderProgramCache::binary_supported_ = false;
+std::map<std::string, ShaderProgramCache::PendingProgram> ShaderProgramCache::pending_;
+std::set<std::string> ShaderProgramCache::manifest_;
+std::vector<std::vector<ShaderStage>> ShaderProgramCache::requests_;
+bool ShaderProgramCache::warmed_up_ = false;
+std::set<std::string> ShaderProgramCache::hashes_;
+
+void ShaderProgramCache::request(const std::vector<ShaderStage>& stages)
+{
+	// without context the compile waits for warm_up, together with all other early requests
+	if (!warmed_up_)
+	{
+		requests_.push_back(stages);
+		return;
+	}
+	begin(get_manifest_key(stages), stages);
+}
+
+void ShaderProgramCache::warm_up()
+{
+	driver_ = std::string(reinterpret_cast<const char*>(glGetString(GL_VENDOR))) + "|"
+		+ reinterpret_cast<const char*>(glGetString(GL_RENDERER)) + "|"
+		+ reinterpret_cast<const char*>(glGetString(GL_VERSION));
+
+	GLint num_formats = 0;
+	if (GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary)
+	{
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+	}
+	binary_supported_ = num_formats > 0;
+
+	// let the driver compile and link on its own threads, glGetShaderiv/glGetProgramiv block until done
+	if (GLAD_GL_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
+	else if (GLAD_GL_ARB_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+	}
+
+	_mkdir(cache_directory);
+
+	std::ifstream manifest_file(manifest_path);
+	std::string key;
+	bool stale = false;
+	while (std::getline(manifest_file, key))
+	{
+		if (key.empty() || manifest_.count(key) > 0)
+		{
+			continue;
+		}
+		std::vector<std::string> paths;
+		const auto stages = parse_manifest_key(key, paths);
+		std::vector<std::string> sources;
+		if (stages.empty() || !read_sources(stages, sources))
+		{
+			// the shader files are gone, the program is not listed any more
+			stale = true;
+			continue;
+		}
+		manifest_.insert(key);
+		begin(key, stages);
+	}
+	manifest_file.close();
+	if (stale)
+	{
+		write_manifest();
+	}
+
+	// programs of a cold start are only known from the shader resources constructed so far
+	warmed_up_ = true;
+	for (auto& stages : requests_)
+	{
+		begin(get_manifest_key(stages), stages);
+	}
+	requests_.clear();
+}
+
+void ShaderProgramCache::begin(const std::string& key, const std::vector<ShaderStage>& stages)
+{
+	if (pending_.count(key) > 0)
+	{
+		return;
+	}
+	std::vector<std::string> sources;
+	if (!read_sources(stages, sources))
+	{
+		// reported again by get_program
+		return;
+	}
+	const auto hash = get_hash(stages, sources);
+	hashes_.insert(hash);
+
+	PendingProgram pending;
+	pending.program = load_binary(hash);
+	pending.hash = hash;
+	if (pending.program == 0)
+	{
+		pending = begin_compile(stages, sources, hash);
+	}
+	pending_[key] = pending;
+}
+
+GLuint ShaderProgramCache::get_program(const std::vector<ShaderStage>& stages)
+{
+	std::vector<std::string> sources;
+	if (!read_sources(stages, sources))
+	{
+		system("PAUSE");
+		exit(1);
+	}
+	const auto key = get_manifest_key(stages);
+	const auto hash = get_hash(stages, sources);
+	hashes_.insert(hash);
+
+	GLuint program = 0;
+	const auto it = pending_.find(key);
+	if (it != pending_.end())
+	{
+		const auto pending = it->second;
+		pending_.erase(it);
+		if (pending.hash == hash)
+		{
+			program = finish_compile(pending, stages);
+		}
+		else
+		{
+			for (auto shader : pending.shaders)
+			{
+				glDeleteShader(shader);
+			}
+			glDeleteProgram(pending.program);
+		}
+	}
+	if (program == 0)
+	{
+		program = load_binary(hash);
+	}
+	if (program == 0)
+	{
+		program = finish_compile(begin_compile(stages, sources, hash), stages);
+	}
+
+	if (manifest_.count(key) == 0)
+	{
+		manifest_.insert(key);
+		std::ofstream manifest_file(manifest_path, std::ios::app);
+		manifest_file << key << std::endl;
+	}
+	return program;
+}
+
+void ShaderProgramCache::finish()
+{
+	for (auto& entry : pending_)
+	{
+		for (auto shader : entry.second.shaders)
+		{
+			glDeleteShader(shader);
+		}
+		glDeleteProgram(entry.second.program);
+	}
+	pending_.clear();
+	prune_binaries();
+}
+
+void ShaderProgramCache::write_manifest()
+{
+	std::ofstream manifest_file(manifest_path, std::ios::trunc);
+	for (auto& key : manifest_)
+	{
+		manifest_file << key << std::endl;
+	}
+}
+
+void ShaderProgramCache::prune_binaries()
+{
+	// every edit of a shader and every driver update leaves a binary behind otherwise
+	_finddata_t file;
+	const auto handle = _findfirst((std::string(cache_directory) + "/*.bin").c_str(), &file);
+	if (handle == -1)
+	{
+		return;
+	}
+	std::vector<std::string> stale;
+	do
+	{
+		const std::string name(file.name);
+		if (hashes_.count(name.substr(0, name.size() - 4)) == 0)
+		{
+			stale.push_back(std::string(cache_directory) + "/" + name);
+		}
+	} while (_findnext(handle, &file) == 0);
+	_findclose(handle);
+
+	for (auto& path : stale)
+	{
+		std::remove(path.c_str());
+	}
+}
+
+std::string ShaderProgramCache::get_manifest_key(const std::vector<ShaderStage>& stages)
+{
+	std::stringstream key;
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		if (i > 0)
+		{
+			key << "|";
+		}
+		key << stages[i].type << ":" << stages[i].path;
+	}
+	return key.str();
+}
+
+std::vector<ShaderStage> ShaderProgramCache::parse_manifest_key(const std::string& key, std::vector<std::string>& paths)
+{
+	std::vector<GLenum> types;
+	std::stringstream key_stream(key);
+	std::string stage;
+	while (std::getline(key_stream, stage, '|'))
+	{
+		const auto separator = stage.find(':');
+		if (separator == std::string::npos)
+		{
+			return {};
+		}
+		types.push_back(GLenum(std::stoul(stage.substr(0, separator))));
+		paths.push_back(stage.substr(separator + 1));
+	}
+	// build the stages after all paths are stored, so the pointers stay valid
+	std::vector<ShaderStage> stages;
+	for (size_t i = 0; i < types.size(); i++)
+	{
+		stages.push_back({ types[i], paths[i].c_str() });
+	}
+	return stages;
+}
+
+bool ShaderProgramCache::read_sources(const std::vector<ShaderStage>& stages, std::vector<std::string>& sources)
+{
+	for (auto& stage : stages)
+	{
+		std::ifstream shader_file;
+		// ensure ifstream objects can throw exceptions:
+		shader_file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+		try
+		{
+			shader_file.open(stage.path);
+			std::stringstream shader_stream;
+			shader_stream << shader_file.rdbuf();
+			shader_file.close();
+			sources.push_back(shader_stream.str());
+		}
+		catch (std::ifstream::failure e)
+		{
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << stage.path << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+std::string ShaderProgramCache::get_hash(const std::vector<ShaderStage>& stages, const std::vector<std::string>& sources)
+{
+	// 64 bit FNV-1a over the driver string and all stages
+	uint64_t hash = 14695981039346656037ull;
+	const auto add = [&hash](const std::string& data)
+	{
+		for (auto c : data)
+		{
+			hash ^= uint8_t(c);
+			hash *= 1099511628211ull;
+		}
+		hash ^= 0xFF;
+		hash *= 1099511628211ull;
+	};
+	add(driver_);
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		add(std::to_string(stages[i].type));
+		add(sources[i]);
+	}
+	std::stringstream hex;
+	hex << std::hex << hash;
+	return hex.str();
+}
+
+GLuint ShaderProgramCache::load_binary(const std::string& hash)
+{
+	if (!binary_supported_)
+	{
+		return 0;
+	}
+	std::ifstream binary_file(std::string(cache_directory) + "/" + hash + ".bin", std::ios::binary);
+	if (!binary_file)
+	{
+		return 0;
+	}
+	GLenum format;
+	binary_file.read(reinterpret_cast<char*>(&format), sizeof(format));
+	const std::vector<char> binary((std::istreambuf_iterator<char>(binary_file)), std::istreambuf_iterator<char>());
+	if (binary.empty())
+	{
+		return 0;
+	}
+
+	const auto program = glCreateProgram();
+	glProgramBinary(program, format, binary.data(), GLsizei(binary.size()));
+	GLint success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		// driver rejected the binary, fall back to compiling from source
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+void ShaderProgramCache::save_binary(const GLuint program, const std::string& hash)
+{
+	if (!binary_supported_)
+	{
+		return;
+	}
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return;
+	}
+	std::vector<char> binary(length);
+	GLenum format;
+	glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+	std::ofstream binary_file(std::string(cache_directory) + "/" + hash + ".bin", std::ios::binary);
+	binary_file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+	binary_file.write(binary.data(), binary.size());
+}
+
+ShaderProgramCache::PendingProgram ShaderProgramCache::begin_compile(const std::vector<ShaderStage>& stages, const std::vector<std::string>& sources, const std::string& hash)
+{
+	// only issue the commands here, no status queries so the driver does not have to wait
+	PendingProgram pending;
+	pending.program = glCreateProgram();
+	pending.hash = hash;
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		auto shader_code = sources[i].c_str();
+		const auto shader = glCreateShader(stages[i].type);
+		glShaderSource(shader, 1, &shader_code, nullptr);
+		glCompileShader(shader);
+		glAttachShader(pending.program, shader);
+		pending.shaders.push_back(shader);
+	}
+	if (binary_supported_)
+	{
+		glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(pending.program);
+	return pending;
+}
+
+GLuint ShaderProgramCache::finish_compile(const PendingProgram& pending, const std::vector<ShaderStage>& stages)
+{
+	// loaded from a binary
+	if (pending.shaders.empty())
+	{
+		return pending.program;
+	}
+	for (size_t i = 0; i < pending.shaders.size(); i++)
+	{
+		check_compile_errors(pending.shaders[i], get_type_name(stages[i].type));
+	}
+	check_compile_errors(pending.program, "PROGRAM");
+	// delete the shaders as they're linked into our program now and no longer necessery
+	for (auto shader : pending.shaders)
+	{
+		glDetachShader(pending.program, shader);
+		glDeleteShader(shader);
+	}
+	save_binary(pending.program, pending.hash);
+	return pending.program;
+}
+
+std::string ShaderProgramCache::get_type_name(const GLenum type)
+{
+	switch (type)
+	{
+	case GL_VERTEX_SHADER:
+		return "VERTEX";
+	case GL_FRAGMENT_SHADER:
+		return "FRAGMENT";
+	case GL_GEOMETRY_SHADER:
+		return "GEOMETRY";
+	case GL_COMPUTE_SHADER:
+		return "COMPUTE";
+	default:
+		return "UNKNOWN";
+	}
+}
+
+void ShaderProgramCache::check_compile_errors(const GLuint shader, const std::string& type)
+{
+	GLint success;
+	GLchar info_log[1024];
+	if (type != "PROGRAM")
+	{
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(shader, 1024, nullptr, info_log);
+			std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << info_log << "\n -- --------------------------------------------------- -- " << std::endl;
+			system("PAUSE");
+			exit(1);
+		}
+	}
+	else
+	{
+		glGetProgramiv(shader, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			glGetProgramInfoLog(shader, 1024, nullptr, info_log);
+			std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << info_log << "\n -- --------------------------------------------------- -- " << std::endl;
+			system("PAUSE");
+			exit(1);
+		}
+	}
+}
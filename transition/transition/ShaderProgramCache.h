@@ -0,0 +1,67 @@
+#pragma once
+#include "glheaders.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+struct ShaderStage
+{
+	GLenum type;
+	const char* path;
+};
+
+/*
+ * Caches linked programs as driver binaries in shader_cache/, keyed by a hash over
+ * the shader sources and the driver string. Every shader resource requests its program
+ * when it is constructed, and programs used in a previous run are listed in a manifest;
+ * warm_up() starts loading or compiling all of them at once, before the first status query,
+ * so the driver can work on them in parallel (KHR/ARB_parallel_shader_compile) while the
+ * resources are still being initialized. Requests after warm_up() start right away.
+ * Binaries of programs which are neither in the manifest nor used by this run are deleted.
+ */
+class ShaderProgramCache
+{
+	struct PendingProgram
+	{
+		GLuint program;
+		std::vector<GLuint> shaders;
+		std::string hash;
+	};
+
+	static std::string driver_;
+	static bool binary_supported_;
+	static std::map<std::string, PendingProgram> pending_;
+	static std::set<std::string> manifest_;
+	//stages requested before warm_up, the paths are the literals given to the shader resources
+	static std::vector<std::vector<ShaderStage>> requests_;
+	static bool warmed_up_;
+	//hashes of the current sources of the manifest and of this run's programs, their binaries are kept
+	static std::set<std::string> hashes_;
+
+	static void begin(const std::string& key, const std::vector<ShaderStage>& stages);
+	static void write_manifest();
+	static void prune_binaries();
+
+	static std::string get_manifest_key(const std::vector<ShaderStage>& stages);
+	static std::vector<ShaderStage> parse_manifest_key(const std::string& key, std::vector<std::string>& paths);
+	static bool read_sources(const std::vector<ShaderStage>& stages, std::vector<std::string>& sources);
+	static std::string get_hash(const std::vector<ShaderStage>& stages, const std::vector<std::string>& sources);
+
+	static GLuint load_binary(const std::string& hash);
+	static void save_binary(GLuint program, const std::string& hash);
+	static PendingProgram begin_compile(const std::vector<ShaderStage>& stages, const std::vector<std::string>& sources, const std::string& hash);
+	static GLuint finish_compile(const PendingProgram& pending, const std::vector<ShaderStage>& stages);
+
+	static void check_compile_errors(GLuint shader, const std::string& type);
+	static std::string get_type_name(GLenum type);
+public:
+	// starts loading or compiling the program early, called by the constructors of the shader resources
+	static void request(const std::vector<ShaderStage>& stages);
+	// call once after the context is current, before any shader resource is initialized
+	static void warm_up();
+	// returns a linked program; exits the application if compiling or linking fails
+	static GLuint get_program(const std::vector<ShaderStage>& stages);
+	// deletes warmed up programs that were never requested and the binaries of programs not used any more
+	static void finish();
+};
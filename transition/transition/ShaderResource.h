@@ -15,7 +15,6 @@ class ShaderResource :
 
 	GLuint program_id_;
 
-	static void check_compile_errors(GLuint shader, std::string type);
 protected:
 	GLint get_uniform(const std::string name) const;
 	GLint get_uniform(const std::string name, const int index) const;
@@ -30,5 +29,11 @@ public:
 	void init() override;
 	virtual void set_camera_uniforms(const RenderingNode* node) = 0;
 	virtual void set_model_uniforms(const GeometryNode* node) = 0;
+	//used instead of set_model_uniforms for instanced draws, where the model matrices come from the instance attributes
+	//returns false if the shader can't draw instanced
+	virtual bool set_instanced_model_uniforms(const GeometryNode* node) { return false; }
+	//true if the shader needs nothing but positions and instance matrices from geometry without alpha texture,
+	//which is then drawn from the position-only vao with welded indices and without material uniforms
+	virtual bool is_depth_only() const { return false; }
 };
 
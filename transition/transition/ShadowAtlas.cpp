@@ -0,0 +1,430 @@
+#include "ShadowAtlas.h"
+#include "RenderingEngine.h"
+#include "ShadowFilterShader.h"
+#include "MeshResource.h"
+#include <algorithm>
+
+ShadowAtlas::ShadowAtlas(const int size)
+{
+	this->size_ = size;
+	this->size_shift_ = 0;
+	this->pcf_radius_ = 2;
+	this->pcf_omni_samples_ = 20;
+	this->nodes_.push_back({ 0, 0, size, -1, -1, false, false });
+
+	this->fbo_ = -1;
+	this->texture_ = -1;
+	this->static_fbo_ = -1;
+	this->static_texture_ = -1;
+	this->views_buffer_ = -1;
+	this->views_texture_ = -1;
+
+	this->filtered_ = false;
+	this->moments_fbo_ = -1;
+	this->moments_texture_ = -1;
+	this->blur_fbo_ = -1;
+	this->blur_texture_ = -1;
+	this->filter_shader_ = nullptr;
+	this->screen_mesh_ = nullptr;
+}
+
+ShadowAtlas::~ShadowAtlas()
+{
+	if (this->fbo_ != -1) {
+		glDeleteFramebuffers(1, &this->fbo_);
+		glDeleteTextures(1, &this->texture_);
+		glDeleteBuffers(1, &this->views_buffer_);
+		glDeleteTextures(1, &this->views_texture_);
+	}
+	if (this->static_fbo_ != -1) {
+		glDeleteFramebuffers(1, &this->static_fbo_);
+		glDeleteTextures(1, &this->static_texture_);
+	}
+	if (this->moments_fbo_ != -1) {
+		glDeleteFramebuffers(1, &this->moments_fbo_);
+		glDeleteTextures(1, &this->moments_texture_);
+		glDeleteFramebuffers(1, &this->blur_fbo_);
+		glDeleteTextures(1, &this->blur_texture_);
+	}
+	delete this->screen_mesh_;
+}
+
+void ShadowAtlas::set_filtered(const bool filtered)
+{
+	this->filtered_ = filtered;
+}
+
+void ShadowAtlas::set_size_shift(const int shift)
+{
+	this->size_shift_ = shift;
+}
+
+void ShadowAtlas::set_pcf(const int radius, const int omni_samples)
+{
+	this->pcf_radius_ = radius;
+	this->pcf_omni_samples_ = omni_samples;
+}
+
+void ShadowAtlas::init(RenderingEngine *rendering_engine)
+{
+	this->create_texture(this->fbo_, this->texture_);
+	// the layers are combined with glCopyImageSubData
+	if (GLAD_GL_VERSION_4_3) {
+		this->create_texture(this->static_fbo_, this->static_texture_);
+	}
+
+	glGenBuffers(1, &this->views_buffer_);
+	glGenTextures(1, &this->views_texture_);
+	glBindBuffer(GL_TEXTURE_BUFFER, this->views_buffer_);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(View), nullptr, GL_STREAM_DRAW);
+	glBindTexture(GL_TEXTURE_BUFFER, this->views_texture_);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, this->views_buffer_);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	if (this->filtered_) {
+		// the regions are aligned to their size, so no mip level down to a texel per smallest region mixes two of them
+		int max_level = 0;
+		while ((min_region_size / 2) >> (max_level + 1) > 0) {
+			max_level++;
+		}
+		this->create_moments_texture(this->moments_fbo_, this->moments_texture_, this->size_ / 2, max_level);
+		// the horizontal pass of the largest possible region
+		this->create_moments_texture(this->blur_fbo_, this->blur_texture_, this->size_ / 4, 0);
+
+		this->filter_shader_ = rendering_engine->get_shadow_filter_shader();
+		this->screen_mesh_ = MeshResource::create_sprite(nullptr);
+		this->screen_mesh_->init();
+	}
+}
+
+void ShadowAtlas::create_moments_texture(GLuint& fbo, GLuint& texture, const int size, const int max_level) const
+{
+	glGenFramebuffers(1, &fbo);
+	glGenTextures(1, &texture);
+
+	// 16 bit floats halve the memory, the exponents of the moments are chosen to fit
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, size, size, 0, GL_RGBA, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, max_level > 0 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, max_level);
+	if (max_level > 0) {
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void ShadowAtlas::create_texture(GLuint& fbo, GLuint& texture) const
+{
+	glGenFramebuffers(1, &fbo);
+	glGenTextures(1, &texture);
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, this->size_, this->size_, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowAtlas::update(const std::vector<LightNode*>& lights, const RenderingNode* camera)
+{
+	// lights which are not visible give their regions to the visible ones
+	for (auto allocation = this->allocations_.begin(); allocation != this->allocations_.end();) {
+		const auto light = std::find(lights.begin(), lights.end(), allocation->first);
+		if (light == lights.end() || !(*light)->is_rendering_enabled()) {
+			for (auto& node : allocation->second.nodes) {
+				this->release_node(node);
+			}
+			allocation = this->allocations_.erase(allocation);
+		}
+		else {
+			++allocation;
+		}
+	}
+
+	std::vector<std::pair<const LightNode*, int>> requests;
+	for (auto& light : lights) {
+		if (!light->is_rendering_enabled()) {
+			continue;
+		}
+		const int size = this->get_desired_size(light, camera);
+		const auto allocation = this->allocations_.find(light);
+		if (allocation != this->allocations_.end()) {
+			if (allocation->second.desired_size == size) {
+				continue;
+			}
+			this->release(light);
+		}
+		requests.push_back(std::make_pair(static_cast<const LightNode*>(light), size));
+	}
+	if (requests.empty()) {
+		return;
+	}
+
+	// largest regions first, so the quadtree does not fragment
+	const auto larger = [](const std::pair<const LightNode*, int>& a, const std::pair<const LightNode*, int>& b) { return a.second > b.second; };
+	std::sort(requests.begin(), requests.end(), larger);
+	bool packed = true;
+	for (auto& request : requests) {
+		if (!this->allocate(request.first, request.second, request.second)) {
+			packed = false;
+			break;
+		}
+	}
+
+	if (!packed) {
+		// pack all lights again, halving the regions which do not fit any more
+		for (auto& allocation : this->allocations_) {
+			if (std::find_if(requests.begin(), requests.end(), [&](const std::pair<const LightNode*, int>& request) { return request.first == allocation.first; }) == requests.end()) {
+				requests.push_back(std::make_pair(allocation.first, allocation.second.desired_size));
+			}
+		}
+		for (auto& allocation : this->allocations_) {
+			for (auto& node : allocation.second.nodes) {
+				this->release_node(node);
+			}
+		}
+		this->allocations_.clear();
+
+		std::sort(requests.begin(), requests.end(), larger);
+		for (auto& request : requests) {
+			int size = request.second;
+			while (!this->allocate(request.first, request.second, size) && size > min_region_size) {
+				size /= 2;
+			}
+		}
+	}
+
+	for (auto& request : requests) {
+		request.first->invalidate_shadow_map();
+	}
+}
+
+int ShadowAtlas::get_desired_size(const LightNode* light, const RenderingNode* camera) const
+{
+	const int max_size = std::max(std::min(light->get_shadow_strategy()->get_shadow_map_size() >> this->size_shift_, this->size_ / 2), min_region_size);
+
+	// lights which may cover a quarter of the view get the full resolution of their strategy
+	const float exact = max_size * glm::min(light->get_screen_coverage(camera) * 4.0f, 1.0f);
+	int size = max_size;
+	while (size / 2 >= exact && size / 2 >= min_region_size) {
+		size /= 2;
+	}
+
+	// a region only shrinks once it is clearly too large, so lights at the threshold do not render anew every frame
+	const auto allocation = this->allocations_.find(light);
+	if (allocation != this->allocations_.end()) {
+		const int current = allocation->second.desired_size;
+		if (size < current && current <= max_size && exact > current * 0.375f) {
+			size = current;
+		}
+	}
+	return size;
+}
+
+bool ShadowAtlas::allocate(const LightNode* light, const int desired_size, const int size)
+{
+	Allocation allocation;
+	allocation.desired_size = desired_size;
+	allocation.size = size;
+	allocation.first_view = -1;
+	const int num_faces = light->get_shadow_strategy()->get_num_faces();
+	for (int face = 0; face < num_faces; face++) {
+		const int node = this->allocate_node(0, size);
+		if (node < 0) {
+			for (auto& allocated : allocation.nodes) {
+				this->release_node(allocated);
+			}
+			return false;
+		}
+		allocation.nodes.push_back(node);
+	}
+	allocation.light_space.resize(num_faces, glm::mat4(1.0f));
+	this->allocations_[light] = allocation;
+	return true;
+}
+
+void ShadowAtlas::release(const LightNode* light)
+{
+	const auto allocation = this->allocations_.find(light);
+	if (allocation == this->allocations_.end()) {
+		return;
+	}
+	for (auto& node : allocation->second.nodes) {
+		this->release_node(node);
+	}
+	this->allocations_.erase(allocation);
+}
+
+int ShadowAtlas::allocate_node(const int node, const int size)
+{
+	if (this->nodes_[node].used || this->nodes_[node].size < size) {
+		return -1;
+	}
+	if (this->nodes_[node].size == size) {
+		if (this->nodes_[node].split) {
+			return -1;
+		}
+		this->nodes_[node].used = true;
+		return node;
+	}
+
+	if (this->nodes_[node].first_child < 0) {
+		const int half = this->nodes_[node].size / 2;
+		const int x = this->nodes_[node].x;
+		const int y = this->nodes_[node].y;
+		this->nodes_[node].first_child = int(this->nodes_.size());
+		this->nodes_.push_back({ x, y, half, node, -1, false, false });
+		this->nodes_.push_back({ x + half, y, half, node, -1, false, false });
+		this->nodes_.push_back({ x, y + half, half, node, -1, false, false });
+		this->nodes_.push_back({ x + half, y + half, half, node, -1, false, false });
+	}
+	for (int child = 0; child < 4; child++) {
+		const int allocated = this->allocate_node(this->nodes_[node].first_child + child, size);
+		if (allocated >= 0) {
+			this->nodes_[node].split = true;
+			return allocated;
+		}
+	}
+	return -1;
+}
+
+void ShadowAtlas::release_node(const int node)
+{
+	this->nodes_[node].used = false;
+
+	// parents whose children are all free again can be handed out as a whole
+	int parent = this->nodes_[node].parent;
+	while (parent >= 0) {
+		const int first_child = this->nodes_[parent].first_child;
+		for (int child = first_child; child < first_child + 4; child++) {
+			if (this->nodes_[child].used || this->nodes_[child].split) {
+				return;
+			}
+		}
+		this->nodes_[parent].split = false;
+		parent = this->nodes_[parent].parent;
+	}
+}
+
+void ShadowAtlas::begin_rendering(const LightNode* light, const int face, const ShadowLayer layer, const glm::mat4& light_space)
+{
+	auto& allocation = this->allocations_.at(light);
+	allocation.light_space[face] = light_space;
+	const auto& node = this->nodes_[allocation.nodes[face]];
+	if (this->filtered_ && layer != SHADOW_LAYER_STATIC) {
+		this->unfiltered_nodes_.push_back(allocation.nodes[face]);
+	}
+
+	// dynamic casters are drawn on top of a copy of the cached static casters
+	if (layer == SHADOW_LAYER_DYNAMIC) {
+		glCopyImageSubData(this->static_texture_, GL_TEXTURE_2D, 0, node.x, node.y, 0, this->texture_, GL_TEXTURE_2D, 0, node.x, node.y, 0, node.size, node.size, 1);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, layer == SHADOW_LAYER_STATIC ? this->static_fbo_ : this->fbo_);
+	glViewport(node.x, node.y, node.size, node.size);
+	glScissor(node.x, node.y, node.size, node.size);
+	glEnable(GL_SCISSOR_TEST);
+	if (layer != SHADOW_LAYER_DYNAMIC) {
+		glClear(GL_DEPTH_BUFFER_BIT);
+	}
+}
+
+void ShadowAtlas::end_rendering() const
+{
+	glDisable(GL_SCISSOR_TEST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowAtlas::filter()
+{
+	if (this->unfiltered_nodes_.empty()) {
+		return;
+	}
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	this->filter_shader_->use();
+	glBindVertexArray(this->screen_mesh_->get_resource_id());
+	for (auto& index : this->unfiltered_nodes_) {
+		const auto& node = this->nodes_[index];
+		const int size = node.size / 2;
+
+		// moments of the depth, blurred horizontally into the corner of the scratch texture
+		glBindFramebuffer(GL_FRAMEBUFFER, this->blur_fbo_);
+		glViewport(0, 0, size, size);
+		this->filter_shader_->set_filter_uniforms(this->texture_, true, glm::ivec2(node.x, node.y), node.size, glm::ivec2(0, 0));
+		glDrawElements(GL_TRIANGLES, this->screen_mesh_->get_num_indices(), this->screen_mesh_->get_index_type(), nullptr);
+
+		// blurred vertically into the region's place in the moments atlas
+		glBindFramebuffer(GL_FRAMEBUFFER, this->moments_fbo_);
+		glViewport(node.x / 2, node.y / 2, size, size);
+		this->filter_shader_->set_filter_uniforms(this->blur_texture_, false, glm::ivec2(0, 0), size, glm::ivec2(node.x / 2, node.y / 2));
+		glDrawElements(GL_TRIANGLES, this->screen_mesh_->get_num_indices(), this->screen_mesh_->get_index_type(), nullptr);
+	}
+	glBindVertexArray(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glEnable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	this->unfiltered_nodes_.clear();
+
+	glBindTexture(GL_TEXTURE_2D, this->moments_texture_);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void ShadowAtlas::upload_views()
+{
+	std::vector<View> views;
+	for (auto& allocation : this->allocations_) {
+		allocation.second.first_view = int(views.size());
+		for (size_t face = 0; face < allocation.second.nodes.size(); face++) {
+			const auto& node = this->nodes_[allocation.second.nodes[face]];
+			views.push_back({ allocation.second.light_space[face], glm::vec4(node.x, node.y, node.size, node.size) / float(this->size_) });
+		}
+	}
+	if (views.empty()) {
+		return;
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, this->views_buffer_);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(View) * views.size(), views.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void ShadowAtlas::bind(const int first_texture_slot) const
+{
+	glActiveTexture(GL_TEXTURE0 + first_texture_slot);
+	glBindTexture(GL_TEXTURE_2D, this->filtered_ ? this->moments_texture_ : this->texture_);
+	glActiveTexture(GL_TEXTURE0 + first_texture_slot + 1);
+	glBindTexture(GL_TEXTURE_BUFFER, this->views_texture_);
+}
+
+bool ShadowAtlas::has_region(const LightNode* light) const
+{
+	return this->allocations_.find(light) != this->allocations_.end();
+}
+
+int ShadowAtlas::get_region_size(const LightNode* light) const
+{
+	const auto allocation = this->allocations_.find(light);
+	return allocation != this->allocations_.end() ? allocation->second.size : 0;
+}
+
+int ShadowAtlas::get_first_view(const LightNode* light) const
+{
+	const auto allocation = this->allocations_.find(light);
+	return allocation != this->allocations_.end() ? allocation->second.first_view : -1;
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include "glheaders.h"
+#include "LightNode.h"
+#include <glm/glm.hpp>
+#include <vector>
+#include <map>
+
+class RenderingEngine;
+class ShadowFilterShader;
+class MeshResource;
+
+/*
+One depth texture holding the shadow maps of all lights, so the shaders sample every shadow through one sampler.
+Each shadow view (one per directional or spot light, six per point light) gets a square power of two region from a
+quadtree. Its size follows the share of the screen the light may cover, up to the size of the light's strategy.
+A region only moves when the size of its light changes or the atlas is packed again, the light then renders anew.
+The rectangles and light space matrices of all views are read by the shaders from a buffer texture.
+With GL 4.3 a second atlas with the same layout caches the static casters of every region.
+Filtered atlases convert every rendered region into exponential variance moments at half the resolution, blur
+and mipmap them, so the shaders replace their kernels of depth comparisons with one trilinear fetch.
+*/
+class ShadowAtlas
+{
+public:
+	static const int min_region_size = 128;
+
+private:
+	struct QuadNode
+	{
+		int x;
+		int y;
+		int size;
+		int parent;
+		int first_child;	//-1 until the node is split the first time
+		bool used;
+		bool split;			//some children are used
+	};
+
+	struct Allocation
+	{
+		int desired_size;	//size asked for, the region is smaller if the atlas was full
+		int size;
+		std::vector<int> nodes;
+		std::vector<glm::mat4> light_space;
+		int first_view;
+	};
+
+	//layout matches get_shadow_view_matrix() and get_shadow_view_rect() of main_shader.fs and volumetric_lighting.fs
+	struct View
+	{
+		glm::mat4 light_space;
+		glm::vec4 rect;		//offset and size in texture coordinates
+	};
+
+	int size_;
+	int size_shift_;
+	int pcf_radius_;
+	int pcf_omni_samples_;
+	std::vector<QuadNode> nodes_;
+	std::map<const LightNode*, Allocation> allocations_;
+
+	GLuint fbo_;
+	GLuint texture_;
+	GLuint static_fbo_;
+	GLuint static_texture_;
+	GLuint views_buffer_;
+	GLuint views_texture_;
+
+	bool filtered_;
+	GLuint moments_fbo_;
+	GLuint moments_texture_;
+	GLuint blur_fbo_;
+	GLuint blur_texture_;
+	ShadowFilterShader *filter_shader_;
+	MeshResource *screen_mesh_;
+	//regions rendered since the last filter()
+	std::vector<int> unfiltered_nodes_;
+
+	int allocate_node(int node, int size);
+	void release_node(int node);
+	bool allocate(const LightNode* light, int desired_size, int size);
+	void release(const LightNode* light);
+	int get_desired_size(const LightNode* light, const RenderingNode* camera) const;
+	void create_texture(GLuint& fbo, GLuint& texture) const;
+	void create_moments_texture(GLuint& fbo, GLuint& texture, int size, int max_level) const;
+public:
+	explicit ShadowAtlas(int size);
+	~ShadowAtlas();
+
+	//has to be set before init
+	void set_filtered(bool filtered);
+	void init(RenderingEngine *rendering_engine);
+
+	//regions are at most the size of the light's strategy divided by 2^shift, lights render anew when theirs shrink
+	void set_size_shift(int shift);
+	//taps of the unfiltered shadows: a (2 * radius + 1)^2 kernel for single views, omni_samples for point lights
+	void set_pcf(int radius, int omni_samples);
+
+	//assigns regions to the lights, lights whose region changed have to render their shadow map again
+	void update(const std::vector<LightNode*>& lights, const RenderingNode* camera);
+
+	//binds the region of the face for rendering the given layer, light_space is the matrix the face is rendered with
+	void begin_rendering(const LightNode* light, int face, ShadowLayer layer, const glm::mat4& light_space);
+	void end_rendering() const;
+
+	//blurs the moments of the regions rendered since the last call and builds the mipmaps, before upload_views
+	void filter();
+
+	//uploads rectangles and matrices of all views, after the shadow maps of the frame are rendered
+	void upload_views();
+
+	//binds the atlas (the moments if filtered) and the views to two consecutive texture slots
+	void bind(int first_texture_slot) const;
+
+	bool has_region(const LightNode* light) const;
+	//side length of each region of the light in texels, 0 without region
+	int get_region_size(const LightNode* light) const;
+	//index of the first view of the light, -1 without region
+	int get_first_view(const LightNode* light) const;
+
+	int get_size() const
+	{
+		return size_;
+	}
+
+	bool is_filtered() const
+	{
+		return filtered_;
+	}
+
+	int get_pcf_radius() const
+	{
+		return pcf_radius_;
+	}
+
+	int get_pcf_omni_samples() const
+	{
+		return pcf_omni_samples_;
+	}
+};
@@ -0,0 +1,52 @@
+#include "ShadowFilterShader.h"
+#include <cassert>
+
+ShadowFilterShader::ShadowFilterShader() : ShaderResource("assets/shaders/postprocess.vs", "assets/shaders/shadow_filter.fs")
+{
+	this->image_uniform_ = -1;
+	this->horizontal_uniform_ = -1;
+	this->source_offset_uniform_ = -1;
+	this->source_size_uniform_ = -1;
+	this->target_offset_uniform_ = -1;
+}
+
+
+ShadowFilterShader::~ShadowFilterShader()
+{
+}
+
+void ShadowFilterShader::init()
+{
+	ShaderResource::init();
+
+	this->image_uniform_ = get_uniform("image");
+	this->horizontal_uniform_ = get_uniform("horizontal");
+	this->source_offset_uniform_ = get_uniform("source_offset");
+	this->source_size_uniform_ = get_uniform("source_size");
+	this->target_offset_uniform_ = get_uniform("target_offset");
+}
+
+void ShadowFilterShader::set_camera_uniforms(const RenderingNode* node)
+{
+}
+
+void ShadowFilterShader::set_model_uniforms(const GeometryNode* node)
+{
+}
+
+void ShadowFilterShader::set_filter_uniforms(const GLuint image, const bool horizontal, const glm::ivec2& source_offset, const int source_size, const glm::ivec2& target_offset) const
+{
+	assert(this->image_uniform_ >= 0);
+	assert(this->horizontal_uniform_ >= 0);
+	assert(this->source_offset_uniform_ >= 0);
+	assert(this->source_size_uniform_ >= 0);
+	assert(this->target_offset_uniform_ >= 0);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, image);
+	glUniform1i(this->image_uniform_, 0);
+	glUniform1i(this->horizontal_uniform_, horizontal);
+	glUniform2i(this->source_offset_uniform_, source_offset.x, source_offset.y);
+	glUniform1i(this->source_size_uniform_, source_size);
+	glUniform2i(this->target_offset_uniform_, target_offset.x, target_offset.y);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "ShaderResource.h"
+#include <glm/glm.hpp>
+
+/*
+Converts the depth of a shadow atlas region into exponential variance moments at half the resolution and blurs them
+with a separable 5 tap binomial filter, see ShadowAtlas::filter().
+*/
+class ShadowFilterShader :
+	public ShaderResource
+{
+	GLint image_uniform_;
+	GLint horizontal_uniform_;
+	GLint source_offset_uniform_;
+	GLint source_size_uniform_;
+	GLint target_offset_uniform_;
+public:
+	ShadowFilterShader();
+	~ShadowFilterShader();
+
+	void init() override;
+
+	void set_camera_uniforms(const RenderingNode *node) override;
+	void set_model_uniforms(const GeometryNode *node) override;
+
+	//the horizontal pass reads depth from the atlas, the vertical pass the moments of the horizontal one
+	void set_filter_uniforms(GLuint image, bool horizontal, const glm::ivec2& source_offset, int source_size, const glm::ivec2& target_offset) const;
+};
+
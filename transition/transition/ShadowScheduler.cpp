@@ -0,0 +1,102 @@
+#include "ShadowScheduler.h"
+#include "LightNode.h"
+#include "RenderingEngine.h"
+#include "ShadowAtlas.h"
+#include <algorithm>
+
+//distance a light has to move within one frame to get the highest motion priority
+static const float fast_motion = 0.1f;
+
+ShadowScheduler::ShadowScheduler(const long long budget)
+{
+	this->budget_ = budget;
+}
+
+ShadowScheduler::~ShadowScheduler()
+{
+}
+
+void ShadowScheduler::set_budget(const long long budget)
+{
+	this->budget_ = budget;
+}
+
+void ShadowScheduler::update(const std::vector<LightNode*>& lights, const RenderingNode* camera)
+{
+	struct Candidate
+	{
+		LightNode *light;
+		Entry *entry;
+		float priority;
+	};
+
+	std::vector<Candidate> candidates;
+	long long remaining = this->budget_;
+	bool rendered = false;
+	for (auto& light : lights) {
+		auto entry = this->entries_.find(light);
+		if (entry == this->entries_.end()) {
+			entry = this->entries_.insert(std::make_pair(light, Entry{ light->get_position(), 0, 0 })).first;
+		}
+		const float motion = glm::distance(light->get_position(), entry->second.position);
+		entry->second.position = light->get_position();
+
+		const int faces = light->get_dirty_shadow_faces();
+		if (faces == 0) {
+			entry->second.frames_waited = 0;
+			continue;
+		}
+		// without budget, and for maps which would show uninitialized faces, there is no choice
+		if (this->budget_ <= 0 || !light->is_shadow_map_complete()) {
+			const long long region_size = light->get_rendering_engine()->get_shadow_atlas()->get_region_size(light);
+			const long long face_texels = region_size * region_size;
+			for (int face = 0; face < light->get_shadow_strategy()->get_num_faces(); face++) {
+				if ((faces & (1 << face)) != 0) {
+					remaining -= face_texels;
+				}
+			}
+			light->render_shadow_map(faces);
+			entry->second.frames_waited = 0;
+			rendered = true;
+			continue;
+		}
+		candidates.push_back({ light, &entry->second, get_importance(light, camera, motion) * (1 + entry->second.frames_waited) });
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.priority > b.priority; });
+
+	for (auto& candidate : candidates) {
+		const auto strategy = candidate.light->get_shadow_strategy();
+		const long long region_size = candidate.light->get_rendering_engine()->get_shadow_atlas()->get_region_size(candidate.light);
+		const long long face_texels = region_size * region_size;
+		const int num_faces = strategy->get_num_faces();
+		const int dirty_faces = candidate.light->get_dirty_shadow_faces();
+
+		// continue with the face after the last one rendered, so every face gets its turn
+		int faces = 0;
+		const int first_face = candidate.entry->next_face;
+		for (int i = 0; i < num_faces; i++) {
+			const int face = (first_face + i) % num_faces;
+			// the most important face of a frame is rendered even if it alone exceeds the budget
+			if ((dirty_faces & (1 << face)) != 0 && (remaining >= face_texels || !rendered)) {
+				faces |= 1 << face;
+				remaining -= face_texels;
+				rendered = true;
+				candidate.entry->next_face = (face + 1) % num_faces;
+			}
+		}
+		if (faces != 0) {
+			candidate.light->render_shadow_map(faces);
+		}
+		candidate.entry->frames_waited = (dirty_faces & ~faces) != 0 ? candidate.entry->frames_waited + 1 : 0;
+	}
+}
+
+float ShadowScheduler::get_importance(const LightNode* light, const RenderingNode* camera, const float motion)
+{
+	const auto color = light->get_diffuse();
+	const float brightness = glm::max(glm::max(glm::max(color.r, color.g), color.b), 0.01f);
+
+	// outdated shadows of moving lights visibly lag behind them
+	return light->get_screen_coverage(camera) * brightness * (1.0f + 4.0f * glm::min(motion / fast_motion, 1.0f));
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <map>
+
+class LightNode;
+class RenderingNode;
+
+/*
+Refreshes the outdated shadow maps of the visible lights within a budget of rendered texels per frame.
+Lights are ordered by how much of the screen they may light, how bright they are and how fast they move,
+weighted with the number of frames they have been waiting, so dim or far lights are updated every few frames.
+Cubemap faces are refreshed in a rotating order, lights whose shadow map was never completed are always drawn.
+*/
+class ShadowScheduler
+{
+	struct Entry
+	{
+		glm::vec3 position;
+		int frames_waited;
+		int next_face;
+	};
+
+	std::map<const LightNode*, Entry> entries_;
+	long long budget_;
+
+	static float get_importance(const LightNode* light, const RenderingNode* camera, float motion);
+public:
+	//budget in texels per frame, 0 renders every outdated shadow map immediately
+	explicit ShadowScheduler(long long budget = 0);
+	~ShadowScheduler();
+
+	void set_budget(long long budget);
+
+	//renders the faces chosen for this frame, prepare_shadow_map has to be called for all lights before
+	void update(const std::vector<LightNode*>& lights, const RenderingNode* camera);
+};
@@ -0,0 +1,36 @@
+#include "SharpenShader.h"
+#include "GeometryNode.h"
+
+SharpenShader::SharpenShader() : ShaderResource("assets/shaders/postprocess.vs", "assets/shaders/sharpen.fs")
+{
+	this->texture_uniform_ = -1;
+	this->sharpness_uniform_ = -1;
+}
+
+SharpenShader::~SharpenShader()
+{
+}
+
+void SharpenShader::init()
+{
+	ShaderResource::init();
+	this->texture_uniform_ = get_uniform("image");
+	this->sharpness_uniform_ = get_uniform("sharpness");
+}
+
+void SharpenShader::set_camera_uniforms(const RenderingNode * node)
+{
+	//Nothing
+}
+
+void SharpenShader::set_model_uniforms(const GeometryNode * node)
+{
+	//Nothing
+}
+
+void SharpenShader::set_sharpen_uniforms(TextureRenderable* texture, float sharpness)
+{
+	texture->bind(0);
+	glUniform1i(texture_uniform_, 0);
+	glUniform1f(sharpness_uniform_, sharpness);
+}
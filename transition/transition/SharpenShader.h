@@ -0,0 +1,25 @@
+#pragma once
+#include "ShaderResource.h"
+#include "TextureResource.h"
+
+/*
+Shader for contrast adaptive sharpening of an image of the same size as the render target
+*/
+class SharpenShader : public ShaderResource {
+
+private:
+	GLint texture_uniform_;
+	GLint sharpness_uniform_;
+
+public:
+	SharpenShader();
+	~SharpenShader();
+
+	void init() override;
+
+	void set_camera_uniforms(const RenderingNode* node) override;
+	void set_model_uniforms(const GeometryNode* node) override;
+
+	//sharpness from 0 to 1
+	void set_sharpen_uniforms(TextureRenderable* texture, float sharpness);
+};
@@ -0,0 +1,215 @@
+#include "StaticBatchNode.h"
+#include "GroupNode.h"
+#include "RenderingEngine.h"
+#include "FrustumG.h"
+#include <algorithm>
+
+StaticBatchNode::StaticBatchNode(const std::string& name, MeshResource* resource, const std::vector<Part>& parts) : GeometryNode(name, resource)
+{
+	this->parts_ = parts;
+
+	// bounding sphere around the bounding spheres of all parts
+	glm::vec3 min = parts.front().center - parts.front().radius;
+	glm::vec3 max = parts.front().center + parts.front().radius;
+	for (auto& part : parts) {
+		min = glm::min(min, part.center - part.radius);
+		max = glm::max(max, part.center + part.radius);
+	}
+	this->center_ = (min + max) * 0.5f;
+	this->radius_ = 0;
+	for (auto& part : parts) {
+		this->radius_ = glm::max(this->radius_, glm::distance(this->center_, part.center) + part.radius);
+	}
+}
+
+StaticBatchNode::~StaticBatchNode()
+{
+}
+
+void StaticBatchNode::build(GroupNode* room, RenderingEngine* rendering_engine)
+{
+	// collect static opaque geometry grouped by material
+	std::vector<std::vector<GeometryNode*>> groups;
+	for (auto& drawable : room->get_drawables()) {
+		auto node = dynamic_cast<GeometryNode*>(drawable);
+		if (node == nullptr || node->is_dynamic()) {
+			continue;
+		}
+		const auto& material = node->get_mesh_resource()->get_material();
+		auto group = groups.begin();
+		while (group != groups.end() && group->front()->get_mesh_resource()->get_material() != material) {
+			++group;
+		}
+		if (group == groups.end()) {
+			groups.push_back({ node });
+		}
+		else {
+			group->push_back(node);
+		}
+	}
+
+	int batch_count = 0;
+	for (auto& group : groups) {
+		if (group.size() < 2) {
+			continue;
+		}
+
+		int num_vertices = 0;
+		int num_lods = 1;
+		for (auto& node : group) {
+			num_vertices += node->get_mesh_resource()->get_num_vertices();
+			num_lods = std::max(num_lods, node->get_mesh_resource()->get_num_lods());
+		}
+
+		float *vertices = new float[num_vertices * 3];
+		float *normals = new float[num_vertices * 3];
+		float *uvs = new float[num_vertices * 2];
+		std::vector<std::vector<unsigned int>> lod_indices(num_lods);
+
+		// pre-transform every node into world space
+		std::vector<Part> parts;
+		int vertex_offset = 0;
+		for (auto& node : group) {
+			const auto mesh = node->get_mesh_resource();
+			const auto& trafo = node->get_transformation();
+			const auto normal_trafo = glm::mat3(glm::transpose(node->get_inverse_transformation()));
+
+			for (int i = 0; i < mesh->get_num_vertices(); i++) {
+				const glm::vec3 position = trafo * glm::vec4(mesh->get_vertices()[i * 3], mesh->get_vertices()[i * 3 + 1], mesh->get_vertices()[i * 3 + 2], 1);
+				const glm::vec3 normal = glm::normalize(normal_trafo * glm::vec3(mesh->get_normals()[i * 3], mesh->get_normals()[i * 3 + 1], mesh->get_normals()[i * 3 + 2]));
+				const int v = vertex_offset + i;
+				vertices[v * 3 + 0] = position.x;
+				vertices[v * 3 + 1] = position.y;
+				vertices[v * 3 + 2] = position.z;
+				normals[v * 3 + 0] = normal.x;
+				normals[v * 3 + 1] = normal.y;
+				normals[v * 3 + 2] = normal.z;
+				uvs[v * 2 + 0] = mesh->get_uvs()[i * 2];
+				uvs[v * 2 + 1] = mesh->get_uvs()[i * 2 + 1];
+			}
+
+			Part part;
+			part.source = node;
+			for (int lod = 0; lod < num_lods; lod++) {
+				// parts with less levels use their coarsest one
+				const int mesh_lod = std::min(lod, mesh->get_num_lods() - 1);
+				auto& level = lod_indices[lod];
+				part.first_index[lod] = int(level.size());
+				part.num_indices[lod] = mesh->get_lod_num_indices(mesh_lod);
+				part.error[lod] = mesh->get_lod_error(mesh_lod) * node->get_scale();
+				for (int i = 0; i < part.num_indices[lod]; i++) {
+					level.push_back(mesh->get_lod_indices(mesh_lod)[i] + vertex_offset);
+				}
+			}
+			part.center = node->get_position();
+			part.radius = node->get_bounding_sphere_radius();
+			parts.push_back(part);
+
+			vertex_offset += mesh->get_num_vertices();
+			node->set_batched(true);
+		}
+
+		const int num_indices = int(lod_indices[0].size());
+		unsigned int *indices = new unsigned int[num_indices];
+		std::copy(lod_indices[0].begin(), lod_indices[0].end(), indices);
+
+		auto mesh = new MeshResource(vertices, normals, uvs, num_vertices, indices, num_indices, group.front()->get_mesh_resource()->get_material());
+		for (int lod = 1; lod < num_lods; lod++) {
+			float error = 0;
+			for (auto& part : parts) {
+				error = std::max(error, part.error[lod]);
+			}
+			mesh->add_lod(lod_indices[lod], error);
+		}
+		mesh->set_arena(rendering_engine->get_geometry_arena());
+		rendering_engine->register_resource(mesh);
+		mesh->init();
+
+		auto batch = new StaticBatchNode(room->get_name() + "_batch_" + std::to_string(batch_count++), mesh, parts);
+		room->add_node(batch);
+		batch->init(rendering_engine);
+		batch->set_enabled(room->is_enabled());
+	}
+}
+
+void StaticBatchNode::draw(ShaderResource* shader) const
+{
+	this->draw_parts(shader, nullptr, nullptr);
+}
+
+void StaticBatchNode::draw_culled(ShaderResource* shader, FrustumG* frustum, const LodSelection& lod) const
+{
+	this->draw_parts(shader, frustum, &lod);
+}
+
+void StaticBatchNode::draw_parts(ShaderResource* shader, FrustumG* frustum, const LodSelection* lod) const
+{
+	const auto mesh = this->get_mesh_resource();
+	const int index_size = VertexFormat::get_index_size(mesh->get_index_type());
+	const bool depth_stream = this->uses_depth_stream(shader);
+	std::vector<GLsizei> counts;
+	std::vector<const void*> offsets;
+	int last_index = -1;
+	for (auto& part : this->parts_) {
+		if (!part.source->is_enabled()) {
+			continue;
+		}
+		if (frustum != nullptr) {
+			glm::vec3 center = part.center;
+			if (frustum->sphereInFrustum(center, part.radius) == FrustumG::OUTSIDE) {
+				continue;
+			}
+		}
+		int part_lod = 0;
+		if (lod != nullptr) {
+			part_lod = mesh->get_num_lods() - 1;
+			while (part_lod > 0 && lod->get_projected_error(part.error[part_lod], part.center, part.radius) > 1.0f) {
+				part_lod--;
+			}
+		}
+		const int first_index = (depth_stream ? mesh->get_lod_depth_first_index(part_lod) : mesh->get_lod_first_index(part_lod)) + part.first_index[part_lod];
+		// consecutive visible parts are drawn as one range
+		if (first_index == last_index) {
+			counts.back() += part.num_indices[part_lod];
+		}
+		else {
+			counts.push_back(part.num_indices[part_lod]);
+			offsets.push_back(reinterpret_cast<const void*>(index_size * first_index));
+		}
+		last_index = first_index + part.num_indices[part_lod];
+	}
+	if (counts.empty()) {
+		return;
+	}
+
+	shader->set_model_uniforms(this);
+
+	const std::vector<GLint> base_vertices(counts.size(), mesh->get_base_vertex());
+	glBindVertexArray(depth_stream ? mesh->get_depth_resource_id() : mesh->get_resource_id());
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), mesh->get_index_type(), offsets.data(), GLsizei(counts.size()), base_vertices.data());
+	glBindVertexArray(0);
+}
+
+void StaticBatchNode::draw_instanced(ShaderResource* shader, const std::vector<const IDrawable*>& instances, const int lod) const
+{
+	// batches never share their geometry
+	for (auto& instance : instances) {
+		instance->draw(shader);
+	}
+}
+
+int StaticBatchNode::select_lod(const LodSelection& lod) const
+{
+	// chosen per part while drawing
+	return 0;
+}
+
+float StaticBatchNode::get_bounding_sphere_radius() const
+{
+	return this->radius_;
+}
+
+glm::vec3 StaticBatchNode::get_position() const
+{
+	return this->center_;
+}
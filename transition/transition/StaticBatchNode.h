@@ -0,0 +1,54 @@
+#pragma once
+#include "GeometryNode.h"
+#include <vector>
+
+class GroupNode;
+
+/*
+Merges all static, opaque GeometryNodes of a room which share a material into one pre-transformed mesh.
+Each merged node stays a part of the batch with its own index range and bounding sphere,
+so the parts are still culled (and enabled/disabled) individually, each in its own level of detail, and the visible ranges are drawn with glMultiDrawElements.
+*/
+class StaticBatchNode :
+	public GeometryNode
+{
+public:
+	//index range and world space error of the part per level of detail, relative to the first index of the level in the batch mesh
+	struct Part
+	{
+		const GeometryNode* source;
+		int first_index[MeshResource::max_lods];
+		int num_indices[MeshResource::max_lods];
+		float error[MeshResource::max_lods];
+		glm::vec3 center;
+		float radius;
+	};
+
+private:
+	std::vector<Part> parts_;
+	glm::vec3 center_;
+	float radius_;
+
+	StaticBatchNode(const std::string& name, MeshResource *resource, const std::vector<Part>& parts);
+	//lod nullptr draws all parts in full detail
+	void draw_parts(ShaderResource *shader, FrustumG *frustum, const LodSelection *lod) const;
+
+public:
+	~StaticBatchNode();
+
+	//replaces the static geometry of the room by batches, has to be called after the scene graph is initialized
+	static void build(GroupNode *room, RenderingEngine *rendering_engine);
+
+	void draw(ShaderResource *shader) const override;
+	void draw_culled(ShaderResource *shader, FrustumG *frustum, const LodSelection& lod) const override;
+	void draw_instanced(ShaderResource *shader, const std::vector<const IDrawable*>& instances, int lod) const override;
+	int select_lod(const LodSelection& lod) const override;
+
+	const std::vector<Part>& get_parts() const
+	{
+		return parts_;
+	}
+
+	float get_bounding_sphere_radius() const override;
+	glm::vec3 get_position() const override;
+};
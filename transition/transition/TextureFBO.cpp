@@ -13,9 +13,10 @@ TextureFBO::TextureFBO(int width, int height, unsigned int texture_count)
 	this->fbo_handle_ = 0;
 	this->depth_buffer_handle_ = 0;
 	this->texture_handles_ = nullptr;
+	this->attachments_ = nullptr;
 }
 
-void TextureFBO::init_color(bool depth_as_tex)
+void TextureFBO::init_color(bool depth_as_tex, bool depth_buffer)
 {
 	texture_handles_ = new GLuint[this->texture_count_];
 	glGenTextures(this->texture_count_, texture_handles_);
@@ -35,7 +36,7 @@ void TextureFBO::init_color(bool depth_as_tex)
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
 			this->size_.x, this->size_.y, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
 	}
-	else {
+	else if (depth_buffer) {
 		glGenRenderbuffers(1, &depth_buffer_handle_);
 		glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer_handle_);
 		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, this->size_.x, this->size_.y);
@@ -45,9 +46,10 @@ void TextureFBO::init_color(bool depth_as_tex)
 
 	for (unsigned int i = 0; i < color_attachment_count; i++) {
 		glBindTexture(GL_TEXTURE_2D, texture_handles_[i]);
+		// only level 0 is ever rendered to, so no mipmaps are allocated
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, this->size_.x, this->size_.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
-		glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -64,7 +66,7 @@ void TextureFBO::init_color(bool depth_as_tex)
 	if (depth_as_tex)
 	{
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->texture_handles_[this->texture_count_ - 1], 0);
-	} else
+	} else if (depth_buffer)
 	{
 		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_buffer_handle_);
 	}
@@ -22,7 +22,8 @@ public:
 	TextureFBO(int width, int height, unsigned int texture_count);
 	~TextureFBO() override;
 
-	void init_color(bool depth_as_tex = false);
+	//without depth_buffer (and not depth_as_tex) the fbo has no depth attachment
+	void init_color(bool depth_as_tex = false, bool depth_buffer = true);
 	void init_depth();
 	static void check_fbo();
 
@@ -0,0 +1,60 @@
+#include "UpscaleEffect.h"
+#include <cassert>
+
+UpscaleEffect::UpscaleEffect()
+{
+	screenMesh_ = nullptr;
+	upscale_shader_ = nullptr;
+	sharpen_shader_ = nullptr;
+	target_texture_ = -1;
+}
+
+void UpscaleEffect::init(RenderingEngine *engine, CameraNode *camera)
+{
+	screenMesh_ = MeshResource::create_sprite(nullptr);
+	screenMesh_->init();
+	upscale_shader_ = new UpscaleShader();
+	sharpen_shader_ = new SharpenShader();
+	engine->register_resource(upscale_shader_);
+	engine->register_resource(sharpen_shader_);
+	upscale_shader_->init();
+	sharpen_shader_->init();
+}
+
+int UpscaleEffect::add_passes(FrameGraph *graph, int from, const std::vector<LightNode *>& light_nodes)
+{
+	assert(target_texture_ >= 0);
+	const int target = target_texture_;
+	const glm::ivec2 size = graph->get_size(target);
+	const int upscaled = graph->create_texture("upscaled", { size, FrameGraph::FORMAT_COLOR });
+
+	graph->add_pass("upscale", { from }, { upscaled }, [this, from, upscaled, size](const FrameGraph& graph)
+	{
+		upscale_shader_->use();
+		upscale_shader_->set_texture(graph.get_fbo(from));
+		this->draw_screen(graph.get_fbo_id(upscaled), size);
+	});
+	graph->add_pass("sharpen", { upscaled }, { target }, [this, upscaled, target, size](const FrameGraph& graph)
+	{
+		sharpen_shader_->use();
+		sharpen_shader_->set_sharpen_uniforms(graph.get_fbo(upscaled), sharpness_);
+		this->draw_screen(graph.get_fbo_id(target), size);
+	});
+
+	return target;
+}
+
+void UpscaleEffect::draw_screen(const GLuint fbo, const glm::ivec2& size) const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glViewport(0, 0, size.x, size.y);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glBindVertexArray(screenMesh_->get_resource_id());
+	glDrawElements(GL_TRIANGLES, screenMesh_->get_num_indices(), screenMesh_->get_index_type(), nullptr);
+	glBindVertexArray(0);
+}
+
+void UpscaleEffect::set_target_texture(const int target_texture)
+{
+	this->target_texture_ = target_texture;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "PostProcessingEffect.h"
+#include "UpscaleShader.h"
+#include "SharpenShader.h"
+
+/*
+Brings an image rendered at a lower resolution to the size of the target: a deringed bicubic upscale,
+followed by contrast adaptive sharpening which restores some of the detail the upscale blurs.
+*/
+class UpscaleEffect : public PostProcessingEffect {
+private:
+	MeshResource *screenMesh_;
+	UpscaleShader *upscale_shader_;
+	SharpenShader *sharpen_shader_;
+	int target_texture_;
+	float sharpness_ = 0.5f;
+
+	void draw_screen(GLuint fbo, const glm::ivec2& size) const;
+public:
+	UpscaleEffect();
+
+	virtual void init(RenderingEngine *engine, CameraNode *camera) override;
+
+	//returns the target texture
+	virtual int add_passes(FrameGraph *graph, int from, const std::vector<LightNode *>& light_nodes) override;
+
+	//texture of the frame graph the result is written to, has to be set before add_passes
+	void set_target_texture(int target_texture);
+};
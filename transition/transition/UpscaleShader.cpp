@@ -0,0 +1,33 @@
+#include "UpscaleShader.h"
+#include "GeometryNode.h"
+
+UpscaleShader::UpscaleShader() : ShaderResource("assets/shaders/postprocess.vs", "assets/shaders/upscale.fs")
+{
+	this->texture_uniform_ = -1;
+}
+
+UpscaleShader::~UpscaleShader()
+{
+}
+
+void UpscaleShader::init()
+{
+	ShaderResource::init();
+	this->texture_uniform_ = get_uniform("image");
+}
+
+void UpscaleShader::set_camera_uniforms(const RenderingNode * node)
+{
+	//Nothing
+}
+
+void UpscaleShader::set_model_uniforms(const GeometryNode * node)
+{
+	//Nothing
+}
+
+void UpscaleShader::set_texture(TextureRenderable* texture)
+{
+	texture->bind(0);
+	glUniform1i(texture_uniform_, 0);
+}
@@ -3,22 +3,21 @@
 #include "TextureResource.h"
 
 /*
-Shader for applying a vertikal or horizontal gaussian filter to an image
+Shader for scaling an image up to the size of the render target with a deringed Catmull-Rom filter
 */
-class BloomGaussShader : public ShaderResource {
+class UpscaleShader : public ShaderResource {
 
 private:
 	GLint texture_uniform_;
-	GLint horizontal_uniform_;
 
 public:
-	BloomGaussShader();
-	~BloomGaussShader();
+	UpscaleShader();
+	~UpscaleShader();
 
 	void init() override;
 
 	void set_camera_uniforms(const RenderingNode* node) override;
 	void set_model_uniforms(const GeometryNode* node) override;
 
-	void set_gauss_uniforms(TextureRenderable* texture, bool horizontal);
+	void set_texture(TextureRenderable* texture);
 };
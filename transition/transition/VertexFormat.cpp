@@ -0,0 +1,141 @@
+#include "VertexFormat.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtx/component_wise.hpp>
+#include <cassert>
+#include <cstring>
+#include <cstddef>
+
+static glm::vec2 sign_not_zero(const glm::vec2& v)
+{
+	return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+// maps the unit sphere onto an octahedron and unfolds it into [-1, 1]^2, decoded in main_shader.vs
+static glm::vec2 encode_octahedral(const glm::vec3& normal)
+{
+	const float length = glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z);
+	if (length == 0.0f) {
+		return glm::vec2(0.0f);
+	}
+	const glm::vec3 n = normal / length;
+	if (n.z >= 0.0f) {
+		return glm::vec2(n.x, n.y);
+	}
+	return (1.0f - glm::abs(glm::vec2(n.y, n.x))) * sign_not_zero(glm::vec2(n.x, n.y));
+}
+
+// whole tiles every uv of the mesh is moved by, zero if the uvs already fit, e.g. the [0, 1] uvs of sprites
+static glm::vec2 get_uv_offset(const float* uvs, const int num_vertices)
+{
+	if (num_vertices == 0) {
+		return glm::vec2(0.0f);
+	}
+	glm::vec2 min_uv(uvs[0], uvs[1]);
+	glm::vec2 max_uv = min_uv;
+	for (int i = 1; i < num_vertices; i++) {
+		const glm::vec2 uv(uvs[i * 2], uvs[i * 2 + 1]);
+		min_uv = glm::min(min_uv, uv);
+		max_uv = glm::max(max_uv, uv);
+	}
+	if (glm::max(glm::compMax(glm::abs(min_uv)), glm::compMax(glm::abs(max_uv))) <= VertexFormat::max_half_uv) {
+		return glm::vec2(0.0f);
+	}
+	// only the textures of materials repeat, meshes sampling render targets never leave the range
+	return glm::round((min_uv + max_uv) * 0.5f);
+}
+
+bool VertexFormat::has_half_uvs(const float* uvs, const int num_vertices)
+{
+	const glm::vec2 offset = get_uv_offset(uvs, num_vertices);
+	for (int i = 0; i < num_vertices; i++) {
+		const glm::vec2 uv = glm::vec2(uvs[i * 2], uvs[i * 2 + 1]) - offset;
+		if (glm::abs(uv.x) > max_half_uv || glm::abs(uv.y) > max_half_uv) {
+			return false;
+		}
+	}
+	return true;
+}
+
+std::vector<VertexFormat::PackedAttributes> VertexFormat::pack_attributes(const float* uvs, const float* normals, const int num_vertices)
+{
+	assert(has_half_uvs(uvs, num_vertices));
+	// the textures repeat, whole tiles do not change what is sampled
+	const glm::vec2 offset = get_uv_offset(uvs, num_vertices);
+	std::vector<PackedAttributes> packed(num_vertices);
+	for (int i = 0; i < num_vertices; i++) {
+		packed[i].uv = glm::packHalf2x16(glm::vec2(uvs[i * 2], uvs[i * 2 + 1]) - offset);
+		// uvs in range are only rounded to half precision, never moved
+		assert(offset != glm::vec2(0.0f) || glm::compMax(glm::abs(glm::unpackHalf2x16(packed[i].uv) - glm::vec2(uvs[i * 2], uvs[i * 2 + 1]))) <= max_half_uv / 2048.0f);
+		packed[i].normal = glm::packSnorm2x16(encode_octahedral(glm::vec3(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2])));
+	}
+	return packed;
+}
+
+std::vector<VertexFormat::WideAttributes> VertexFormat::pack_wide_attributes(const float* uvs, const float* normals, const int num_vertices)
+{
+	std::vector<WideAttributes> packed(num_vertices);
+	for (int i = 0; i < num_vertices; i++) {
+		packed[i].uv[0] = uvs[i * 2];
+		packed[i].uv[1] = uvs[i * 2 + 1];
+		packed[i].normal = glm::packSnorm2x16(encode_octahedral(glm::vec3(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2])));
+	}
+	return packed;
+}
+
+GLenum VertexFormat::get_index_type(const int num_vertices)
+{
+	return num_vertices <= 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+int VertexFormat::get_index_size(const GLenum index_type)
+{
+	return index_type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+std::vector<unsigned char> VertexFormat::pack_indices(const unsigned int* indices, const int num_indices, const GLenum index_type)
+{
+	std::vector<unsigned char> packed(get_index_size(index_type) * num_indices);
+	if (index_type == GL_UNSIGNED_SHORT) {
+		const auto shorts = reinterpret_cast<GLushort*>(packed.data());
+		for (int i = 0; i < num_indices; i++) {
+			shorts[i] = GLushort(indices[i]);
+		}
+	}
+	else {
+		memcpy(packed.data(), indices, packed.size());
+	}
+	return packed;
+}
+
+void VertexFormat::setup_position_attribute(const GLuint positions)
+{
+	//Bind Positions to Shader-Location 0
+	glBindBuffer(GL_ARRAY_BUFFER, positions);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+}
+
+void VertexFormat::setup_attributes(const GLuint positions, const GLuint attributes, const bool wide_uvs)
+{
+	setup_position_attribute(positions);
+
+	//Bind UVs to Shader-Location 1
+	glBindBuffer(GL_ARRAY_BUFFER, attributes);
+	glEnableVertexAttribArray(1);
+	if (wide_uvs) {
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(WideAttributes), reinterpret_cast<void*>(offsetof(WideAttributes, uv)));
+	}
+	else {
+		glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedAttributes), reinterpret_cast<void*>(offsetof(PackedAttributes, uv)));
+	}
+
+	//Bind Normals to Shader-Location 2
+	glEnableVertexAttribArray(2);
+	if (wide_uvs) {
+		glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, sizeof(WideAttributes), reinterpret_cast<void*>(offsetof(WideAttributes, normal)));
+	}
+	else {
+		glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, sizeof(PackedAttributes), reinterpret_cast<void*>(offsetof(PackedAttributes, normal)));
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "glheaders.h"
+#include <vector>
+
+/*
+Vertex layout of all meshes. Positions stay full precision floats in their own buffer, which is the only stream the
+depth passes have to fetch. UVs (2x half float) and octahedral encoded normals (2x snorm16) are interleaved in a second
+buffer with 8 bytes per vertex. The textures repeat, so each mesh's UVs are moved by a whole number of tiles towards
+zero before packing; meshes whose UVs still leave the range halves resolve well fall back to 2x float UVs (12 bytes)
+and their own buffers. Indices are stored with 16 bit whenever the mesh has few enough vertices.
+*/
+class VertexFormat
+{
+public:
+	struct PackedAttributes
+	{
+		GLuint uv;
+		GLuint normal;
+	};
+
+	struct WideAttributes
+	{
+		float uv[2];
+		GLuint normal;
+	};
+
+	//half floats keep at least 1/2048 of a tile below this magnitude
+	static constexpr float max_half_uv = 4.0f;
+
+	//true if the uvs of the mesh are within max_half_uv once moved towards zero by whole tiles
+	static bool has_half_uvs(const float *uvs, int num_vertices);
+	//requires has_half_uvs
+	static std::vector<PackedAttributes> pack_attributes(const float *uvs, const float *normals, int num_vertices);
+	static std::vector<WideAttributes> pack_wide_attributes(const float *uvs, const float *normals, int num_vertices);
+
+	//GL_UNSIGNED_SHORT if every index of a mesh with num_vertices vertices fits into 16 bit, GL_UNSIGNED_INT otherwise
+	static GLenum get_index_type(int num_vertices);
+	static int get_index_size(GLenum index_type);
+	static std::vector<unsigned char> pack_indices(const unsigned int *indices, int num_indices, GLenum index_type);
+
+	//location 0 positions, 1 uvs, 2 normals from the given buffers, for the currently bound vao
+	static void setup_attributes(GLuint positions, GLuint attributes, bool wide_uvs = false);
+	//location 0 positions only, for the vaos of the depth passes
+	static void setup_position_attribute(GLuint positions);
+};
@@ -1,26 +1,24 @@
 #include "VolumetricLightingEffect.h"
 #include "VolumetricLightingBlurShader.h"
 #include "CameraNode.h"
-#include "VolumetricLightingUpSampleShader.h"
 #include "VolumetricLightingDownSampleShader.h"
 #include "VolumetricLightingShader.h"
 #include "DummyShader.h"
+#include "ShadowAtlas.h"
+#include "ComputeShader.h"
+
+//texels blurred by one work group of volumetric_lighting_blur.comp
+static const int blur_tile_size = 64;
 
 VolumetricLightingEffect::VolumetricLightingEffect()
 {
 	this->screen_mesh_ = nullptr;
 	this->blur_shader_ = nullptr;
-	this->upsample_shader_ = nullptr;
-	this->ping_half_res_fbo_ = nullptr;
-	this->pong_half_res_fbo_ = nullptr;
-	this->depth_half_res_fbo_ = nullptr;
+	this->blur_compute_shader_ = nullptr;
 }
 
 VolumetricLightingEffect::~VolumetricLightingEffect()
 {
-	delete this->ping_half_res_fbo_;
-	delete this->pong_half_res_fbo_;
-	delete this->depth_half_res_fbo_;
 }
 
 void VolumetricLightingEffect::init(RenderingEngine* engine, CameraNode *camera)
@@ -29,24 +27,16 @@ void VolumetricLightingEffect::init(RenderingEngine* engine, CameraNode *camera)
 	this->screen_mesh_->init();
 
 	this->camera_ = camera;
-	this->viewport_ = engine->get_viewport();
-
-	this->blur_shader_ = new VolumetricLightingBlurShader();
-	engine->register_resource(this->blur_shader_);
-	this->blur_shader_->init();
-
-	this->ping_half_res_fbo_ = new TextureFBO(this->viewport_.x / 2, this->viewport_.y / 2, 1);
-	this->ping_half_res_fbo_->init_color();
 
-	this->pong_half_res_fbo_ = new TextureFBO(this->viewport_.x / 2, this->viewport_.y / 2, 1);
-	this->pong_half_res_fbo_->init_color();
-
-	this->depth_half_res_fbo_ = new TextureFBO(this->viewport_.x / 2, this->viewport_.y / 2, 1);
-	this->depth_half_res_fbo_->init_depth();
-	
-	this->upsample_shader_ = new VolumetricLightingUpSampleShader();
-	engine->register_resource(this->upsample_shader_);
-	this->upsample_shader_->init();
+	if (GLAD_GL_VERSION_4_3) {
+		this->blur_compute_shader_ = new ComputeShader("assets/shaders/volumetric_lighting_blur.comp");
+		engine->register_resource(this->blur_compute_shader_);
+		this->blur_compute_shader_->init();
+	} else {
+		this->blur_shader_ = new VolumetricLightingBlurShader();
+		engine->register_resource(this->blur_shader_);
+		this->blur_shader_->init();
+	}
 
 	this->downsample_shader_ = new VolumetricLightingDownSampleShader();
 	engine->register_resource(this->downsample_shader_);
@@ -61,82 +51,84 @@ void VolumetricLightingEffect::init(RenderingEngine* engine, CameraNode *camera)
 	this->dummy_shader_->init();
 }
 
-void VolumetricLightingEffect::perform_effect(const TextureFBO* from, GLuint fbo_to, const std::vector<LightNode *> light_nodes)
+int VolumetricLightingEffect::add_passes(FrameGraph *graph, int from, const std::vector<LightNode *>& light_nodes)
 {
-	TextureRenderable *scene_tex = from->get_texture(0);
-	TextureRenderable *depth_tex = from->get_texture(from->get_depth_index());
-	const glm::ivec2 size = this->ping_half_res_fbo_->get_size();
-	auto frustum = camera_->get_frustum();
-
-	glDisable(GL_BLEND);
+	const glm::ivec2 size = graph->get_size(from) / 2;
+	const int depth = graph->create_texture("volumetric depth", { size, FrameGraph::FORMAT_DEPTH });
+	const int lighting = graph->create_texture("volumetric lighting", { size, FrameGraph::FORMAT_COLOR });
+	const int blurred_vertical = graph->create_texture("volumetric blur vertical", { size, FrameGraph::FORMAT_COLOR });
+	const int result = graph->create_texture("volumetric blur horizontal", { size, FrameGraph::FORMAT_COLOR });
 
 	// down sample scene using depth aware downsampling
-	downsample_shader_->use();
-	downsample_shader_->set_depth_texture(depth_tex);
-	glBindFramebuffer(GL_FRAMEBUFFER, depth_half_res_fbo_->get_fbo_id());
-	glViewport(0, 0, size.x, size.y);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glBindVertexArray(screen_mesh_->get_resource_id());
-	glDrawElements(GL_TRIANGLES, screen_mesh_->get_num_indices(), GL_UNSIGNED_INT, nullptr);
-	glBindVertexArray(0);
+	graph->add_pass("volumetric depth downsample", { from }, { depth }, [this, from, depth, size](const FrameGraph& graph)
+	{
+		const auto scene = graph.get_fbo(from);
+		downsample_shader_->use();
+		downsample_shader_->set_depth_texture(scene->get_texture(scene->get_depth_index()));
+		this->draw_screen(graph.get_fbo_id(depth), size);
+	});
 
 	// calculate volumetric lighting
-	volumetric_lighting_shader_->use();
-	volumetric_lighting_shader_->set_light_uniforms(light_nodes);
-	volumetric_lighting_shader_->set_camera_uniforms(camera_);
-	volumetric_lighting_shader_->set_depth_texture(depth_half_res_fbo_);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, pong_half_res_fbo_->get_fbo_id());
-	glViewport(0, 0, size.x, size.y);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glBindVertexArray(screen_mesh_->get_resource_id());
-	glDrawElements(GL_TRIANGLES, screen_mesh_->get_num_indices(), GL_UNSIGNED_INT, nullptr);
-	glBindVertexArray(0);
-
-
-	// blur volumetric lighting using depth aware gauss vertically
-	blur_shader_->use();
-	blur_shader_->set_volumetric_texture(pong_half_res_fbo_);
-	blur_shader_->set_vertical_pass(true);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, this->ping_half_res_fbo_->get_fbo_id());
-	glViewport(0, 0, size.x, size.y);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glBindVertexArray(screen_mesh_->get_resource_id());
-	glDrawElements(GL_TRIANGLES, screen_mesh_->get_num_indices(), GL_UNSIGNED_INT, nullptr);
-	glBindVertexArray(0);
-
-	// blur volumetric lighting using depth aware gauss horizontally
-	blur_shader_->set_vertical_pass(false);
-	blur_shader_->set_volumetric_texture(ping_half_res_fbo_);
-	blur_shader_->set_near_far_plane(frustum->nearD, frustum->farD);
+	graph->add_pass("volumetric lighting", { depth }, { lighting }, [this, depth, lighting, size](const FrameGraph& graph)
+	{
+		volumetric_lighting_shader_->use();
+		volumetric_lighting_shader_->set_light_grid(camera_->get_light_grid());
+		volumetric_lighting_shader_->set_shadow_atlas(camera_->get_rendering_engine()->get_shadow_atlas());
+		volumetric_lighting_shader_->set_camera_uniforms(camera_);
+		volumetric_lighting_shader_->set_depth_texture(graph.get_fbo(depth));
+		this->draw_screen(graph.get_fbo_id(lighting), size);
+	});
+
+	// blur volumetric lighting using depth aware gauss vertically and horizontally
+	graph->add_pass("volumetric blur vertical", { lighting }, { blurred_vertical }, [this, lighting, blurred_vertical](const FrameGraph& graph)
+	{
+		auto frustum = camera_->get_frustum();
+		this->blur(graph.get_fbo(lighting), graph.get_fbo(blurred_vertical), true, frustum->nearD, frustum->farD);
+	});
+	graph->add_pass("volumetric blur horizontal", { blurred_vertical }, { result }, [this, blurred_vertical, result](const FrameGraph& graph)
+	{
+		auto frustum = camera_->get_frustum();
+		this->blur(graph.get_fbo(blurred_vertical), graph.get_fbo(result), false, frustum->nearD, frustum->farD);
+	});
+
+	return result;
+}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, this->pong_half_res_fbo_->get_fbo_id());
+void VolumetricLightingEffect::draw_screen(const GLuint fbo, const glm::ivec2& size) const
+{
+	glDisable(GL_BLEND);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 	glViewport(0, 0, size.x, size.y);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	glBindVertexArray(screen_mesh_->get_resource_id());
-	glDrawElements(GL_TRIANGLES, screen_mesh_->get_num_indices(), GL_UNSIGNED_INT, nullptr);
+	glDrawElements(GL_TRIANGLES, screen_mesh_->get_num_indices(), screen_mesh_->get_index_type(), nullptr);
 	glBindVertexArray(0);
-
-	// get volumetric lighting to full resolution using depth aware upsampling
-	upsample_shader_->use();
-	upsample_shader_->set_volumetric_texture(pong_half_res_fbo_);
-	upsample_shader_->set_scene_texture(scene_tex);
-	upsample_shader_->set_bloom_treshold(bloom_treshold_);
-	upsample_shader_->set_near_far_plane(frustum->nearD, frustum->farD);
-
-	glBindFramebuffer(GL_FRAMEBUFFER, fbo_to);
-	glViewport(0, 0, viewport_.x, viewport_.y);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glBindVertexArray(screen_mesh_->get_resource_id());
-	glDrawElements(GL_TRIANGLES, screen_mesh_->get_num_indices(), GL_UNSIGNED_INT, nullptr);
-	glBindVertexArray(0);
-
 	glEnable(GL_BLEND);
 }
 
-void VolumetricLightingEffect::set_bloom_treshold(float treshold)
+void VolumetricLightingEffect::blur(const TextureFBO* source, const TextureFBO* target, const bool vertical, const float near_plane, const float far_plane) const
 {
-	this->bloom_treshold_ = treshold;
-}
+	const glm::ivec2 size = target->get_size();
+
+	if (this->blur_compute_shader_ != nullptr) {
+		// the fragment shader's vertical pass steps along x, so does this one
+		const glm::ivec2 direction = vertical ? glm::ivec2(1, 0) : glm::ivec2(0, 1);
+		const int line_size = vertical ? size.x : size.y;
+		const int num_lines = vertical ? size.y : size.x;
+
+		this->blur_compute_shader_->use();
+		glUniform2i(0, direction.x, direction.y);
+		glUniform2f(1, near_plane, far_plane);
+		source->bind(0, 0);
+		glBindImageTexture(0, target->get_texture_id(0), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+		glDispatchCompute(GLuint((line_size + blur_tile_size - 1) / blur_tile_size), GLuint(num_lines), 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		return;
+	}
 
+	blur_shader_->use();
+	blur_shader_->set_volumetric_texture(source->get_texture(0));
+	blur_shader_->set_vertical_pass(vertical);
+	blur_shader_->set_near_far_plane(near_plane, far_plane);
+	this->draw_screen(target->get_fbo_id(), size);
+}
@@ -3,27 +3,29 @@
 class MeshResource;
 class VolumetricLightingBlurShader;
 class VolumetricLightingShader;
-class VolumetricLightingUpSampleShader;
 class VolumetricLightingDownSampleShader;
 class DummyShader;
+class ComputeShader;
 
+/*
+Renders the volumetric lighting at half resolution and blurs it depth aware.
+The half resolution result is upsampled in the composite pass of the BloomEffect, which only reads it if a visible
+light is volumetric, otherwise the frame graph culls all passes of this effect.
+*/
 class VolumetricLightingEffect : public PostProcessingEffect {
 	MeshResource *screen_mesh_;
-	glm::ivec2 viewport_;
 
-	VolumetricLightingUpSampleShader *upsample_shader_;
 	VolumetricLightingDownSampleShader *downsample_shader_;
 	VolumetricLightingShader *volumetric_lighting_shader_;
 	VolumetricLightingBlurShader *blur_shader_;
-
-	TextureFBO *pong_half_res_fbo_;
-	TextureFBO *ping_half_res_fbo_;
-	TextureFBO *depth_half_res_fbo_;
+	//with GL 4.3 the blur passes run as compute shader, otherwise with blur_shader_
+	ComputeShader *blur_compute_shader_;
 
 	CameraNode *camera_;
 	DummyShader *dummy_shader_;
 
-	float bloom_treshold_ = 0.8;
+	void draw_screen(GLuint fbo, const glm::ivec2& size) const;
+	void blur(const TextureFBO *source, const TextureFBO *target, bool vertical, float near_plane, float far_plane) const;
 
 public:
 	VolumetricLightingEffect();
@@ -31,8 +33,6 @@ public:
 
 	virtual void init(RenderingEngine *engine, CameraNode *camera) override;
 
-	virtual void perform_effect(const TextureFBO *from, GLuint fbo_to, const std::vector<LightNode *> light_nodes) override;
-
-	void set_bloom_treshold(float treshold);
-
+	//from has to hold the scene color and its depth texture, returns the blurred half resolution volumetric lighting
+	virtual int add_passes(FrameGraph *graph, int from, const std::vector<LightNode *>& light_nodes) override;
 };
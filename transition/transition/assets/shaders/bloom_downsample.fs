@@ -0,0 +1,54 @@
+#version 330 core
+//Source: Jimenez, Next Generation Post Processing in Call of Duty: Advanced Warfare, SIGGRAPH 2014
+out vec4 FragColor;
+in vec2 TexCoords;
+
+uniform sampler2D image;
+//the first step reads the scene as image and adds the volumetric lighting
+uniform bool bright_pass;
+uniform bool volumetric_enabled;
+uniform sampler2D volumetric_tex;
+uniform float bloom_treshold;
+
+//the render targets have no mipmaps, the level is given to skip the derivatives
+vec3 fetch(vec2 offset, vec2 texel)
+{
+	vec2 uv = TexCoords + offset * texel;
+	vec3 color = textureLod(image, uv, 0).rgb;
+	if (bright_pass) {
+		if (volumetric_enabled) {
+			color += textureLod(volumetric_tex, uv, 0).rgb;
+		}
+		float brightness = dot(color, vec3(0.2126, 0.7152, 0.0722));
+		if (brightness <= bloom_treshold) {
+			color = vec3(0.0);
+		}
+	}
+	return color;
+}
+
+void main()
+{
+	vec2 texel = 1.0 / textureSize(image, 0);
+
+	vec3 a = fetch(vec2(-2, 2), texel);
+	vec3 b = fetch(vec2(0, 2), texel);
+	vec3 c = fetch(vec2(2, 2), texel);
+	vec3 d = fetch(vec2(-2, 0), texel);
+	vec3 e = fetch(vec2(0, 0), texel);
+	vec3 f = fetch(vec2(2, 0), texel);
+	vec3 g = fetch(vec2(-2, -2), texel);
+	vec3 h = fetch(vec2(0, -2), texel);
+	vec3 i = fetch(vec2(2, -2), texel);
+	vec3 j = fetch(vec2(-1, 1), texel);
+	vec3 k = fetch(vec2(1, 1), texel);
+	vec3 l = fetch(vec2(-1, -1), texel);
+	vec3 m = fetch(vec2(1, -1), texel);
+
+	//five overlapping 2x2 boxes, the inner one weighted with 0.5
+	vec3 result = (j + k + l + m) * 0.125;
+	result += (a + c + g + i) * 0.03125;
+	result += (b + d + f + h) * 0.0625;
+	result += e * 0.125;
+	FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,25 @@
+#version 330 core
+//Source: Jimenez, Next Generation Post Processing in Call of Duty: Advanced Warfare, SIGGRAPH 2014
+out vec4 FragColor;
+in vec2 TexCoords;
+
+uniform sampler2D image;
+uniform float weight;
+
+vec3 fetch(vec2 offset, vec2 texel)
+{
+	return textureLod(image, TexCoords + offset * texel, 0).rgb;
+}
+
+void main()
+{
+	//the radius is one texel of the smaller level, a fixed share of the screen at every resolution
+	vec2 texel = 1.0 / textureSize(image, 0);
+
+	vec3 result = fetch(vec2(0, 0), texel) * 4.0;
+	result += (fetch(vec2(-1, 0), texel) + fetch(vec2(1, 0), texel) + fetch(vec2(0, -1), texel) + fetch(vec2(0, 1), texel)) * 2.0;
+	result += fetch(vec2(-1, -1), texel) + fetch(vec2(1, -1), texel) + fetch(vec2(-1, 1), texel) + fetch(vec2(1, 1), texel);
+
+	//blended over the downsampled image of the target level with the alpha
+	FragColor = vec4(result / 16.0, weight);
+}
@@ -0,0 +1,92 @@
+#version 330 core
+
+#define UPSAMPLE_DEPTH_THRESHOLD (0.5)
+
+// Last pass of the frame: upsamples the volumetric lighting depth aware, adds it to the scene,
+// adds the bloom and blends in the credits. Disabled effects are skipped with uniform branches.
+
+layout (location = 0) out vec4 FragColor;
+
+in vec2 TexCoordsCenter;
+in vec2 TexCoordsLeftTop;
+in vec2 TexCoordsRightTop;
+in vec2 TexCoordsLeftBottom;
+in vec2 TexCoordsRightBottom;
+
+float linear_eye_depth(float depth_value);
+
+uniform sampler2D scene_tex;
+uniform bool volumetric_enabled;
+uniform sampler2D volumetric_tex;
+uniform float near_plane;
+uniform float far_plane;
+
+uniform bool bloom_enabled;
+uniform sampler2D bloom_tex;
+uniform float addintensity;
+
+uniform bool end_tex_enabled;
+uniform sampler2D end_tex;
+uniform float end_tex_intensity;
+
+void main() {
+	vec4 scene_color = texture(scene_tex, TexCoordsCenter);
+	
+	vec4 volumetric_color = vec4(0.0);
+	
+	if (volumetric_enabled) {
+		vec4 volumetric_tex_left_top = texture(volumetric_tex, TexCoordsLeftTop);
+		vec4 volumetric_tex_right_top = texture(volumetric_tex, TexCoordsRightTop);
+		vec4 volumetric_tex_left_bottom = texture(volumetric_tex, TexCoordsLeftBottom);
+		vec4 volumetric_tex_right_bottom = texture(volumetric_tex, TexCoordsRightBottom);
+	
+		vec4 high_res_depth = vec4(linear_eye_depth(scene_color.w));
+		vec4 low_res_depth = vec4(
+			linear_eye_depth(volumetric_tex_left_top.w),
+			linear_eye_depth(volumetric_tex_right_top.w),
+			linear_eye_depth(volumetric_tex_left_bottom.w),
+			linear_eye_depth(volumetric_tex_right_bottom.w)
+		);
+	
+		vec4 depth_diff = abs(low_res_depth - high_res_depth);
+		float accum_diff = dot(depth_diff, vec4(1));
+	
+		if (accum_diff < UPSAMPLE_DEPTH_THRESHOLD) {
+			volumetric_color = texture(volumetric_tex, TexCoordsCenter);
+		} else {
+			float min_depth_diff = depth_diff[0];
+			volumetric_color = volumetric_tex_left_top;
+		
+			if (depth_diff[1] < min_depth_diff) {
+				min_depth_diff = depth_diff[1];
+				volumetric_color = volumetric_tex_right_top;
+			}
+		
+			if (depth_diff[2] < min_depth_diff) {
+				min_depth_diff = depth_diff[2];
+				volumetric_color = volumetric_tex_left_bottom;
+			}
+		
+			if (depth_diff[3] < min_depth_diff) {
+				min_depth_diff = depth_diff[3];
+				volumetric_color = volumetric_tex_right_bottom;
+			}
+		}
+	}
+	
+	vec3 color = volumetric_color.rgb + scene_color.rgb;
+
+	if (bloom_enabled) {
+		color += addintensity * texture(bloom_tex, TexCoordsCenter).rgb;
+	}
+	if (end_tex_enabled) {
+		vec3 end_tex_color = end_tex_intensity * texture(end_tex, TexCoordsCenter).rgb;
+		color = mix(color, end_tex_color, end_tex_intensity);
+	}
+	FragColor = vec4(color, 1);
+}
+
+float linear_eye_depth(float depth_value) {
+	float z = depth_value * 2.0 - 1.0; // Back to NDC 
+    return (2.0 * near_plane * far_plane) / (far_plane + near_plane - z * (far_plane - near_plane));	
+}
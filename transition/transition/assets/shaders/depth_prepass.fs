@@ -0,0 +1,24 @@
+#version 330 core
+
+in vec2 tex_coords;
+
+struct Material {
+	bool has_alpha_tex;
+	sampler2D alpha_tex;
+	float alpha_cutoff;
+	float opacity;
+};
+
+uniform Material material;
+
+void main()
+{
+	//same cutout as in main_shader.fs
+	float alpha = material.opacity;
+	if (material.has_alpha_tex) {
+		alpha = alpha * texture(material.alpha_tex, tex_coords).r;
+	}
+	if (alpha < material.alpha_cutoff) {
+		discard;
+	}
+}
@@ -0,0 +1,28 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTex;
+layout (location = 3) in mat4 aInstanceModel;
+
+out vec2 tex_coords;
+
+struct MVP {
+	mat4 model;
+	mat4 view;
+	mat4 projection;
+};
+
+uniform MVP mvp;
+uniform bool instanced;
+
+//same computation as in main_shader.vs, so the depth of both passes is equal
+invariant gl_Position;
+
+void main()
+{
+	mat4 model = instanced ? aInstanceModel : mvp.model;
+
+	vec3 frag_pos = vec3(model * vec4(aPos, 1.0));
+	tex_coords = aTex;
+
+	gl_Position = mvp.projection * mvp.view * vec4(frag_pos, 1.0);
+}
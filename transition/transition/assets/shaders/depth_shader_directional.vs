@@ -1,12 +1,19 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTex;
+layout (location = 3) in mat4 aInstanceModel;
 out vec2 f_uv;
 
 uniform mat4 mvp;
+uniform mat4 view_projection;
+uniform bool instanced;
 
 void main()
 {
-	gl_Position = mvp * vec4(aPos, 1.0);
+	if (instanced) {
+		gl_Position = view_projection * aInstanceModel * vec4(aPos, 1.0);
+	} else {
+		gl_Position = mvp * vec4(aPos, 1.0);
+	}
 	f_uv = aTex;
 }  
\ No newline at end of file
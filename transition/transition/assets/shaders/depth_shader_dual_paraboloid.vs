@@ -0,0 +1,24 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in mat4 aInstanceModel;
+
+uniform mat4 model;
+uniform bool instanced;
+uniform mat4 shadow_view; // view matrix of the rendered hemisphere, looking along -z
+uniform float far_plane;
+
+out vec4 FragPos;
+
+void main()
+{
+	FragPos = (instanced ? aInstanceModel : model) * vec4(aPos, 1.0);
+	
+	// project onto the paraboloid, the hemisphere covers the disc of radius one
+	vec3 pos = (shadow_view * FragPos).xyz;
+	float distance = length(pos);
+	vec3 dir = pos / distance;
+	gl_Position = vec4(dir.xy / (1.0 - dir.z), distance / far_plane * 2.0 - 1.0, 1.0);
+	
+	// everything behind the hemisphere belongs to the other one
+	gl_ClipDistance[0] = -dir.z;
+}
\ No newline at end of file
@@ -1,9 +1,15 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
+layout (location = 3) in mat4 aInstanceModel;
 
 uniform mat4 model;
+uniform bool instanced;
+uniform mat4 shadow_transform; // projection and view of the rendered cube face
+
+out vec4 FragPos;
 
 void main()
 {
-	gl_Position = model * vec4(aPos, 1.0);
-}  
\ No newline at end of file
+	FragPos = (instanced ? aInstanceModel : model) * vec4(aPos, 1.0);
+	gl_Position = shadow_transform * FragPos;
+}
@@ -1,16 +1,13 @@
 #version 330 core
-#define MAX_NR_LIGHTS (10)
-#define MAX_NR_DIRECTIONAL_SHADOWS (5)
-#define MAX_NR_OMNI_DIRECTIONAL_SHADOWS (5)
-#define PCF_TOTAL_SAMPLES (25)
-#define PCF_COUNT (2)
 #define PCF_OMNI_DIRECTIONAL_SAMPLES (20)
+#define MAX_NR_OBJECT_LIGHTS (16)
+#define EVSM_EXPONENT (5.54)
+#define EVSM_BLEEDING_REDUCTION (0.2)
 
 in VS_OUT {
     vec3 frag_pos;
     vec3 normal;
     vec2 tex_coords;
-    vec4 frag_pos_lightspace[MAX_NR_DIRECTIONAL_SHADOWS];
 } fs_in;
 
 layout (location = 0) out vec4 FragColor;
@@ -41,7 +38,7 @@ struct Light {
     vec3 specular;
 	
 	bool shadow_casting;
-	int shadow_map_index;
+	int shadow_view;	// first view in the shadow atlas
 	float min_bias;
 	float max_bias;
 	
@@ -51,41 +48,36 @@ struct Light {
 	
 	// point light
 	float far_plane;
-	float near_plane;
+	
+	// shadow_projection=1: light space matrix projecting to the map
+	// shadow_projection=2: six cube faces storing the distance to the light
+	// shadow_projection=3: two paraboloid hemispheres storing the distance to the light
+	int shadow_projection;
+	
+	// cascaded directional light, view space depth at which each cascade ends
+	vec4 cascade_splits;
 };
-uniform Light lights[MAX_NR_LIGHTS];
-uniform sampler2D directional_shadow_maps[MAX_NR_DIRECTIONAL_SHADOWS];
-uniform samplerCube omni_directional_shadow_maps[MAX_NR_OMNI_DIRECTIONAL_SHADOWS];
-uniform int num_lights;
-uniform mat4 light_space_matrices[MAX_NR_DIRECTIONAL_SHADOWS];
-uniform mat4 light_view_matrices[MAX_NR_DIRECTIONAL_SHADOWS];
-uniform mat4 light_projection_matrices[MAX_NR_DIRECTIONAL_SHADOWS];
-
-#define DIRECTIONAL_SHADOW_MAP(A,B,C,X) \
-	if (B == 0) { \
-		X = A(directional_shadow_maps[0], C); \
-	} else if (B == 1) { \
-		X = A(directional_shadow_maps[1], C); \
-	} else if (B == 2) { \
-		X = A(directional_shadow_maps[2], C); \
-	} else if (B == 3) { \
-		X = A(directional_shadow_maps[3], C); \
-	} else if (B == 4) { \
-		X = A(directional_shadow_maps[4], C); \
-	} 
-
-#define OMNI_DIRECTIONAL_SHADOW_MAP(A,B,C,X) \
-	if (B == 0) { \
-		X = A(omni_directional_shadow_maps[0], C); \
-	} else if (B == 1) { \
-		X = A(omni_directional_shadow_maps[1], C); \
-	} else if (B == 2) { \
-		X = A(omni_directional_shadow_maps[2], C); \
-	} else if (B == 3) { \
-		X = A(omni_directional_shadow_maps[3], C); \
-	} else if (B == 4) { \
-		X = A(omni_directional_shadow_maps[4], C); \
-	} 
+// the shadow maps of all lights are regions of one atlas, see ShadowAtlas
+uniform sampler2D shadow_atlas;
+uniform samplerBuffer shadow_views;	// 5 texels per view: light space matrix, rectangle of the region in the atlas
+uniform bool shadow_filtered;		// the atlas holds blurred and mipmapped EVSM moments instead of depth
+uniform int shadow_pcf_radius;		// kernel of (2 * radius + 1)^2 taps for single views
+uniform int shadow_pcf_omni_samples;	// taps for point lights, at most PCF_OMNI_DIRECTIONAL_SAMPLES
+
+// clustered lights, see LightGrid
+struct LightGrid {
+	usamplerBuffer clusters;	// offset and count of the light index list of every cluster
+	usamplerBuffer indices;
+	samplerBuffer lights;		// 8 texels per light
+	ivec3 size;					// tiles x, tiles y, depth slices
+	float tile_size;
+	vec2 depth_scale_bias;		// slice = log(view space depth) * x + y
+};
+uniform LightGrid light_grid;
+
+// lights reaching the drawn object, used instead of the light grid if not negative
+uniform int object_light_count;
+uniform int object_lights[MAX_NR_OBJECT_LIGHTS];
 
 struct Material {
 	bool has_diffuse_tex;
@@ -135,10 +127,24 @@ vec3 calc_spot_light(
 
 vec3 render_type_debug_depth(vec3 diffuse_tex);
 
+int get_cluster_index();
+Light get_light(int index);
+
+mat4 get_shadow_view_matrix(int view);
+vec4 get_shadow_view_rect(int view);
+float sample_shadow_view(vec4 rect, vec2 uv);
+int get_cube_face(vec3 dir);
+vec2 get_paraboloid_uv(mat4 view_matrix, vec3 pos);
+vec2 get_projected_uv(mat4 light_space, vec3 pos);
+float filter_shadow_view(vec4 rect, vec2 uv, vec2 uv_dx, vec2 uv_dy, float depth);
+int get_shadow_view(Light light, float depth);
+
 float shadow_calculation_directional(Light light, float bias);
 float shadow_calculation_omni_directional(Light light, float bias, vec3 view_delta);
+float shadow_calculation_paraboloid(Light light, float bias);
 
-vec3 sample_offset_directions[20] = vec3[]
+// the cube corners come first, so a reduced number of taps still surrounds the fragment
+vec3 sample_offset_directions[PCF_OMNI_DIRECTIONAL_SAMPLES] = vec3[]
 (
    vec3( 1,  1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1,  1,  1), 
    vec3( 1,  1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1,  1, -1),
@@ -147,7 +153,23 @@ vec3 sample_offset_directions[20] = vec3[]
    vec3( 0,  1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0,  1, -1)
 );
 
+// screen space derivatives of the position, taken in uniform control flow for the mip level of filtered shadows
+vec3 frag_pos_dx;
+vec3 frag_pos_dy;
+
 void main() {
+	frag_pos_dx = dFdx(fs_in.frag_pos);
+	frag_pos_dy = dFdy(fs_in.frag_pos);
+	
+	// cut out before lighting, discard instead of writing the depth keeps the early depth test (and the depth pre-pass) working
+	float alpha = material.opacity;
+	if (material.has_alpha_tex) {
+		alpha = alpha * texture(material.alpha_tex, fs_in.tex_coords).r;
+	}
+	if (alpha < material.alpha_cutoff) {
+		discard;
+	}
+
 	vec3 diffuse_tex;
 	if (material.has_diffuse_tex) {
 		diffuse_tex = vec3(texture(material.diffuse_tex, fs_in.tex_coords));
@@ -169,14 +191,17 @@ void main() {
 	vec3 view_delta = view_pos - fs_in.frag_pos;
     vec3 view_dir = normalize(view_delta);
 	
-	for (int i = 0; i < num_lights; i++) {
+	// only the lights reaching the object or the cluster of this fragment
+	uvec2 cluster = object_light_count >= 0 ? uvec2(0u, uint(object_light_count)) : texelFetch(light_grid.clusters, get_cluster_index()).rg;
+	for (uint n = 0u; n < cluster.y; n++) {
+		Light light = get_light(object_light_count >= 0 ? object_lights[n] : int(texelFetch(light_grid.indices, int(cluster.x + n)).r));
 		float shadow = 0.0, bias = 0.0;
 		
 		vec3 add_color = vec3(0.0, 0.0, 0.0);
-		switch (lights[i].light_type) {
+		switch (light.light_type) {
 		case 1:
 			add_color = calc_dir_light(
-				lights[i], 
+				light, 
 				diffuse_tex, 
 				normal, 
 				view_dir,
@@ -185,7 +210,7 @@ void main() {
 			break;
 		case 2:
 			add_color = calc_point_light(
-				lights[i], 
+				light, 
 				diffuse_tex, 
 				normal, 
 				view_dir,
@@ -194,7 +219,7 @@ void main() {
 			break;
 		case 3:
 			add_color = calc_spot_light(
-				lights[i], 
+				light, 
 				diffuse_tex, 
 				normal, 
 				view_dir,
@@ -205,31 +230,143 @@ void main() {
 			color = vec3(0.0,1.0,0.0);
 		}
 		
-		if (lights[i].shadow_casting) {
-			switch (lights[i].light_type) {
+		if (light.shadow_casting) {
+			switch (light.shadow_projection) {
 			case 1:
-			case 3:
-				shadow = shadow_calculation_directional(lights[i], bias);
+				shadow = shadow_calculation_directional(light, bias);
 				break;
 			case 2:
-				shadow = shadow_calculation_omni_directional(lights[i], bias, view_delta);
+				shadow = shadow_calculation_omni_directional(light, bias, view_delta);
+				break;
+			case 3:
+				shadow = shadow_calculation_paraboloid(light, bias);
 				break;
 			}
 		}
 		
 		color += (1.0 - shadow)*add_color;
 	}
-	float alpha = material.opacity;
-	if (material.has_alpha_tex) {
-		alpha = alpha * texture(material.alpha_tex, fs_in.tex_coords).r;
+	FragColor = vec4(color, alpha);
+}
+
+int get_cluster_index() {
+	float depth = -(mvp.view * vec4(fs_in.frag_pos, 1.0)).z;
+	ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy / light_grid.tile_size), int(log(depth) * light_grid.depth_scale_bias.x + light_grid.depth_scale_bias.y));
+	cluster = clamp(cluster, ivec3(0), light_grid.size - 1);
+	return (cluster.z * light_grid.size.y + cluster.y) * light_grid.size.x + cluster.x;
+}
+
+Light get_light(int index) {
+	int texel = index * 8;
+	vec4 position_type = texelFetch(light_grid.lights, texel);
+	vec4 direction_range = texelFetch(light_grid.lights, texel + 1);
+	vec4 attenuation = texelFetch(light_grid.lights, texel + 2);
+	vec4 diffuse_cutoff = texelFetch(light_grid.lights, texel + 3);
+	vec4 specular_outer_cutoff = texelFetch(light_grid.lights, texel + 4);
+	vec4 shadow = texelFetch(light_grid.lights, texel + 5);
+	vec4 cascade_splits = texelFetch(light_grid.lights, texel + 7);
+
+	Light light;
+	light.light_type = int(position_type.w);
+	light.position = position_type.xyz;
+	light.direction = direction_range.xyz;
+	light.constant = attenuation.x;
+	light.linear = attenuation.y;
+	light.quadratic = attenuation.z;
+	light.diffuse = diffuse_cutoff.rgb;
+	light.specular = specular_outer_cutoff.rgb;
+	light.shadow_casting = attenuation.w >= 0.0;
+	light.shadow_view = int(attenuation.w);
+	light.min_bias = shadow.x;
+	light.max_bias = shadow.y;
+	light.cutoff = diffuse_cutoff.w;
+	light.outer_cutoff = specular_outer_cutoff.w;
+	light.far_plane = shadow.z;
+	light.shadow_projection = int(shadow.w);
+	light.cascade_splits = cascade_splits;
+	return light;
+}
+
+mat4 get_shadow_view_matrix(int view) {
+	int texel = view * 5;
+	return mat4(texelFetch(shadow_views, texel), texelFetch(shadow_views, texel + 1), texelFetch(shadow_views, texel + 2), texelFetch(shadow_views, texel + 3));
+}
+
+vec4 get_shadow_view_rect(int view) {
+	return texelFetch(shadow_views, view * 5 + 4);
+}
+
+// depth at uv of the region, nothing outside of it casts a shadow
+float sample_shadow_view(vec4 rect, vec2 uv) {
+	if (any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0)))) {
+		return 1.0;
 	}
-	if (alpha < material.alpha_cutoff) {
-		alpha = 0;
-		gl_FragDepth = 100;
-	} else {
-		gl_FragDepth = gl_FragCoord.z;
+	// half a texel inside, so the neighbouring regions never bleed in
+	vec2 half_texel = 0.5 / vec2(textureSize(shadow_atlas, 0));
+	return texture(shadow_atlas, clamp(rect.xy + uv * rect.zw, rect.xy + half_texel, rect.xy + rect.zw - half_texel)).r;
+}
+
+// view of a directional or spot light covering a position at the given view space depth, -1 beyond the last cascade
+int get_shadow_view(Light light, float depth) {
+	if (light.cascade_splits.x <= 0.0) {
+		return light.shadow_view;
 	}
-	FragColor = vec4(color, alpha);
+	// the first cascade reaching beyond the position has the highest resolution
+	int cascade = 0;
+	while (cascade < 4 && depth > light.cascade_splits[cascade]) {
+		cascade++;
+	}
+	return cascade < 4 ? light.shadow_view + cascade : -1;
+}
+
+// order of the views of a point light: +X, -X, +Y, -Y, +Z, -Z
+int get_cube_face(vec3 dir) {
+	vec3 a = abs(dir);
+	if (a.x >= a.y && a.x >= a.z) {
+		return dir.x > 0.0 ? 0 : 1;
+	}
+	if (a.y >= a.z) {
+		return dir.y > 0.0 ? 2 : 3;
+	}
+	return dir.z > 0.0 ? 4 : 5;
+}
+
+// position in the hemisphere looking along -z of view_matrix, the first view of a point light looks along its direction
+vec2 get_paraboloid_uv(mat4 view_matrix, vec3 pos) {
+	vec3 dir = normalize((view_matrix * vec4(pos, 1.0)).xyz);
+	return dir.xy / (1.0 - dir.z) * 0.5 + 0.5;
+}
+
+vec2 get_projected_uv(mat4 light_space, vec3 pos) {
+	vec4 pos_lightspace = light_space * vec4(pos, 1.0);
+	return pos_lightspace.xy / pos_lightspace.w * 0.5 + 0.5;
+}
+
+// Chebyshev's upper bound of the share of the filtered texels whose depth (mean and square in moments) is not in front of depth
+float get_chebyshev_visibility(vec2 moments, float depth) {
+	if (depth <= moments.x) {
+		return 1.0;
+	}
+	float variance = max(moments.y - moments.x * moments.x, 0.0001);
+	float delta = depth - moments.x;
+	float p_max = variance / (variance + delta * delta);
+	// the tail of the bound shows as light bleeding where casters overlap
+	return clamp((p_max - EVSM_BLEEDING_REDUCTION) / (1.0 - EVSM_BLEEDING_REDUCTION), 0.0, 1.0);
+}
+
+// share of the filtered footprint around uv of the region which is in shadow at depth, gradients in uv of the region
+float filter_shadow_view(vec4 rect, vec2 uv, vec2 uv_dx, vec2 uv_dy, float depth) {
+	if (any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0)))) {
+		return 0.0;
+	}
+	vec2 half_texel = 0.5 / vec2(textureSize(shadow_atlas, 0));
+	vec4 moments = textureGrad(shadow_atlas, clamp(rect.xy + uv * rect.zw, rect.xy + half_texel, rect.xy + rect.zw - half_texel), uv_dx * rect.zw, uv_dy * rect.zw);
+	
+	// the exponents of ShadowAtlas::filter(), positive and negative warp
+	float warped = depth * 2.0 - 1.0;
+	float positive = exp(EVSM_EXPONENT * warped);
+	float negative = -exp(-EVSM_EXPONENT * warped);
+	return 1.0 - min(get_chebyshev_visibility(moments.xy, positive), get_chebyshev_visibility(moments.zw, negative));
 }
 
 #define DEBUG_PERSPECTIVE_DEPTH
@@ -347,7 +484,12 @@ vec3 calc_spot_light(
 }
 
 float shadow_calculation_directional(Light light, float bias) {
-	vec4 frag_pos_lightspace = fs_in.frag_pos_lightspace[light.shadow_map_index];
+	int view = get_shadow_view(light, -(mvp.view * vec4(fs_in.frag_pos, 1.0)).z);
+	if (view < 0) {
+		return 0.0;
+	}
+	mat4 light_space = get_shadow_view_matrix(view);
+	vec4 frag_pos_lightspace = light_space * vec4(fs_in.frag_pos, 1.0);
 	
     // perform perspective divide
     vec3 proj_coords = frag_pos_lightspace.xyz / frag_pos_lightspace.w;
@@ -361,20 +503,25 @@ float shadow_calculation_directional(Light light, float bias) {
 	float current_depth = proj_coords.z - bias;
 	
 	float shadow = 0.0;
-	vec2 texel_size;
-	DIRECTIONAL_SHADOW_MAP(textureSize, light.shadow_map_index, 0, texel_size)
-	texel_size = 1.0 / texel_size;
+	vec4 rect = get_shadow_view_rect(view);
+	if (shadow_filtered) {
+		// one trilinear fetch replaces the kernel
+		vec2 uv_dx = get_projected_uv(light_space, fs_in.frag_pos + frag_pos_dx) - proj_coords.xy;
+		vec2 uv_dy = get_projected_uv(light_space, fs_in.frag_pos + frag_pos_dy) - proj_coords.xy;
+		return filter_shadow_view(rect, proj_coords.xy, uv_dx, uv_dy, current_depth);
+	}
+	vec2 texel_size = 1.0 / (rect.zw * vec2(textureSize(shadow_atlas, 0)));
 	
-	for(int x = -PCF_COUNT; x <= PCF_COUNT; ++x) {
-		for(int y = -PCF_COUNT; y <= PCF_COUNT; ++y) {
+	for(int x = -shadow_pcf_radius; x <= shadow_pcf_radius; ++x) {
+		for(int y = -shadow_pcf_radius; y <= shadow_pcf_radius; ++y) {
 			// get closest depth value from light's perspective (using [0,1] range fragPosLight as coords)
-			vec4 closest_depth;
-			DIRECTIONAL_SHADOW_MAP(texture, light.shadow_map_index, (proj_coords.xy + vec2(x, y) * texel_size), closest_depth)
+			float closest_depth = sample_shadow_view(rect, proj_coords.xy + vec2(x, y) * texel_size);
 			
-			shadow += current_depth - bias > closest_depth.r ? 1.0 : 0.0;        
+			shadow += current_depth - bias > closest_depth ? 1.0 : 0.0;        
 		}    
 	}
-	return shadow / PCF_TOTAL_SAMPLES;
+	int kernel_size = 2 * shadow_pcf_radius + 1;
+	return shadow / float(kernel_size * kernel_size);
 	
 }
 
@@ -385,21 +532,73 @@ float shadow_calculation_omni_directional(Light light, float bias, vec3 view_del
     // now get current linear depth as the length between the fragment and light position
     float current_depth = length(frag_to_light);
 	
+	if (shadow_filtered) {
+		int view = light.shadow_view + get_cube_face(frag_to_light);
+		mat4 light_space = get_shadow_view_matrix(view);
+		vec2 uv = get_projected_uv(light_space, fs_in.frag_pos);
+		vec2 uv_dx = get_projected_uv(light_space, fs_in.frag_pos + frag_pos_dx) - uv;
+		vec2 uv_dy = get_projected_uv(light_space, fs_in.frag_pos + frag_pos_dy) - uv;
+		return filter_shadow_view(get_shadow_view_rect(view), uv, uv_dx, uv_dy, (current_depth - bias) / light.far_plane);
+	}
+	
     // test for shadows
 	float shadow = 0.0;
 	float view_distance = length(view_pos - fs_in.frag_pos);
 	float disk_radius = (1.0 + (view_distance / light.far_plane)) / 20.0;
-	for(int i = 0; i < PCF_OMNI_DIRECTIONAL_SAMPLES; ++i) {
-		 // fragment to light vector to sample from the depth map    
-		vec4 closest_depth;
-		OMNI_DIRECTIONAL_SHADOW_MAP(texture, light.shadow_map_index, (frag_to_light + sample_offset_directions[i] * disk_radius), closest_depth)
-
+	int face = -1;
+	mat4 face_matrix;
+	vec4 face_rect;
+	for(int i = 0; i < shadow_pcf_omni_samples; ++i) {
+		// fragment to light vector to sample from the depth map, every cube face is an own view of the atlas
+		vec3 sample_dir = frag_to_light + sample_offset_directions[i] * disk_radius;
+		int sample_face = get_cube_face(sample_dir);
+		if (sample_face != face) {
+			face = sample_face;
+			face_matrix = get_shadow_view_matrix(light.shadow_view + face);
+			face_rect = get_shadow_view_rect(light.shadow_view + face);
+		}
+		vec4 sample_pos = face_matrix * vec4(light.position + sample_dir, 1.0);
+		
 		// it is currently in linear range between [0,1], let's re-transform it back to original depth value
-		closest_depth.r *= light.far_plane;
+		float closest_depth = sample_shadow_view(face_rect, sample_pos.xy / sample_pos.w * 0.5 + 0.5) * light.far_plane;
 		
-		if(current_depth - bias	> closest_depth.r) {
+		if(current_depth - bias	> closest_depth) {
 			shadow += 1.0;
 		}
 	}
-	return shadow / float(PCF_OMNI_DIRECTIONAL_SAMPLES);
+	return shadow / float(shadow_pcf_omni_samples);
 }
+
+float shadow_calculation_paraboloid(Light light, float bias) {
+	vec3 frag_to_light = fs_in.frag_pos - light.position;
+	float current_depth = length(frag_to_light);
+	
+	// both hemispheres are views of the atlas, the samples near the seam may fall into either
+	mat4 front_matrix = get_shadow_view_matrix(light.shadow_view);
+	mat4 back_matrix = get_shadow_view_matrix(light.shadow_view + 1);
+	vec4 front_rect = get_shadow_view_rect(light.shadow_view);
+	vec4 back_rect = get_shadow_view_rect(light.shadow_view + 1);
+	
+	if (shadow_filtered) {
+		bool front = (front_matrix * vec4(fs_in.frag_pos, 1.0)).z <= 0.0;
+		mat4 view_matrix = front ? front_matrix : back_matrix;
+		vec2 uv = get_paraboloid_uv(view_matrix, fs_in.frag_pos);
+		vec2 uv_dx = get_paraboloid_uv(view_matrix, fs_in.frag_pos + frag_pos_dx) - uv;
+		vec2 uv_dy = get_paraboloid_uv(view_matrix, fs_in.frag_pos + frag_pos_dy) - uv;
+		return filter_shadow_view(front ? front_rect : back_rect, uv, uv_dx, uv_dy, (current_depth - bias) / light.far_plane);
+	}
+	
+	float shadow = 0.0;
+	float view_distance = length(view_pos - fs_in.frag_pos);
+	float disk_radius = (1.0 + (view_distance / light.far_plane)) / 20.0;
+	for(int i = 0; i < shadow_pcf_omni_samples; ++i) {
+		vec3 sample_pos = fs_in.frag_pos + sample_offset_directions[i] * disk_radius;
+		bool front = (front_matrix * vec4(sample_pos, 1.0)).z <= 0.0;
+		float closest_depth = sample_shadow_view(front ? front_rect : back_rect, get_paraboloid_uv(front ? front_matrix : back_matrix, sample_pos)) * light.far_plane;
+		
+		if(current_depth - bias > closest_depth) {
+			shadow += 1.0;
+		}
+	}
+	return shadow / float(shadow_pcf_omni_samples);
+}
\ No newline at end of file
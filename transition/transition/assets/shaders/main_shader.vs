@@ -1,22 +1,18 @@
 #version 330 core
-#define MAX_NR_DIRECTIONAL_SHADOWS (5)
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTex;
-layout (location = 2) in vec3 aNormal;
+layout (location = 2) in vec2 aNormal;	//octahedral encoded
+layout (location = 3) in mat4 aInstanceModel;
+layout (location = 7) in mat4 aInstanceModelNormal;
 
 out VS_OUT {
     vec3 frag_pos;
     vec3 normal;
     vec2 tex_coords;
-    vec4 frag_pos_lightspace[MAX_NR_DIRECTIONAL_SHADOWS];
 } vs_out;
 
 
-uniform mat4 light_space_matrices[MAX_NR_DIRECTIONAL_SHADOWS];
-uniform mat4 light_view_matrices[MAX_NR_DIRECTIONAL_SHADOWS];
-uniform int num_lights;
-
 struct MVP {
 	mat4 model;
 	mat4 view;
@@ -26,16 +22,28 @@ struct MVP {
 };
 
 uniform MVP mvp;
+uniform bool instanced;
+
+//the depth pre-pass (depth_prepass.vs) computes the same position, so its depth can be tested with GL_EQUAL
+invariant gl_Position;
+
+vec3 decode_octahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (n.z < 0) {
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0 ? 1.0 : -1.0, n.y >= 0 ? 1.0 : -1.0);
+	}
+	return normalize(n);
+}
 
 void main()
 {
-	vs_out.frag_pos = vec3(mvp.model * vec4(aPos, 1.0));
-	vs_out.normal = mvp.model_normal*aNormal;
+	mat4 model = instanced ? aInstanceModel : mvp.model;
+	mat3 model_normal = instanced ? mat3(aInstanceModelNormal) : mvp.model_normal;
+
+	vs_out.frag_pos = vec3(model * vec4(aPos, 1.0));
+	vs_out.normal = model_normal*decode_octahedral(aNormal);
 	vs_out.tex_coords = aTex;
 	
-	for (int i = 0; i < MAX_NR_DIRECTIONAL_SHADOWS; i++) {
-		vs_out.frag_pos_lightspace[i] = light_space_matrices[i] * vec4(vs_out.frag_pos, 1.0);
-	}
-	
 	gl_Position = mvp.projection * mvp.view * vec4(vs_out.frag_pos, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,48 @@
+#version 330 core
+// Exponential variance shadow map moments of a shadow atlas region, see ShadowAtlas::filter()
+out vec4 FragColor;
+in vec2 TexCoords;
+
+uniform sampler2D image;
+uniform bool horizontal;		// the horizontal pass reads depth at twice the resolution, the vertical pass moments
+uniform ivec2 source_offset;	// first texel of the region in image
+uniform int source_size;		// side length of the region in image
+uniform ivec2 target_offset;	// first texel of the region in the render target
+
+// the largest exponent whose squared moments fit into 16 bit floats, matches EVSM_EXPONENT of the lighting shaders
+#define EVSM_EXPONENT (5.54)
+
+const float weights[5] = float[] (0.0625, 0.25, 0.375, 0.25, 0.0625);
+
+vec4 get_moments(float depth) {
+	float warped = depth * 2.0 - 1.0;
+	float positive = exp(EVSM_EXPONENT * warped);
+	float negative = -exp(-EVSM_EXPONENT * warped);
+	return vec4(positive, positive * positive, negative, negative * negative);
+}
+
+// moments of the 2x2 depth texels below a texel of the half resolution, the depth itself must not be averaged
+vec4 get_downsampled_moments(ivec2 texel) {
+	ivec2 first = source_offset + clamp(texel * 2, ivec2(0), ivec2(source_size - 2));
+	return 0.25 * (
+		get_moments(texelFetch(image, first, 0).r) +
+		get_moments(texelFetch(image, first + ivec2(1, 0), 0).r) +
+		get_moments(texelFetch(image, first + ivec2(0, 1), 0).r) +
+		get_moments(texelFetch(image, first + ivec2(1, 1), 0).r));
+}
+
+void main()
+{
+	ivec2 texel = ivec2(gl_FragCoord.xy) - target_offset;
+	vec4 result = vec4(0.0);
+	for (int i = -2; i <= 2; i++) {
+		if (horizontal) {
+			result += weights[i + 2] * get_downsampled_moments(texel + ivec2(i, 0));
+		}
+		else {
+			// taps outside the region repeat its border
+			result += weights[i + 2] * texelFetch(image, source_offset + clamp(texel + ivec2(0, i), ivec2(0), ivec2(source_size - 1)), 0);
+		}
+	}
+	FragColor = result;
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#version 330 core
+//Source: AMD FidelityFX Contrast Adaptive Sharpening (CAS), cross shaped variant
+out vec4 FragColor;
+in vec2 TexCoords;
+
+uniform sampler2D image;
+uniform float sharpness;	//0 to 1
+
+vec3 fetch(ivec2 offset)
+{
+	ivec2 last = textureSize(image, 0) - 1;
+	return texelFetch(image, clamp(ivec2(gl_FragCoord.xy) + offset, ivec2(0), last), 0).rgb;
+}
+
+void main()
+{
+	vec3 b = fetch(ivec2(0, -1));
+	vec3 d = fetch(ivec2(-1, 0));
+	vec3 e = fetch(ivec2(0, 0));
+	vec3 f = fetch(ivec2(1, 0));
+	vec3 h = fetch(ivec2(0, 1));
+
+	vec3 min_color = min(min(min(b, d), min(f, h)), e);
+	vec3 max_color = max(max(max(b, d), max(f, h)), e);
+
+	// less sharpening where the local contrast is already high, so edges do not ring
+	vec3 amplitude = sqrt(clamp(min(min_color, 2.0 - max_color) / max(max_color, vec3(0.0001)), 0.0, 1.0));
+	vec3 weight = amplitude * (-1.0 / mix(8.0, 5.0, sharpness));
+
+	vec3 result = ((b + d + f + h) * weight + e) / (1.0 + 4.0 * weight);
+	FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,49 @@
+#version 330 core
+//Source: Catmull-Rom in 9 bilinear taps, http://vec3.ca/bicubic-filtering-in-fewer-taps/
+out vec4 FragColor;
+in vec2 TexCoords;
+
+uniform sampler2D image;
+
+void main()
+{
+	vec2 size = textureSize(image, 0);
+	vec2 position = TexCoords * size;
+	vec2 center = floor(position - 0.5) + 0.5;
+	vec2 f = position - center;
+
+	// Catmull-Rom weights of the 4x4 texels around the position
+	vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+	vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+	vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+	vec2 w3 = f * f * (-0.5 + 0.5 * f);
+
+	// the two middle texels of each axis are fetched with one bilinear tap
+	vec2 w12 = w1 + w2;
+	vec2 uv0 = (center - 1.0) / size;
+	vec2 uv12 = (center + w2 / w12) / size;
+	vec2 uv3 = (center + 2.0) / size;
+
+	vec3 result = vec3(0.0);
+	result += textureLod(image, vec2(uv0.x, uv0.y), 0).rgb * w0.x * w0.y;
+	result += textureLod(image, vec2(uv12.x, uv0.y), 0).rgb * w12.x * w0.y;
+	result += textureLod(image, vec2(uv3.x, uv0.y), 0).rgb * w3.x * w0.y;
+	result += textureLod(image, vec2(uv0.x, uv12.y), 0).rgb * w0.x * w12.y;
+	result += textureLod(image, vec2(uv12.x, uv12.y), 0).rgb * w12.x * w12.y;
+	result += textureLod(image, vec2(uv3.x, uv12.y), 0).rgb * w3.x * w12.y;
+	result += textureLod(image, vec2(uv0.x, uv3.y), 0).rgb * w0.x * w3.y;
+	result += textureLod(image, vec2(uv12.x, uv3.y), 0).rgb * w12.x * w3.y;
+	result += textureLod(image, vec2(uv3.x, uv3.y), 0).rgb * w3.x * w3.y;
+
+	// the negative lobes overshoot at edges, keeping the result within the 2x2 nearest texels adapts the
+	// filter to them: smooth areas get the full bicubic, edges stay crisp without halos
+	ivec2 texel = ivec2(center - 0.5);
+	ivec2 last = ivec2(size) - 1;
+	vec3 a = texelFetch(image, clamp(texel, ivec2(0), last), 0).rgb;
+	vec3 b = texelFetch(image, clamp(texel + ivec2(1, 0), ivec2(0), last), 0).rgb;
+	vec3 c = texelFetch(image, clamp(texel + ivec2(0, 1), ivec2(0), last), 0).rgb;
+	vec3 d = texelFetch(image, clamp(texel + ivec2(1, 1), ivec2(0), last), 0).rgb;
+	result = clamp(result, min(min(a, b), min(c, d)), max(max(a, b), max(c, d)));
+
+	FragColor = vec4(result, 1.0);
+}
@@ -1,8 +1,6 @@
 #version 330 core
-
-#define MAX_NR_LIGHTS (10)
-#define MAX_NR_DIRECTIONAL_SHADOWS (5)
-#define MAX_NR_OMNI_DIRECTIONAL_SHADOWS (5)
+#define EVSM_EXPONENT (5.54)
+#define EVSM_BLEEDING_REDUCTION (0.2)
 
 in VS_OUT {
 	vec2 tex_coords;
@@ -25,7 +23,7 @@ struct Light {
   
     vec3 diffuse;
 	
-	int shadow_map_index;
+	int shadow_view;	// first view in the shadow atlas, negative without shadow map
 	float bias;
 	
 	// Spotlight
@@ -34,46 +32,30 @@ struct Light {
 	
 	// point light
 	float far_plane;
-	float near_plane;
+	int shadow_projection;	// 2: cube faces, 3: paraboloid hemispheres
 	
 	// volumetric parameters
 	float phi;
 	float tau;
 	bool has_fog;
 	int num_samples;
+	
+	// cascaded directional light, view space depth at which each cascade ends
+	vec4 cascade_splits;
+};
+// the shadow maps of all lights are regions of one atlas, see ShadowAtlas
+uniform sampler2D shadow_atlas;
+uniform samplerBuffer shadow_views;	// 5 texels per view: light space matrix, rectangle of the region in the atlas
+uniform bool shadow_filtered;		// the atlas holds blurred and mipmapped EVSM moments instead of depth
+
+// clustered lights, see LightGrid, the entry after the last cluster lists the volumetric lights
+struct LightGrid {
+	usamplerBuffer clusters;
+	usamplerBuffer indices;
+	samplerBuffer lights;		// 8 texels per light
+	ivec3 size;
 };
-uniform Light lights[MAX_NR_LIGHTS];
-uniform sampler2D directional_shadow_maps[MAX_NR_DIRECTIONAL_SHADOWS];
-uniform samplerCube omni_directional_shadow_maps[MAX_NR_OMNI_DIRECTIONAL_SHADOWS];
-uniform int num_lights;
-uniform mat4 light_view_matrices[MAX_NR_DIRECTIONAL_SHADOWS];
-uniform mat4 light_projection_matrices[MAX_NR_DIRECTIONAL_SHADOWS];
-
-#define DIRECTIONAL_SHADOW_MAP(A,B,C,X) \
-	if (B == 0) { \
-		X = A(directional_shadow_maps[0], C); \
-	} else if (B == 1) { \
-		X = A(directional_shadow_maps[1], C); \
-	} else if (B == 2) { \
-		X = A(directional_shadow_maps[2], C); \
-	} else if (B == 3) { \
-		X = A(directional_shadow_maps[3], C); \
-	} else if (B == 4) { \
-		X = A(directional_shadow_maps[4], C); \
-	} 
-
-#define OMNI_DIRECTIONAL_SHADOW_MAP(A,B,C,X) \
-	if (B == 0) { \
-		X = A(omni_directional_shadow_maps[0], C); \
-	} else if (B == 1) { \
-		X = A(omni_directional_shadow_maps[1], C); \
-	} else if (B == 2) { \
-		X = A(omni_directional_shadow_maps[2], C); \
-	} else if (B == 3) { \
-		X = A(omni_directional_shadow_maps[3], C); \
-	} else if (B == 4) { \
-		X = A(omni_directional_shadow_maps[4], C); \
-	} 
+uniform LightGrid light_grid;
 
 struct VP {
 	mat4 view_inv;
@@ -93,6 +75,17 @@ float sample_fog(vec3 pos);
 
 vec3 world_pos_from_depth(float depth);
 
+Light get_light(int index);
+
+mat4 get_shadow_view_matrix(int view);
+vec4 get_shadow_view_rect(int view);
+float sample_shadow_view(vec4 rect, vec2 uv);
+float get_shadow_visibility(vec4 rect, vec2 uv, float depth);
+int get_cube_face(vec3 dir);
+vec2 get_paraboloid_uv(mat4 view_matrix, vec3 pos);
+int get_shadow_view(Light light, float depth);
+float sample_shadow_term(Light light, vec4 rect, vec4 ray_position_lightspace);
+
 void main() {
 	vec3 vol_color = vec3(0);
 	
@@ -104,16 +97,18 @@ void main() {
 	
 	vec3 frag_pos = world_pos_from_depth(depth);
 	
-	for (int i = 0; i < num_lights; i++) {
-		switch (lights[i].light_type) {
+	uvec2 volumetric_lights = texelFetch(light_grid.clusters, light_grid.size.x * light_grid.size.y * light_grid.size.z).rg;
+	for (uint n = 0u; n < volumetric_lights.y; n++) {
+		Light light = get_light(int(texelFetch(light_grid.indices, int(volumetric_lights.x + n)).r));
+		switch (light.light_type) {
 			case 1: // directional light
-				vol_color += volumetric_lighting_directional(frag_pos, lights[i])*lights[i].diffuse;
+				vol_color += volumetric_lighting_directional(frag_pos, light)*light.diffuse;
 				break;
 			case 2: // point light
-				vol_color += volumetric_lighting_pointlight(frag_pos, lights[i])*lights[i].diffuse;
+				vol_color += volumetric_lighting_pointlight(frag_pos, light)*light.diffuse;
 				break;
 			case 3: // spot light
-				vol_color += volumetric_lighting_spotlight(frag_pos, lights[i])*lights[i].diffuse;
+				vol_color += volumetric_lighting_spotlight(frag_pos, light)*light.diffuse;
 				break;
 		}
 	}
@@ -134,6 +129,131 @@ vec3 world_pos_from_depth(float depth) {
     return world_space_position.xyz;
 }
 
+Light get_light(int index) {
+	int texel = index * 8;
+	vec4 position_type = texelFetch(light_grid.lights, texel);
+	vec4 direction_range = texelFetch(light_grid.lights, texel + 1);
+	vec4 attenuation = texelFetch(light_grid.lights, texel + 2);
+	vec4 diffuse_cutoff = texelFetch(light_grid.lights, texel + 3);
+	vec4 specular_outer_cutoff = texelFetch(light_grid.lights, texel + 4);
+	vec4 shadow = texelFetch(light_grid.lights, texel + 5);
+	vec4 volumetric = texelFetch(light_grid.lights, texel + 6);
+	vec4 cascade_splits = texelFetch(light_grid.lights, texel + 7);
+
+	Light light;
+	light.light_type = int(position_type.w);
+	light.position = position_type.xyz;
+	light.direction = direction_range.xyz;
+	light.constant = attenuation.x;
+	light.linear = attenuation.y;
+	light.quadratic = attenuation.z;
+	light.diffuse = diffuse_cutoff.rgb;
+	light.shadow_view = int(attenuation.w);
+	light.bias = shadow.x;
+	light.cutoff = diffuse_cutoff.w;
+	light.outer_cutoff = specular_outer_cutoff.w;
+	light.far_plane = shadow.z;
+	light.shadow_projection = int(shadow.w);
+	light.phi = volumetric.x;
+	light.tau = volumetric.y;
+	light.has_fog = volumetric.z > 0.0;
+	light.num_samples = int(volumetric.w);
+	light.cascade_splits = cascade_splits;
+	return light;
+}
+
+mat4 get_shadow_view_matrix(int view) {
+	int texel = view * 5;
+	return mat4(texelFetch(shadow_views, texel), texelFetch(shadow_views, texel + 1), texelFetch(shadow_views, texel + 2), texelFetch(shadow_views, texel + 3));
+}
+
+vec4 get_shadow_view_rect(int view) {
+	return texelFetch(shadow_views, view * 5 + 4);
+}
+
+// depth at uv of the region, nothing outside of it casts a shadow
+float sample_shadow_view(vec4 rect, vec2 uv) {
+	if (any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0)))) {
+		return 1.0;
+	}
+	// half a texel inside, so the neighbouring regions never bleed in
+	vec2 half_texel = 0.5 / vec2(textureSize(shadow_atlas, 0));
+	return texture(shadow_atlas, clamp(rect.xy + uv * rect.zw, rect.xy + half_texel, rect.xy + rect.zw - half_texel)).r;
+}
+
+// view of a directional or spot light covering a position at the given view space depth, -1 without one
+int get_shadow_view(Light light, float depth) {
+	if (light.shadow_view < 0 || light.cascade_splits.x <= 0.0) {
+		return light.shadow_view;
+	}
+	// the first cascade reaching beyond the position has the highest resolution
+	int cascade = 0;
+	while (cascade < 4 && depth > light.cascade_splits[cascade]) {
+		cascade++;
+	}
+	return cascade < 4 ? light.shadow_view + cascade : -1;
+}
+
+// order of the views of a point light: +X, -X, +Y, -Y, +Z, -Z
+int get_cube_face(vec3 dir) {
+	vec3 a = abs(dir);
+	if (a.x >= a.y && a.x >= a.z) {
+		return dir.x > 0.0 ? 0 : 1;
+	}
+	if (a.y >= a.z) {
+		return dir.y > 0.0 ? 2 : 3;
+	}
+	return dir.z > 0.0 ? 4 : 5;
+}
+
+// position in the hemisphere looking along -z of view_matrix, the first view of a point light looks along its direction
+vec2 get_paraboloid_uv(mat4 view_matrix, vec3 pos) {
+	vec3 dir = normalize((view_matrix * vec4(pos, 1.0)).xyz);
+	return dir.xy / (1.0 - dir.z) * 0.5 + 0.5;
+}
+
+// Chebyshev's upper bound of the share of the filtered texels whose depth (mean and square in moments) is not in front of depth
+float get_chebyshev_visibility(vec2 moments, float depth) {
+	if (depth <= moments.x) {
+		return 1.0;
+	}
+	float variance = max(moments.y - moments.x * moments.x, 0.0001);
+	float delta = depth - moments.x;
+	float p_max = variance / (variance + delta * delta);
+	// the tail of the bound shows as light bleeding where casters overlap
+	return clamp((p_max - EVSM_BLEEDING_REDUCTION) / (1.0 - EVSM_BLEEDING_REDUCTION), 0.0, 1.0);
+}
+
+// 0 if depth at uv of the region is in shadow, a fraction at the soft edges of filtered shadows
+float get_shadow_visibility(vec4 rect, vec2 uv, float depth) {
+	if (!shadow_filtered) {
+		return depth > sample_shadow_view(rect, uv) ? 0.0 : 1.0;
+	}
+	if (any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0)))) {
+		return 1.0;
+	}
+	// the ray march is blurred afterwards, the finest level is enough
+	vec2 half_texel = 0.5 / vec2(textureSize(shadow_atlas, 0));
+	vec4 moments = textureLod(shadow_atlas, clamp(rect.xy + uv * rect.zw, rect.xy + half_texel, rect.xy + rect.zw - half_texel), 0.0);
+	
+	// the exponents of ShadowAtlas::filter(), positive and negative warp
+	float warped = depth * 2.0 - 1.0;
+	float positive = exp(EVSM_EXPONENT * warped);
+	float negative = -exp(-EVSM_EXPONENT * warped);
+	return min(get_chebyshev_visibility(moments.xy, positive), get_chebyshev_visibility(moments.zw, negative));
+}
+
+// 0 if the ray position (in the light space of the view with the given rectangle) is in shadow
+float sample_shadow_term(Light light, vec4 rect, vec4 ray_position_lightspace) {
+	// perform perspective divide
+	vec3 proj_coords = ray_position_lightspace.xyz / ray_position_lightspace.w;
+	
+	// transform to [0,1] range
+	proj_coords = proj_coords * 0.5 + 0.5;
+	
+	return get_shadow_visibility(rect, proj_coords.xy, proj_coords.z - light.bias);
+}
+
 float dither_pattern[16] = float[16] (
 	0.0f, 0.5f, 0.125f, 0.625f,
 	0.75f, 0.22f, 0.875f, 0.375f,
@@ -150,37 +270,27 @@ float volumetric_lighting_directional(vec3 frag_pos, Light light) {
 	vec4 start_pos_worldspace = vec4(frag_pos, 1.0);
 	vec4 delta_worldspace = normalize(end_pos_worldspace - start_pos_worldspace);
 	
-	vec4 end_pos_lightview = light_view_matrices[light.shadow_map_index] * end_pos_worldspace;
-	vec4 start_pos_lightview = light_view_matrices[light.shadow_map_index] * start_pos_worldspace;
-	vec4 delta_lightview = normalize(end_pos_lightview - start_pos_lightview);
-	
-	float raymarch_distance_lightview = length(end_pos_lightview - start_pos_lightview);
-	float step_size_lightview = raymarch_distance_lightview / light.num_samples;
-	
 	float raymarch_distance_worldspace = length(end_pos_worldspace - start_pos_worldspace);
 	float step_size_worldspace = raymarch_distance_worldspace / light.num_samples;
 	
-	vec4 ray_position_lightview = start_pos_lightview + dither_value*step_size_lightview * delta_lightview;
 	vec4 ray_position_worldspace = start_pos_worldspace + dither_value*step_size_worldspace * delta_worldspace;
 	
+	// cascades change along the ray, the view is only fetched again when it does
+	vec3 camera_forward = -vp.view_inv[2].xyz;
+	int view = -2;
+	mat4 light_space;
+	vec4 rect;
 	float light_contribution = 0.0;
 	for (float l = raymarch_distance_worldspace; l > step_size_worldspace; l -= step_size_worldspace) {
-		vec4 ray_position_lightspace = light_projection_matrices[light.shadow_map_index] * vec4(ray_position_lightview.xyz, 1);
-		// perform perspective divide            
-		vec3 proj_coords = ray_position_lightspace.xyz / ray_position_lightspace.w;
-		
-		// transform to [0,1] range
-		proj_coords = proj_coords * 0.5 + 0.5;		
-		
-		// get closest depth value from light's perspective (using [0,1] range fragPosLight as coords)
-		vec4 closest_depth;
-		DIRECTIONAL_SHADOW_MAP(texture, light.shadow_map_index, proj_coords.xy, closest_depth)
-		
-		float shadow_term = 1.0;
-		
-		if (proj_coords.z - light.bias > closest_depth.r) {
-			shadow_term = 0.0;
+		int sample_view = get_shadow_view(light, dot(ray_position_worldspace.xyz - view_pos, camera_forward));
+		if (sample_view != view) {
+			view = sample_view;
+			if (view >= 0) {
+				light_space = get_shadow_view_matrix(view);
+				rect = get_shadow_view_rect(view);
+			}
 		}
+		float shadow_term = view >= 0 ? sample_shadow_term(light, rect, light_space * ray_position_worldspace) : 1.0;
 		
 		float d = length(ray_position_worldspace.xyz - light.position);
 		float d_rcp = 1.0/d;
@@ -189,7 +299,6 @@ float volumetric_lighting_directional(vec3 frag_pos, Light light) {
 		
 		light_contribution += fog * light.tau * (shadow_term * (light.phi * 0.25 * PI_RCP) * d_rcp * d_rcp ) * exp(-d*light.tau)*exp(-l*light.tau) * step_size_worldspace;
 	
-		ray_position_lightview += step_size_lightview * delta_lightview;
 		ray_position_worldspace += step_size_worldspace * delta_worldspace;
 	}
 	
@@ -203,38 +312,28 @@ float volumetric_lighting_spotlight(vec3 frag_pos, Light light) {
 	vec4 start_pos_worldspace = vec4(frag_pos, 1.0);
 	vec4 delta_worldspace = normalize(end_pos_worldspace - start_pos_worldspace);
 	
-	vec4 end_pos_lightview = light_view_matrices[light.shadow_map_index] * end_pos_worldspace;
-	vec4 start_pos_lightview = light_view_matrices[light.shadow_map_index] * start_pos_worldspace;
-	vec4 delta_lightview = normalize(end_pos_lightview - start_pos_lightview);
-	
-	float raymarch_distance_lightview = length(end_pos_lightview - start_pos_lightview);
-	float step_size_lightview = raymarch_distance_lightview / light.num_samples;
-	
 	float raymarch_distance_worldspace = length(end_pos_worldspace - start_pos_worldspace);
 	float step_size_worldspace = raymarch_distance_worldspace / light.num_samples;
 	
-	vec4 ray_position_lightview = start_pos_lightview + dither_value*step_size_lightview * delta_lightview;
 	vec4 ray_position_worldspace = start_pos_worldspace + dither_value*step_size_worldspace * delta_worldspace;
 	
+	// cascades change along the ray, the view is only fetched again when it does
+	vec3 camera_forward = -vp.view_inv[2].xyz;
+	int view = -2;
+	mat4 light_space;
+	vec4 rect;
 	float light_contribution = 0.0;
 	float epsilon = (light.cutoff - light.outer_cutoff);
 	for (float l = raymarch_distance_worldspace; l > step_size_worldspace; l -= step_size_worldspace) {
-		vec4 ray_position_lightspace = light_projection_matrices[light.shadow_map_index] * vec4(ray_position_lightview.xyz, 1);
-		// perform perspective divide            
-		vec3 proj_coords = ray_position_lightspace.xyz / ray_position_lightspace.w;
-		
-		// transform to [0,1] range
-		proj_coords = proj_coords * 0.5 + 0.5;		
-		
-		// get closest depth value from light's perspective (using [0,1] range fragPosLight as coords)
-		vec4 closest_depth;
-		DIRECTIONAL_SHADOW_MAP(texture, light.shadow_map_index, proj_coords.xy, closest_depth)
-		
-		float shadow_term = 1.0;
-		
-		if (proj_coords.z - light.bias > closest_depth.r) {
-			shadow_term = 0.0;
+		int sample_view = get_shadow_view(light, dot(ray_position_worldspace.xyz - view_pos, camera_forward));
+		if (sample_view != view) {
+			view = sample_view;
+			if (view >= 0) {
+				light_space = get_shadow_view_matrix(view);
+				rect = get_shadow_view_rect(view);
+			}
 		}
+		float shadow_term = view >= 0 ? sample_shadow_term(light, rect, light_space * ray_position_worldspace) : 1.0;
 		
 		float d = length(ray_position_worldspace.xyz - light.position);
 		float d_rcp = 1.0/d;
@@ -252,7 +351,6 @@ float volumetric_lighting_spotlight(vec3 frag_pos, Light light) {
 		
 		light_contribution += fog * intensity * light.tau * (shadow_term * (light.phi * 0.25 * PI_RCP) * d_rcp * d_rcp ) * exp(-d*light.tau)*exp(-l*light.tau) * step_size_worldspace;
 	
-		ray_position_lightview += step_size_lightview * delta_lightview;
 		ray_position_worldspace += step_size_worldspace * delta_worldspace;
 	}
 	
@@ -271,18 +369,32 @@ float volumetric_lighting_pointlight(vec3 frag_pos, Light light) {
 		
 	vec4 ray_position_worldspace = start_pos_worldspace + dither_value * step_size_worldspace * delta_worldspace;
 	
+	// the hemispheres of a paraboloid shadow map are the same for every sample
+	mat4 front_matrix, back_matrix;
+	if (light.shadow_view >= 0 && light.shadow_projection == 3) {
+		front_matrix = get_shadow_view_matrix(light.shadow_view);
+		back_matrix = get_shadow_view_matrix(light.shadow_view + 1);
+	}
+	
 	float light_contribution = 0.0;
 	for (float l = raymarch_distance_worldspace; l > step_size_worldspace; l -= step_size_worldspace) {
 		vec3 light_delta = ray_position_worldspace.xyz - light.position;
 		float distance   = length(light_delta);
 		
-		vec4 closest_depth;
-		OMNI_DIRECTIONAL_SHADOW_MAP(texture, light.shadow_map_index, light_delta, closest_depth)
-		closest_depth.r *= light.far_plane;
-		
 		float shadow_term = 1.0;
-		if (distance  - light.bias > closest_depth.r) {
-			shadow_term = 0.0;
+		if (light.shadow_view >= 0) {
+			// the maps store the distance to the light divided by the far plane
+			float depth = (distance - light.bias) / light.far_plane;
+			if (light.shadow_projection == 3) {
+				int hemisphere = (front_matrix * ray_position_worldspace).z <= 0.0 ? 0 : 1;
+				shadow_term = get_shadow_visibility(get_shadow_view_rect(light.shadow_view + hemisphere), get_paraboloid_uv(hemisphere == 0 ? front_matrix : back_matrix, ray_position_worldspace.xyz), depth);
+			}
+			else {
+				// every cube face is an own view of the atlas
+				int face = get_cube_face(light_delta);
+				vec4 sample_pos = get_shadow_view_matrix(light.shadow_view + face) * ray_position_worldspace;
+				shadow_term = get_shadow_visibility(get_shadow_view_rect(light.shadow_view + face), sample_pos.xy / sample_pos.w * 0.5 + 0.5, depth);
+			}
 		}
 		
 		float d_rcp = 1.0/distance;
@@ -1,4 +1,4 @@
-// transition.cpp : Definiert den Einstiegspunkt fr die Konsolenanwendung.
+// transition.cpp : Definiert den Einstiegspunkt für die Konsolenanwendung.
 //
 
 #include <iostream>
@@ -12,6 +12,7 @@
 #include "CameraController.h"
 #include "GeometryNode.h"
 #include "DirectionalShadowStrategy.h"
+#include "ShadowAtlas.h"
 #include "LookAtController.h"
 #include "CarController.h"
 #include "FootstepNode.h"
@@ -41,6 +42,12 @@ int main(){
 	int window_height = 900;
 	bool window_fullscreen = false;
 	int refresh_rate = 60;
+	auto depth_prepass = DEPTH_PREPASS_AUTO;
+	int shadow_budget = 8;
+	bool paraboloid_shadows = false;
+	bool shadow_filter = false;
+	int dynamic_resolution = 0;
+	bool quality_governor = false;
 
 	std::ifstream config("config.txt");
 	if (config.is_open())
@@ -64,6 +71,18 @@ int main(){
 				window_fullscreen = std::stoi(value);
 			} else if (param == "refreshrate") {
 				refresh_rate = std::stoi(value);
+			} else if (param == "depthprepass") {
+				depth_prepass = DepthPrepassMode(std::stoi(value));
+			} else if (param == "shadowbudget") {
+				shadow_budget = std::stoi(value);
+			} else if (param == "paraboloidshadows") {
+				paraboloid_shadows = std::stoi(value);
+			} else if (param == "shadowfilter") {
+				shadow_filter = std::stoi(value);
+			} else if (param == "dynamicresolution") {
+				dynamic_resolution = std::stoi(value);
+			} else if (param == "qualitygovernor") {
+				quality_governor = std::stoi(value);
 			} else
 			{
 				std::cout << "Unknown Parameter " << param << std::endl;
@@ -74,16 +93,26 @@ int main(){
 
 	auto engine = new RenderingEngine(glm::ivec2(window_width, window_height), window_fullscreen, refresh_rate);
 	auto root = engine->get_root_node();
+	// blurred EVSM shadows instead of percentage closer filtering
+	engine->get_shadow_atlas()->set_filtered(shadow_filter);
+	// lowest render resolution in percent of the window, 0 always renders at full resolution
+	engine->set_dynamic_resolution(dynamic_resolution / 100.0f);
+	// shadow, volumetric and bloom quality follow the frame time instead of staying at the highest settings
+	engine->set_quality_governed(quality_governor);
 
 	const auto cam = new CameraNode("MainCamera",
 		engine->get_viewport(),
 		60.0f, float(window_width) / float(window_height), 0.05f, 95.0f, true
 	);
 	cam->set_bloom_params(1, 1.0, 1);
+	cam->set_depth_prepass_mode(depth_prepass);
+	// shadow texels per frame in millions
+	cam->set_shadow_budget(shadow_budget * 1000000LL);
 	cam->set_view_matrix(glm::lookAt(glm::vec3(6.11709, 5.40085, -9.8344), glm::vec3(-4.42165, 5.40085, -3.74445), glm::vec3(0, 1, 0)));
 	root->add_node(cam);
 
 	auto importer = new ColladaImporter(engine);
+	importer->set_paraboloid_shadows(paraboloid_shadows);
 	const auto world = importer->load_node("assets/models/world1.dae");
 	root->add_node(world);
 